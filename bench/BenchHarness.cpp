@@ -0,0 +1,82 @@
+#include "BenchHarness.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+volatile long long benchSink = 0;
+
+// Longest a benchmark may take to calibrate before its iteration count is fixed
+const long long maxIterations = 1LL << 40;
+
+static double secondsFor(BenchBody body, void *context, long long iterations)
+{
+    auto start = chrono::steady_clock::now();
+    body(context, iterations);
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool benchSelected(const BenchOptions &options, const char *name)
+{
+    return options.filter == 0 || strstr(name, options.filter) != 0;
+}
+
+/**
+ * Times body in ns per operation. The iteration count is doubled until one
+ * run takes minRunSeconds (that also warms caches and branch predictors),
+ * then options.runs runs are timed and the median is kept, which is what
+ * stays put from one invocation to the next. Returns false when the
+ * benchmark is filtered out.
+ */
+bool runBenchmark(const BenchOptions &options, const char *name, BenchBody body, void *context,
+                  long long opsPerIteration, BenchResult &result)
+{
+    if (!benchSelected(options, name))
+        return false;
+
+    long long iterations = 1;
+    while (secondsFor(body, context, iterations) < options.minRunSeconds && iterations < maxIterations)
+        iterations *= 2;
+
+    double *samples = new double[options.runs];
+    for (int r = 0; r < options.runs; r++)
+    {
+        double ns = secondsFor(body, context, iterations) * 1e9 / (double(iterations) * opsPerIteration);
+
+        // Insertion sort as we go, there are only a handful of runs
+        int i = r;
+        for (; i > 0 && samples[i - 1] > ns; i--)
+            samples[i] = samples[i - 1];
+        samples[i] = ns;
+    }
+
+    result.medianNs = samples[options.runs / 2];
+    result.minNs = samples[0];
+    result.maxNs = samples[options.runs - 1];
+    delete[] samples;
+    return true;
+}
+
+void printBenchHeader()
+{
+    cout << "benchmark                              ns/op        min        max" << endl;
+}
+
+static void printColumn(double value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%11.2f", value);
+    cout << text;
+}
+
+void printBenchResult(const char *name, const BenchResult &result)
+{
+    cout << name;
+    for (int pad = int(strlen(name)); pad < 34; pad++)
+        cout << ' ';
+    printColumn(result.medianNs);
+    printColumn(result.minNs);
+    printColumn(result.maxNs);
+    cout << endl;
+}
@@ -0,0 +1,29 @@
+#ifndef XONIX_BENCH_HARNESS_H
+#define XONIX_BENCH_HARNESS_H
+
+// The code being measured, run iterations times in a row on whatever context the benchmark set up
+typedef void (*BenchBody)(void *context, long long iterations);
+
+struct BenchOptions
+{
+    const char *filter = 0;      // Only run benchmarks whose name contains this
+    int runs = 7;                // Timed runs per benchmark, the median is reported
+    double minRunSeconds = 0.05; // Each run repeats the body until it takes at least this long
+};
+
+struct BenchResult
+{
+    double medianNs;    // Nanoseconds per operation
+    double minNs, maxNs;
+};
+
+bool benchSelected(const BenchOptions &options, const char *name);
+bool runBenchmark(const BenchOptions &options, const char *name, BenchBody body, void *context,
+                  long long opsPerIteration, BenchResult &result);
+void printBenchHeader();
+void printBenchResult(const char *name, const BenchResult &result);
+
+// Results are added in here so the compiler can't throw away the work being timed
+extern volatile long long benchSink;
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef XONIX_BOARD_SHAPES_H
+#define XONIX_BOARD_SHAPES_H
+
+// Board layouts shared by the benchmarks, built on an int per cell and then copied into a Board
+#include "engine/Board.h"
+
+// Empty board with a filled border, like a fresh game
+inline void makeOpenBoard(int *cells, int rows, int cols)
+{
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            cells[i * cols + j] = (i == 0 || j == 0 || i == rows - 1 || j == cols - 1) ? CELL_FILLED : CELL_EMPTY;
+}
+
+// Serpentine corridor: filled walls every other row with a gap at alternating ends.
+// This is the worst case for the scanline fill since every span is a whole row.
+inline void makeSerpentineBoard(int *cells, int rows, int cols)
+{
+    makeOpenBoard(cells, rows, cols);
+    for (int i = 2; i < rows - 1; i += 2)
+    {
+        int gap = (i / 2) % 2 == 0 ? cols - 2 : 1;
+        for (int j = 1; j < cols - 1; j++)
+            if (j != gap)
+                cells[i * cols + j] = CELL_FILLED;
+    }
+}
+
+// Diagonal stripes of trail, lots of short spans on every row
+inline void makeStripedBoard(int *cells, int rows, int cols)
+{
+    makeOpenBoard(cells, rows, cols);
+    for (int i = 1; i < rows - 1; i++)
+        for (int j = 1; j < cols - 1; j++)
+            if ((i + j) % 7 == 0 && j % 3 != 0)
+                cells[i * cols + j] = CELL_TRAIL;
+}
+
+struct BoardShape
+{
+    const char *name;
+    void (*build)(int *cells, int rows, int cols);
+};
+
+const BoardShape boardShapes[] = {{"open", makeOpenBoard}, {"serpentine", makeSerpentineBoard}, {"striped", makeStripedBoard}};
+const int numOfBoardShapes = sizeof(boardShapes) / sizeof(boardShapes[0]);
+
+// Copies an int grid built by one of the shapes into the board's bitplanes
+inline void loadBoard(Board &board, const int *cells, int rows, int cols)
+{
+    board.resize(rows, cols);
+    initializeGrid(board);
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            board.set(i, j, cells[i * cols + j]);
+}
+
+#endif
@@ -0,0 +1,114 @@
+// Compares the scanline floodFill() used by captures with the recursive
+// drop() it replaced, on boards from the default 25x40 up to 4096x4096.
+// The old fill runs on an int per cell like the original grid did.
+#include "BoardShapes.h"
+#include "engine/FloodFill.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+// Boards bigger than this overflow the default 8 MB stack with the recursive fill
+const int maxRecursiveCells = 256 * 256;
+
+// The recursive fill exactly as it used to be in the game, on a flat grid
+static void dropRecursive(int *cells, int cols, int y, int x)
+{
+    if (cells[y * cols + x] == CELL_EMPTY)
+        cells[y * cols + x] = CELL_MARKED;
+    if (cells[(y - 1) * cols + x] == CELL_EMPTY)
+        dropRecursive(cells, cols, y - 1, x);
+    if (cells[(y + 1) * cols + x] == CELL_EMPTY)
+        dropRecursive(cells, cols, y + 1, x);
+    if (cells[y * cols + x - 1] == CELL_EMPTY)
+        dropRecursive(cells, cols, y, x - 1);
+    if (cells[y * cols + x + 1] == CELL_EMPTY)
+        dropRecursive(cells, cols, y, x + 1);
+}
+
+// Average time of the old recursive fill in nanoseconds, the grid is restored between runs outside the timing
+static double timeRecursiveFill(const int *original, int *cells, int rows, int cols, int repetitions, int &markedCells)
+{
+    double totalNs = 0;
+    for (int r = 0; r < repetitions; r++)
+    {
+        memcpy(cells, original, sizeof(int) * rows * cols);
+
+        auto start = chrono::steady_clock::now();
+        dropRecursive(cells, cols, 1, 1);
+        totalNs += chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+
+    markedCells = 0;
+    for (int i = 0; i < rows * cols; i++)
+        if (cells[i] == CELL_MARKED)
+            markedCells++;
+
+    return totalNs / repetitions;
+}
+
+// Same for floodFill() on the bitplanes, only the marked plane needs clearing between runs
+static double timeScanlineFill(Board &board, int repetitions, FloodFillWorkspace &work, int &markedCells)
+{
+    double totalNs = 0;
+    for (int r = 0; r < repetitions; r++)
+    {
+        memset(board.marked, 0, sizeof(uint64_t) * board.wordCount);
+
+        auto start = chrono::steady_clock::now();
+        markedCells = floodFill(board, 1, 1, work);
+        totalNs += chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+    return totalNs / repetitions;
+}
+
+int main()
+{
+    const int sizes[][2] = {{25, 40}, {64, 64}, {256, 256}, {1024, 1024}, {4096, 4096}};
+    const int numOfSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    FloodFillWorkspace work;
+    Board board;
+
+    cout << "shape        size\tcells\tscanline (us)\trecursive (us)\tspeedup" << endl;
+    for (int s = 0; s < numOfBoardShapes; s++)
+    {
+        for (int z = 0; z < numOfSizes; z++)
+        {
+            int rows = sizes[z][0];
+            int cols = sizes[z][1];
+            int cellCount = rows * cols;
+            int *original = new int[cellCount];
+            int *cells = new int[cellCount];
+            boardShapes[s].build(original, rows, cols);
+
+            // Aim for roughly the same amount of work per row of the table
+            int repetitions = 20000000 / cellCount;
+            if (repetitions < 3) repetitions = 3;
+            if (repetitions > 2000) repetitions = 2000;
+
+            loadBoard(board, original, rows, cols);
+            int scanlineMarked = 0;
+            double scanlineNs = timeScanlineFill(board, repetitions, work, scanlineMarked);
+
+            cout << boardShapes[s].name;
+            for (int pad = strlen(boardShapes[s].name); pad < 13; pad++) cout << ' ';
+            cout << rows << "x" << cols << "\t" << scanlineMarked << "\t" << scanlineNs / 1000.0;
+
+            if (cellCount <= maxRecursiveCells) {
+                int recursiveMarked = 0;
+                double recursiveNs = timeRecursiveFill(original, cells, rows, cols, repetitions, recursiveMarked);
+                cout << "\t" << recursiveNs / 1000.0 << "\t" << recursiveNs / scanlineNs << "x";
+                if (recursiveMarked != scanlineMarked)
+                    cout << "  MISMATCH (" << recursiveMarked << " cells)";
+            }
+            else
+                cout << "\tskipped (would overflow the stack)";
+            cout << endl;
+
+            delete[] original;
+            delete[] cells;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Steps a batch of environments with random actions and reports how many
+// environment steps per second the VecEnv API gets through on all cores.
+#include "engine/VecEnv.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+static void printUsage()
+{
+    cout << "Usage: xonix_env_bench [--envs N] [--threads N] [--steps N] [--rows N] [--cols N]"
+         << " [--enemies N] [--ticks-per-step N]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    VecEnvConfig config;
+    config.envCount = 64;
+    int steps = 2000;
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "--envs") == 0) config.envCount = atoi(value);
+        else if (strcmp(argv[i], "--threads") == 0) config.threads = atoi(value);
+        else if (strcmp(argv[i], "--steps") == 0) steps = atoi(value);
+        else if (strcmp(argv[i], "--rows") == 0) config.rows = atoi(value);
+        else if (strcmp(argv[i], "--cols") == 0) config.cols = atoi(value);
+        else if (strcmp(argv[i], "--enemies") == 0) config.enemyCount = atoi(value);
+        else if (strcmp(argv[i], "--ticks-per-step") == 0) config.ticksPerStep = atoi(value);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    VecEnv env;
+    if (steps <= 0 || !createVecEnv(env, config)) {
+        printUsage();
+        return 1;
+    }
+
+    // The caller owns the observations, one block for every environment
+    unsigned char *observations = new unsigned char[(size_t)env.layout.size * config.envCount];
+    int *actions = new int[config.envCount];
+    Random actionRng;
+    long long episodes = 0;
+
+    resetVecEnv(env, observations);
+    auto startTime = chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++)
+    {
+        for (int i = 0; i < config.envCount; i++)
+            actions[i] = actionRng.nextInt(8) < 7 ? DIR_NONE : DIR_LEFT + actionRng.nextInt(4);
+        stepVecEnv(env, actions, observations);
+
+        for (int i = 0; i < config.envCount; i++)
+        {
+            int32_t done;
+            memcpy(&done, observations + (size_t)i * env.layout.size + OBS_DONE * sizeof(int32_t), sizeof(done));
+            episodes += done;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    double envSteps = double(steps) * config.envCount;
+
+    cout << "environments:   " << config.envCount << " on " << env.pool.threadCount << " threads" << endl;
+    cout << "board:          " << config.rows << "x" << config.cols << ", " << env.layout.enemyCount << " enemies" << endl;
+    cout << "observation:    " << env.layout.size << " bytes" << endl;
+    cout << "steps:          " << steps << " x " << config.ticksPerStep << " ticks" << endl;
+    cout << "episodes ended: " << episodes << endl;
+    cout << "wall time:      " << seconds << " s" << endl;
+    cout << "env steps/sec:  " << (seconds > 0 ? envSteps / seconds : 0) << endl;
+
+    delete[] observations;
+    delete[] actions;
+    return 0;
+}
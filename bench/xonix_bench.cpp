@@ -0,0 +1,453 @@
+// Microbenchmarks of the engine's hot paths, each reported in ns per
+// operation: flood fills on the benchmark board shapes, initializeGrid(),
+// the capture reclassification in finalizeCapture(), enemy moves per
+// motion pattern, the hunters' trail distances, publishing a frame to
+// the render thread, taking and restoring save states, loading a big
+// scoreboard, firing timed events and, when built with SFML, drawing the
+// board offscreen.
+#include "BenchHarness.h"
+#include "BoardShapes.h"
+#include "engine/BigMap.h"
+#include "engine/Enemy.h"
+#include "engine/EventScheduler.h"
+#include "engine/FloodFill.h"
+#include "engine/FrameHandoff.h"
+#include "engine/SaveState.h"
+#include "engine/Scoreboard.h"
+#include "engine/TrailDistance.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#ifdef XONIX_BENCH_RENDER
+#include "render/TileRenderer.h"
+#endif
+using namespace std;
+
+const int benchSizes[][2] = {{25, 40}, {100, 160}, {1024, 1024}};
+const int numOfBenchSizes = sizeof(benchSizes) / sizeof(benchSizes[0]);
+
+struct BoardContext
+{
+    Board board;
+    FloodFillWorkspace work;
+    uint64_t *savedMarked;    // Marked plane to restore before each reclassification
+};
+
+// One capture's flood fill from the top left corner, the marked plane is cleared first as a capture would leave it
+static void benchFill(void *context, long long iterations)
+{
+    BoardContext &bench = *(BoardContext *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        memset(bench.board.marked, 0, sizeof(uint64_t) * bench.board.wordCount);
+        benchSink += floodFill(bench.board, 1, 1, bench.work);
+    }
+}
+
+static void benchInitializeGrid(void *context, long long iterations)
+{
+    BoardContext &bench = *(BoardContext *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        initializeGrid(bench.board);
+        benchSink += bench.board.filled[0];
+    }
+}
+
+// finalizeCapture() clears the marks, so they are copied back each time (one plane, a quarter of what it touches)
+static void benchReclassify(void *context, long long iterations)
+{
+    BoardContext &bench = *(BoardContext *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        memcpy(bench.board.marked, bench.savedMarked, sizeof(uint64_t) * bench.board.wordCount);
+        benchSink += finalizeCapture(bench.board);
+    }
+}
+
+struct EnemyContext
+{
+    Board board;
+    EnemyPool pool;
+};
+
+// One tick of every enemy at 60 Hz, the operation is one enemy moved
+static void benchEnemies(void *context, long long iterations)
+{
+    EnemyContext &bench = *(EnemyContext *)context;
+    for (long long i = 0; i < iterations; i++)
+        benchSink += moveEnemies(bench.pool, bench.board, 1.0f, 1.0f / referenceTickRate);
+}
+
+// Fills a pool with count enemies spread over the board, all following motion
+static void spawnEnemies(EnemyContext &bench, int count, int motion)
+{
+    Random rng;
+    rng.seed(12345);
+    clearEnemies(bench.pool);
+    bench.pool.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        int slot = addEnemy(bench.pool, rng);
+        bench.pool.x[slot] = float(ts + rng.nextInt((bench.board.cols - 2) * ts));
+        bench.pool.y[slot] = float(ts + rng.nextInt((bench.board.rows - 2) * ts));
+        bench.pool.motion[slot] = motion;
+    }
+    sortEnemiesByMotion(bench.pool);
+}
+
+struct TrailContext
+{
+    Board board;
+    TrailDistanceField field;
+};
+
+// A trail laid straight down the middle of an open board, the operation is one trail cell added
+static void benchTrailDistances(void *context, long long iterations)
+{
+    TrailContext &bench = *(TrailContext *)context;
+    int x = bench.board.cols / 2;
+    for (long long i = 0; i < iterations; i++)
+    {
+        clearTrailDistances(bench.field);
+        for (int y = 1; y < bench.board.rows - 1; y++)
+            addTrailSource(bench.field, bench.board, y * bench.board.cols + x);
+        benchSink += bench.field.distance[bench.board.cols + 1];
+    }
+}
+
+struct SaveStateContext
+{
+    Game game;
+    SaveState state;
+    FrameHandoff frames;
+};
+
+static void benchCaptureState(void *context, long long iterations)
+{
+    SaveStateContext &bench = *(SaveStateContext *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        captureSaveState(bench.state, bench.game);
+        benchSink += bench.state.size;
+    }
+}
+
+static void benchRestoreState(void *context, long long iterations)
+{
+    SaveStateContext &bench = *(SaveStateContext *)context;
+    for (long long i = 0; i < iterations; i++)
+        benchSink += restoreSaveState(bench.game, bench.state);
+}
+
+// What the simulation thread does after every batch of ticks, nobody takes the frames so all but one are dropped
+static void benchPublishFrame(void *context, long long iterations)
+{
+    SaveStateContext &bench = *(SaveStateContext *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        captureFrame(backFrame(bench.frames), bench.game);
+        publishFrame(bench.frames);
+    }
+    benchSink += bench.frames.published;
+}
+
+const char *benchScoresPath = "xonix_bench_scores.xsb";
+const int benchScoreRecords = 1000000;
+
+// Opening the scoreboard reads every record into the best scores, the operation is one record
+static void benchLoadScores(void *context, long long iterations)
+{
+    Scoreboard &scores = *(Scoreboard *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        openScoreboard(scores, benchScoresPath);
+        benchSink += scores.recordCount;
+        closeScoreboard(scores);
+    }
+}
+
+const char *benchMapPath = "xonix_bench_map.xmap";
+const int benchMapChunks = 16;
+
+struct BigMapContext
+{
+    Game game;
+    BigMap map;
+};
+
+// The player walks along the top edge of the world, past the margin one way and then the other
+static void benchMoveSector(void *context, long long iterations)
+{
+    BigMapContext &bench = *(BigMapContext *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        bench.game.playerX = bench.map.originCol == 0 ? sectorCells - sectorShiftMargin : sectorShiftMargin - 1;
+        benchSink += followPlayer(bench.game, bench.map);
+    }
+}
+
+const int schedulerSizes[] = {16, 1024, 65536};
+const float schedulerTick = 1.0f / referenceTickRate;
+const int schedulerClockTicks = 3600;    // The clock goes back to the start after a minute, so float time never runs out of steps
+
+// Game time of a tick, the same for the tick firing an event and the one scheduling it
+static float schedulerTime(long long tick)
+{
+    return float(tick % schedulerClockTicks + 1) * schedulerTick;
+}
+
+// One tick of the game's timed events: a power-up runs out and another starts, the rest wait far ahead
+static void benchSchedulerTick(void *context, long long iterations)
+{
+    EventScheduler &events = *(EventScheduler *)context;
+    ScheduledEvent event;
+    for (long long i = 0; i < iterations; i++)
+    {
+        while (popDueEvent(events, schedulerTime(i), event))
+            benchSink += event.type;
+        scheduleEvent(events, schedulerTime(i + 1), EVENT_FREEZE_END);
+    }
+}
+
+#ifdef XONIX_BENCH_RENDER
+struct RenderContext
+{
+    Board *board;
+    TileRenderer renderer;
+    sf::RenderTexture target;
+    bool redrawAll;    // Mark every cell dirty first, like the first frame of a game
+};
+
+// One frame of the board: rewrite the dirty quads, draw the chunks they were in again, blit every chunk
+// from its cache and finish the texture
+static void benchRender(void *context, long long iterations)
+{
+    RenderContext &bench = *(RenderContext *)context;
+    for (long long i = 0; i < iterations; i++)
+    {
+        if (bench.redrawAll)
+            memset(bench.board->dirty, 0xff, sizeof(uint64_t) * bench.board->wordCount);
+        benchSink += updateTileRenderer(bench.renderer, *bench.board);
+        bench.target.clear(sf::Color(0, 0, 50));
+        drawTileRenderer(bench.target, bench.renderer);
+        benchSink += bench.renderer.chunksRendered;
+        bench.target.display();
+    }
+}
+#endif
+
+static void report(const BenchOptions &options, const char *name, BenchBody body, void *context, long long opsPerIteration)
+{
+    BenchResult result;
+    if (runBenchmark(options, name, body, context, opsPerIteration, result))
+        printBenchResult(name, result);
+}
+
+static void printUsage()
+{
+    cout << "Usage: xonix_bench [--filter TEXT] [--runs N] [--min-time SECONDS]" << endl;
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--filter") == 0) options.filter = argv[i + 1];
+        else if (strcmp(argv[i], "--runs") == 0) options.runs = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--min-time") == 0) options.minRunSeconds = atof(argv[i + 1]);
+        else return false;
+    }
+    return argc % 2 == 1 && options.runs > 0 && options.minRunSeconds > 0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    printBenchHeader();
+    char name[64];
+
+    BoardContext *boardBench = new BoardContext;
+    for (int z = 0; z < numOfBenchSizes; z++)
+    {
+        int rows = benchSizes[z][0];
+        int cols = benchSizes[z][1];
+        int *cells = new int[rows * cols];
+
+        for (int s = 0; s < numOfBoardShapes; s++)
+        {
+            snprintf(name, sizeof(name), "fill/%s/%dx%d", boardShapes[s].name, rows, cols);
+            if (!benchSelected(options, name))
+                continue;
+            boardShapes[s].build(cells, rows, cols);
+            loadBoard(boardBench->board, cells, rows, cols);
+            report(options, name, benchFill, boardBench, 1);
+        }
+
+        snprintf(name, sizeof(name), "initializeGrid/%dx%d", rows, cols);
+        boardBench->board.resize(rows, cols);
+        report(options, name, benchInitializeGrid, boardBench, 1);
+
+        // A trail across the middle closed off the bottom half, the top half was reached by an enemy
+        snprintf(name, sizeof(name), "reclassify/%dx%d", rows, cols);
+        if (benchSelected(options, name))
+        {
+            makeOpenBoard(cells, rows, cols);
+            for (int j = 1; j < cols - 1; j++)
+                cells[(rows / 2) * cols + j] = CELL_TRAIL;
+            loadBoard(boardBench->board, cells, rows, cols);
+            floodFill(boardBench->board, 1, 1, boardBench->work);
+            boardBench->savedMarked = new uint64_t[boardBench->board.wordCount];
+            memcpy(boardBench->savedMarked, boardBench->board.marked, sizeof(uint64_t) * boardBench->board.wordCount);
+            report(options, name, benchReclassify, boardBench, 1);
+            delete[] boardBench->savedMarked;
+        }
+        delete[] cells;
+    }
+    delete boardBench;
+
+    // Enemies on an open 256x256 board, so the bounce tests see both walls and open space
+    const int enemyCounts[] = {1000, 100000};
+    EnemyContext *enemyBench = new EnemyContext;
+    enemyBench->board.resize(256, 256);
+    initializeGrid(enemyBench->board);
+    for (int motion = MOTION_LINEAR; motion < numOfPatterns; motion++)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            const char *motionName = motion == MOTION_LINEAR ? "linear" : MotionPatterns::names[motion];
+            snprintf(name, sizeof(name), "enemies/%s/%d", motionName, enemyCounts[c]);
+            if (!benchSelected(options, name))
+                continue;
+            spawnEnemies(*enemyBench, enemyCounts[c], motion);
+            report(options, name, benchEnemies, enemyBench, enemyCounts[c]);
+        }
+    }
+    delete enemyBench;
+
+    // The distances hunters steer by, spread from each new trail cell
+    TrailContext *trailBench = new TrailContext;
+    for (int z = 0; z < numOfBenchSizes; z++)
+    {
+        int rows = benchSizes[z][0];
+        int cols = benchSizes[z][1];
+        snprintf(name, sizeof(name), "trailDistance/add/%dx%d", rows, cols);
+        if (!benchSelected(options, name))
+            continue;
+        trailBench->board.resize(rows, cols);
+        initializeGrid(trailBench->board);
+        resetTrailDistances(trailBench->field, trailBench->board);
+        report(options, name, benchTrailDistances, trailBench, rows - 2);
+    }
+    delete trailBench;
+
+    // A game part way through a trail, saved and restored whole and published as a frame
+    SaveStateContext *stateBench = new SaveStateContext;
+    for (int z = 0; z < numOfBenchSizes; z++)
+    {
+        int rows = benchSizes[z][0];
+        int cols = benchSizes[z][1];
+        startGame(stateBench->game, 3, 12345, rows, cols);
+        for (int tick = 0; tick < 60; tick++)
+            updateGame(stateBench->game, 1.0f / referenceTickRate, DIR_DOWN);
+        captureSaveState(stateBench->state, stateBench->game);
+
+        snprintf(name, sizeof(name), "saveState/capture/%dx%d", rows, cols);
+        report(options, name, benchCaptureState, stateBench, 1);
+        snprintf(name, sizeof(name), "saveState/restore/%dx%d", rows, cols);
+        report(options, name, benchRestoreState, stateBench, 1);
+        snprintf(name, sizeof(name), "frameHandoff/publish/%dx%d", rows, cols);
+        report(options, name, benchPublishFrame, stateBench, 1);
+    }
+    delete stateBench;
+
+    // A scoreboard after years of cabinet play, written once and loaded again each run
+    snprintf(name, sizeof(name), "scoreboard/load/%d", benchScoreRecords);
+    if (benchSelected(options, name))
+    {
+        Scoreboard *scores = new Scoreboard;
+        remove(benchScoresPath);
+        if (openScoreboard(*scores, benchScoresPath))
+        {
+            Random rng;
+            rng.seed(777);
+            for (int i = 0; i < benchScoreRecords; i++)
+            {
+                ScoreRecord record = {rng.nextInt(1000), rng.nextInt(400), rng.nextInt(6000) / 10.0f,
+                                      1 + rng.nextInt(numOfDifficulties), rng.next(), 1700000000LL + i};
+                addScore(*scores, record);
+            }
+            closeScoreboard(*scores);
+            report(options, name, benchLoadScores, scores, benchScoreRecords);
+        }
+        remove(benchScoresPath);
+        delete scores;
+    }
+
+    // Moving the sector of a big map by a chunk: write it back, read it again and relabel it
+    snprintf(name, sizeof(name), "bigMap/moveSector/%dx%d", sectorCells, sectorCells);
+    if (benchSelected(options, name))
+    {
+        BigMapContext *mapBench = new BigMapContext;
+        if (createBigMap(benchMapPath, benchMapChunks, benchMapChunks) && openBigMap(mapBench->map, benchMapPath))
+        {
+            startBigMapGame(mapBench->game, mapBench->map, 1, 12345);
+            report(options, name, benchMoveSector, mapBench, 1);
+        }
+        delete mapBench;
+        remove(benchMapPath);
+    }
+
+    // The cost of a tick should follow the events that fire, not how many are pending
+    for (int z = 0; z < 3; z++)
+    {
+        snprintf(name, sizeof(name), "scheduler/tick/%d", schedulerSizes[z]);
+        if (!benchSelected(options, name))
+            continue;
+
+        EventScheduler *events = new EventScheduler;
+        scheduleEvent(*events, schedulerTime(0), EVENT_FREEZE_END);
+        for (int i = 1; i < schedulerSizes[z]; i++)
+            scheduleEvent(*events, 1e9f + i, EVENT_FREEZE_END);
+        report(options, name, benchSchedulerTick, events, 1);
+        delete events;
+    }
+
+#ifdef XONIX_BENCH_RENDER
+    sf::Texture tiles;
+    if (!tiles.loadFromFile("images/tiles.png"))
+        tiles.create(72, ts);    // Blank tiles still cost the same to draw
+
+    const int renderSizes[][2] = {{25, 40}, {50, 80}};
+    for (int z = 0; z < 2; z++)
+    {
+        int rows = renderSizes[z][0];
+        int cols = renderSizes[z][1];
+        int *cells = new int[rows * cols];
+        Board board;
+        makeStripedBoard(cells, rows, cols);
+        loadBoard(board, cells, rows, cols);
+        delete[] cells;
+
+        RenderContext *renderBench = new RenderContext;
+        renderBench->board = &board;
+        renderBench->target.create(cols * ts, rows * ts);
+        resetTileRenderer(renderBench->renderer, board, tiles);
+
+        for (int redrawAll = 1; redrawAll >= 0; redrawAll--)
+        {
+            snprintf(name, sizeof(name), "render/%s/%dx%d", redrawAll ? "full" : "steady", rows, cols);
+            renderBench->redrawAll = redrawAll != 0;
+            report(options, name, benchRender, renderBench, 1);
+        }
+        delete renderBench;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "AssetBundle.h"
+#include "ByteOrder.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <fstream>
+
+static const char bundleMagic[4] = {'X', 'P', 'A', 'K'};
+const int bundleHeaderSize = 16;
+const int bundleEntrySize = 64;
+
+AssetBundle::AssetBundle()
+{
+    data = 0;
+    size = 0;
+    entries = 0;
+    entryCount = 0;
+    mapped = false;
+}
+
+AssetBundle::~AssetBundle()
+{
+    closeAssetBundle(*this);
+}
+
+/**
+ * Opens a bundle written by writeAssetBundle(). Returns false, with the
+ * bundle left closed, if the file is missing or not a valid bundle.
+ */
+bool openAssetBundle(AssetBundle &bundle, const char *path)
+{
+    closeAssetBundle(bundle);
+    if (!mapFile(path, bundle.data, bundle.size, bundle.mapped))
+        return false;
+
+    const unsigned char *in = bundle.data;
+    if (bundle.size < size_t(bundleHeaderSize) || memcmp(in, bundleMagic, 4) != 0) {
+        closeAssetBundle(bundle);
+        return false;
+    }
+    in += 4;
+    int version = int(getBytes(in, 2));
+    int entryCount = int(getBytes(in, 2));
+    size_t fileSize = getBytes(in, 4);
+    if (version != assetBundleVersion || fileSize != bundle.size ||
+        bundleHeaderSize + size_t(entryCount) * bundleEntrySize > bundle.size) {
+        closeAssetBundle(bundle);
+        return false;
+    }
+
+    bundle.entries = new AssetEntry[entryCount];
+    bundle.entryCount = entryCount;
+    in = bundle.data + bundleHeaderSize;
+    for (int i = 0; i < entryCount; i++)
+    {
+        AssetEntry &entry = bundle.entries[i];
+        memcpy(entry.name, in, maxAssetNameLength + 1);
+        entry.name[maxAssetNameLength] = '\0';
+        in += maxAssetNameLength + 1;
+        entry.type = int(getBytes(in, 4));
+        entry.offset = getBytes(in, 4);
+        entry.size = getBytes(in, 4);
+        entry.x = int(getBytes(in, 4));
+        entry.y = int(getBytes(in, 4));
+        entry.width = int(getBytes(in, 4));
+        entry.height = int(getBytes(in, 4));
+        getBytes(in, 4);
+
+        // Every asset has to lie inside the file, and pixels have to fill their image exactly
+        bool valid = entry.type >= ASSET_PIXELS && entry.type <= ASSET_FILE &&
+                     entry.offset <= bundle.size && entry.size <= bundle.size - entry.offset &&
+                     entry.width >= 0 && entry.height >= 0;
+        if (valid && entry.type == ASSET_PIXELS)
+            valid = size_t(entry.size) == size_t(entry.width) * entry.height * 4;
+        if (!valid) {
+            closeAssetBundle(bundle);
+            return false;
+        }
+    }
+    return true;
+}
+
+void closeAssetBundle(AssetBundle &bundle)
+{
+    unmapFile(bundle.data, bundle.size, bundle.mapped);
+    delete[] bundle.entries;
+
+    bundle.data = 0;
+    bundle.size = 0;
+    bundle.entries = 0;
+    bundle.entryCount = 0;
+    bundle.mapped = false;
+}
+
+// The entry with this name, 0 if the bundle doesn't have one
+const AssetEntry *findAsset(const AssetBundle &bundle, const char *name)
+{
+    for (int i = 0; i < bundle.entryCount; i++)
+        if (strcmp(bundle.entries[i].name, name) == 0)
+            return &bundle.entries[i];
+    return 0;
+}
+
+const unsigned char *assetData(const AssetBundle &bundle, const AssetEntry &entry)
+{
+    return bundle.data + entry.offset;
+}
+
+/**
+ * Writes a bundle holding the given entries, data[i] being entry i's
+ * entries[i].size bytes (0 for regions). The offset of every entry is
+ * filled in here.
+ */
+bool writeAssetBundle(const char *path, AssetEntry *entries, const unsigned char *const *data, int entryCount)
+{
+    // Lay the data out after the table, each asset aligned
+    size_t offset = bundleHeaderSize + size_t(entryCount) * bundleEntrySize;
+    for (int i = 0; i < entryCount; i++) {
+        offset = (offset + assetDataAlignment - 1) / assetDataAlignment * assetDataAlignment;
+        entries[i].offset = (unsigned int)offset;
+        offset += entries[i].size;
+    }
+    size_t fileSize = offset;
+
+    size_t tableSize = bundleHeaderSize + size_t(entryCount) * bundleEntrySize;
+    unsigned char *table = new unsigned char[tableSize];
+    memset(table, 0, tableSize);
+    unsigned char *out = table;
+    memcpy(out, bundleMagic, 4);
+    out += 4;
+    putBytes(out, assetBundleVersion, 2);
+    putBytes(out, entryCount, 2);
+    putBytes(out, (unsigned int)fileSize, 4);
+    putBytes(out, 0, 4);
+
+    for (int i = 0; i < entryCount; i++) {
+        strncpy((char *)out, entries[i].name, maxAssetNameLength);
+        out += maxAssetNameLength + 1;
+        putBytes(out, entries[i].type, 4);
+        putBytes(out, entries[i].offset, 4);
+        putBytes(out, entries[i].size, 4);
+        putBytes(out, entries[i].x, 4);
+        putBytes(out, entries[i].y, 4);
+        putBytes(out, entries[i].width, 4);
+        putBytes(out, entries[i].height, 4);
+        putBytes(out, 0, 4);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        delete[] table;
+        return false;
+    }
+    file.write((const char *)table, tableSize);
+    delete[] table;
+
+    const char zeros[assetDataAlignment] = {};
+    size_t written = tableSize;
+    for (int i = 0; i < entryCount; i++) {
+        file.write(zeros, entries[i].offset - written);
+        if (entries[i].size > 0)
+            file.write((const char *)data[i], entries[i].size);
+        written = entries[i].offset + entries[i].size;
+    }
+    return bool(file);
+}
@@ -0,0 +1,59 @@
+#ifndef XONIX_ASSET_BUNDLE_H
+#define XONIX_ASSET_BUNDLE_H
+
+#include <cstddef>
+
+const int assetBundleVersion = 1;
+const int maxAssetNameLength = 31;
+const int assetDataAlignment = 64;    // Every asset starts on a 64 byte boundary of the file
+
+enum AssetType
+{
+    ASSET_PIXELS,    // RGBA8 pixels, width x height
+    ASSET_REGION,    // No data, a rectangle of the atlas
+    ASSET_FILE       // A file stored as it was, fonts
+};
+
+// One named asset in a bundle
+struct AssetEntry
+{
+    char name[maxAssetNameLength + 1];
+    int type;
+    unsigned int offset, size;      // Where the data is in the file, in bytes
+    int x, y, width, height;        // Pixels: the image size, region: the rectangle in the atlas
+};
+
+/**
+ * A file holding every asset the game starts with, read through a memory
+ * mapping so starting up doesn't copy it. The pixels of the atlas are
+ * stored decoded and fonts are handed to the font loader straight from the
+ * mapping, which therefore has to stay open as long as they are used.
+ *
+ * File layout, little-endian: "XPAK", u16 version, u16 entry count,
+ * u32 file size, u32 unused, then 64 bytes per entry (name padded with
+ * zeros to 32 bytes, u32 type, u32 offset, u32 size, i32 x, y, width,
+ * height, u32 unused), then the data of each asset.
+ */
+struct AssetBundle
+{
+    const unsigned char *data;
+    size_t size;
+    AssetEntry *entries;
+    int entryCount;
+    bool mapped;    // data is a memory mapping, otherwise it was read into a buffer
+
+    AssetBundle();
+    ~AssetBundle();
+
+    AssetBundle(const AssetBundle &) = delete;
+    AssetBundle &operator=(const AssetBundle &) = delete;
+};
+
+bool openAssetBundle(AssetBundle &bundle, const char *path);
+void closeAssetBundle(AssetBundle &bundle);
+const AssetEntry *findAsset(const AssetBundle &bundle, const char *name);
+const unsigned char *assetData(const AssetBundle &bundle, const AssetEntry &entry);
+
+bool writeAssetBundle(const char *path, AssetEntry *entries, const unsigned char *const *data, int entryCount);
+
+#endif
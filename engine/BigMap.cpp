@@ -0,0 +1,314 @@
+#include "BigMap.h"
+#include "ByteOrder.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+static const char bigMapMagic[4] = {'X', 'M', 'A', 'P'};
+const unsigned int byteOrderMark = 0x01020304;
+
+static size_t mapFileSize(int chunkRows, int chunkCols)
+{
+    return mapHeaderSize + size_t(chunkRows) * chunkCols * mapChunkBytes;
+}
+
+BigMap::BigMap()
+{
+    path[0] = '\0';
+    data = 0;
+    size = 0;
+    mapped = false;
+    chunkRows = chunkCols = 0;
+    originRow = originCol = 0;
+    sectorLoaded = false;
+    sectorMoves = 0;
+    chunksWritten = 0;
+}
+
+BigMap::~BigMap()
+{
+    closeBigMap(*this);
+}
+
+/**
+ * Writes an empty map with only the edge of the world filled. The file is
+ * made its full size without writing the chunks in between, which stay
+ * holes on file systems that allow it.
+ */
+bool createBigMap(const char *path, int chunkRows, int chunkCols)
+{
+    if (chunkRows < sectorChunks || chunkCols < sectorChunks || chunkRows > maxMapChunks || chunkCols > maxMapChunks)
+        return false;
+
+    unsigned char header[mapHeaderSize] = {};
+    unsigned char *out = header;
+    memcpy(out, bigMapMagic, 4);
+    out += 4;
+    putBytes(out, mapVersion, 2);
+    putBytes(out, mapChunkSize, 2);
+    memcpy(out, &byteOrderMark, 4);
+    out += 4;
+    putBytes(out, (unsigned int)chunkRows, 4);
+    putBytes(out, (unsigned int)chunkCols, 4);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.write((const char *)header, mapHeaderSize))
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::resize_file(path, mapFileSize(chunkRows, chunkCols), error);
+    if (error)
+        return false;
+
+    BigMap map;
+    if (!openBigMap(map, path))
+        return false;
+    const uint64_t allCells = ~uint64_t(0);
+    for (int cx = 0; cx < chunkCols; cx++) {
+        mapChunk(map, 0, cx)[0] = allCells;
+        mapChunk(map, chunkRows - 1, cx)[mapChunkSize - 1] = allCells;
+    }
+    for (int cy = 0; cy < chunkRows; cy++)
+        for (int r = 0; r < mapChunkSize; r++) {
+            mapChunk(map, cy, 0)[r] |= 1;
+            mapChunk(map, cy, chunkCols - 1)[r] |= uint64_t(1) << (mapChunkSize - 1);
+        }
+    return closeBigMap(map);
+}
+
+bool openBigMap(BigMap &map, const char *path)
+{
+    closeBigMap(map);
+    if (strlen(path) > size_t(maxBigMapPath) || !mapWritableFile(path, map.data, map.size, map.mapped))
+        return false;
+    strcpy(map.path, path);
+
+    const unsigned char *in = map.data;
+    bool valid = map.size >= size_t(mapHeaderSize) && memcmp(in, bigMapMagic, 4) == 0;
+    if (valid) {
+        in += 4;
+        int version = int(getBytes(in, 2));
+        int chunkSize = int(getBytes(in, 2));
+        unsigned int byteOrder;
+        memcpy(&byteOrder, in, 4);
+        in += 4;
+        map.chunkRows = int(getBytes(in, 4));
+        map.chunkCols = int(getBytes(in, 4));
+        valid = version == mapVersion && chunkSize == mapChunkSize && byteOrder == byteOrderMark &&
+                map.chunkRows >= sectorChunks && map.chunkCols >= sectorChunks &&
+                map.chunkRows <= maxMapChunks && map.chunkCols <= maxMapChunks &&
+                map.size == mapFileSize(map.chunkRows, map.chunkCols);
+    }
+    if (!valid) {
+        closeBigMap(map);
+        return false;
+    }
+    map.originRow = map.originCol = 0;
+    map.sectorLoaded = false;
+    return true;
+}
+
+// Returns false if the cells couldn't be written back, which can only happen without mmap()
+bool closeBigMap(BigMap &map)
+{
+    bool written = unmapWritableFile(map.path, map.data, map.size, map.mapped);
+    map.data = 0;
+    map.size = 0;
+    map.mapped = false;
+    map.chunkRows = map.chunkCols = 0;
+    map.sectorLoaded = false;
+    return written;
+}
+
+// The 64 rows of a chunk, straight in the mapped file
+uint64_t *mapChunk(BigMap &map, int chunkRow, int chunkCol)
+{
+    size_t chunk = size_t(chunkRow) * map.chunkCols + chunkCol;
+    return (uint64_t *)(map.data + mapHeaderSize + chunk * mapChunkBytes);
+}
+
+// Cells of board word (y, cx) on the sector's outer ring, which is kept filled and never stored
+static uint64_t ringMask(int y, int cx)
+{
+    if (y == 0 || y == sectorCells - 1)
+        return ~uint64_t(0);
+    uint64_t mask = 0;
+    if (cx == 0)
+        mask |= 1;
+    if (cx == sectorChunks - 1)
+        mask |= uint64_t(1) << (mapChunkSize - 1);
+    return mask;
+}
+
+static bool isOpenCell(const Board &board, int y, int x)
+{
+    return y >= 0 && y < board.rows && x >= 0 && x < board.cols && !board.isFilled(y, x);
+}
+
+/**
+ * Moves (y, x) to the nearest open cell, looking ring by ring around it in
+ * the same order every time so a game always settles the same way.
+ * Returns false if the board has no open cell left.
+ */
+static bool findOpenCell(const Board &board, int &y, int &x)
+{
+    for (int r = 0; r < sectorCells; r++)
+        for (int d = -r; d <= r; d++) {
+            // The top and bottom of the ring, then its sides
+            const int ringY[4] = {y - r, y + r, y + d, y + d};
+            const int ringX[4] = {x + d, x + d, x - r, x + r};
+            for (int k = 0; k < 4; k++)
+                if (isOpenCell(board, ringY[k], ringX[k])) {
+                    y = ringY[k];
+                    x = ringX[k];
+                    return true;
+                }
+        }
+    return false;
+}
+
+/**
+ * Puts back enemies that moving the sector left outside it or in filled
+ * cells. One carried off a side comes back in at that side, and one on a
+ * filled cell goes to the nearest open cell. With no open cell left in the
+ * sector they wait inside its edge until it moves somewhere more open.
+ */
+static void settleEnemies(Game &game)
+{
+    EnemyPool &pool = game.enemies;
+    bool anyOpen = true;
+    for (int i = 0; i < pool.count; i++) {
+        int x = int(floorf(pool.x[i] / ts));
+        int y = int(floorf(pool.y[i] / ts));
+        if (isOpenCell(game.board, y, x))
+            continue;
+
+        x = x < 1 ? 1 : (x > sectorCells - 2 ? sectorCells - 2 : x);
+        y = y < 1 ? 1 : (y > sectorCells - 2 ? sectorCells - 2 : y);
+        if (anyOpen)
+            anyOpen = findOpenCell(game.board, y, x);
+        pool.x[i] = pool.previousX[i] = float(x * ts);
+        pool.y[i] = pool.previousY[i] = float(y * ts);
+    }
+}
+
+// Reads the sector at the map's origin onto the board, the whole board is redrawn
+static void loadSector(Game &game, BigMap &map)
+{
+    Board &board = game.board;
+    for (int cy = 0; cy < sectorChunks; cy++)
+        for (int cx = 0; cx < sectorChunks; cx++) {
+            const uint64_t *chunk = mapChunk(map, map.originRow + cy, map.originCol + cx);
+            for (int r = 0; r < mapChunkSize; r++) {
+                int y = cy * mapChunkSize + r;
+                board.filled[y * sectorChunks + cx] = chunk[r] | ringMask(y, cx);
+            }
+        }
+    for (int w = 0; w < board.wordCount; w++) {
+        board.trail[w] = 0;
+        board.marked[w] = 0;
+        board.dirty[w] = ~uint64_t(0);
+    }
+
+    resetRegions(game.regions, board);
+    resetTrailDistances(game.trailDistances, board);
+    recountFilledCells(game.stats, board);
+    settleEnemies(game);
+}
+
+/**
+ * Starts a game on the sector in the top left corner of the map, with the
+ * player on the edge of the world as on a normal board.
+ */
+void startBigMapGame(Game &game, BigMap &map, int difficultyLevel, unsigned int seed, int enemyCount, int hunters)
+{
+    startGame(game, difficultyLevel, seed, sectorCells, sectorCells, enemyCount, hunters);
+    map.originRow = map.originCol = 0;
+    loadSector(game, map);
+    map.sectorLoaded = true;
+}
+
+/**
+ * Writes the filled cells of the sector back into the map. Only rows that
+ * changed are written, so chunks nobody captured in are never dirtied.
+ */
+void storeSector(const Game &game, BigMap &map)
+{
+    for (int cy = 0; cy < sectorChunks; cy++)
+        for (int cx = 0; cx < sectorChunks; cx++) {
+            uint64_t *chunk = mapChunk(map, map.originRow + cy, map.originCol + cx);
+            bool changed = false;
+            for (int r = 0; r < mapChunkSize; r++) {
+                int y = cy * mapChunkSize + r;
+                uint64_t ring = ringMask(y, cx);
+                uint64_t cells = (game.board.filled[y * sectorChunks + cx] & ~ring) | (chunk[r] & ring);
+                if (cells != chunk[r]) {
+                    chunk[r] = cells;
+                    changed = true;
+                }
+            }
+            if (changed)
+                map.chunksWritten++;
+        }
+}
+
+// Whether the player's cell stays filled once the sector moves, the ring only counts where the map has it too
+static bool onLastingCell(const Game &game, BigMap &map)
+{
+    int x = game.playerX, y = game.playerY;
+    if (!game.board.isFilled(y, x))
+        return false;
+    if ((ringMask(y, x / mapChunkSize) & Board::bitOf(x)) == 0)
+        return true;
+    const uint64_t *chunk = mapChunk(map, map.originRow + y / mapChunkSize, map.originCol + x / mapChunkSize);
+    return (chunk[y % mapChunkSize] & Board::bitOf(x)) != 0;
+}
+
+/**
+ * Moves the sector one chunk towards the player when they are near its
+ * edge, there is more map that way, and they stand on filled cells with no
+ * trail out, so nothing in flight has to be carried over. Returns whether
+ * it moved; the player and enemies keep their place on the map, so their
+ * board positions jump by a chunk.
+ */
+bool followPlayer(Game &game, BigMap &map)
+{
+    if (!game.running || game.regions.trailCount > 0)
+        return false;
+
+    int moveCols = 0, moveRows = 0;
+    if (game.playerX < sectorShiftMargin && map.originCol > 0)
+        moveCols = -1;
+    else if (game.playerX >= sectorCells - sectorShiftMargin && map.originCol + sectorChunks < map.chunkCols)
+        moveCols = 1;
+    else if (game.playerY < sectorShiftMargin && map.originRow > 0)
+        moveRows = -1;
+    else if (game.playerY >= sectorCells - sectorShiftMargin && map.originRow + sectorChunks < map.chunkRows)
+        moveRows = 1;
+    if ((moveCols == 0 && moveRows == 0) || !onLastingCell(game, map))
+        return false;
+
+    storeSector(game, map);
+    map.originCol += moveCols;
+    map.originRow += moveRows;
+
+    game.playerX -= moveCols * mapChunkSize;
+    game.playerY -= moveRows * mapChunkSize;
+    float shiftX = float(moveCols * mapChunkSize * ts);
+    float shiftY = float(moveRows * mapChunkSize * ts);
+    EnemyPool &pool = game.enemies;
+    for (int i = 0; i < pool.count; i++) {
+        pool.x[i] -= shiftX;
+        pool.previousX[i] -= shiftX;
+        pool.y[i] -= shiftY;
+        pool.previousY[i] -= shiftY;
+    }
+
+    loadSector(game, map);
+    map.sectorMoves++;
+    return true;
+}
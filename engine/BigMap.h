@@ -0,0 +1,70 @@
+#ifndef XONIX_BIG_MAP_H
+#define XONIX_BIG_MAP_H
+
+#include "Game.h"
+#include <cstddef>
+
+const int mapChunkSize = 64;    // Cells per side of a chunk, one 64 bit word per row
+const int mapHeaderSize = 512;  // The header takes one chunk's room so chunks stay 512 byte aligned
+const int mapChunkBytes = mapChunkSize * mapChunkSize / 8;
+const int mapVersion = 1;
+const int sectorChunks = 8;     // Chunks per side of the part of the map that is played at once
+const int sectorCells = sectorChunks * mapChunkSize;
+const int sectorShiftMargin = 96;    // The sector moves on when the player is this close to its edge
+const int maxMapChunks = 16384;    // Per side, a million cells
+const int maxBigMapPath = 1024;
+
+static_assert(mapChunkSize == bitsPerWord, "a chunk row has to be one word of a board plane");
+
+/**
+ * A map far bigger than the board, kept on disk in 64x64 cell chunks and
+ * played a sector at a time. Only the filled cells are stored, a chunk is
+ * 64 words with bit x of word y set where cell (y, x) is filled, so an
+ * untouched stretch of open map is all zeros and can stay a hole in a
+ * sparse file. The file is mapped shared: the cells captured in the sector
+ * are written back into it as the sector moves on, and the system pages
+ * chunks in and out, so neither memory nor the cost of a tick grows with
+ * the size of the map.
+ *
+ * The sector is a Game on a sectorCells x sectorCells board whose outer
+ * ring is always filled, so enemies bounce off its edge and a trail can be
+ * closed against it. The ring is never written back. When the player
+ * stands on filled cells near the edge with no trail out, the sector moves
+ * one chunk that way: the board is written back, read again from the new
+ * position, and the player and enemies are moved with it.
+ *
+ * Layout: a 512 byte header ("XMAP", u16 version, u16 chunk size, u32 byte
+ * order mark, u32 rows and u32 columns of chunks) and then every chunk,
+ * row by row. Files are only read back on a machine with the same byte
+ * order.
+ */
+struct BigMap
+{
+    char path[maxBigMapPath + 1];
+    unsigned char *data;
+    size_t size;
+    bool mapped;
+    int chunkRows, chunkCols;
+    int originRow, originCol;    // First chunk of the sector
+    bool sectorLoaded;           // A game is being played on the sector, see storeSector()
+
+    long long sectorMoves;
+    long long chunksWritten;     // Chunks that had captured cells written back
+
+    BigMap();
+    ~BigMap();
+
+    BigMap(const BigMap &) = delete;
+    BigMap &operator=(const BigMap &) = delete;
+};
+
+bool createBigMap(const char *path, int chunkRows, int chunkCols);
+bool openBigMap(BigMap &map, const char *path);
+bool closeBigMap(BigMap &map);
+uint64_t *mapChunk(BigMap &map, int chunkRow, int chunkCol);
+
+void startBigMapGame(Game &game, BigMap &map, int difficultyLevel, unsigned int seed, int enemyCount = 0, int hunters = 0);
+bool followPlayer(Game &game, BigMap &map);
+void storeSector(const Game &game, BigMap &map);
+
+#endif
@@ -0,0 +1,217 @@
+#include "Board.h"
+#include <cstring>
+
+// AVX2 is picked at runtime so the same binary still runs on CPUs without it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define XONIX_HAS_AVX2_PATH 1
+#endif
+
+Board::Board()
+{
+    rows = cols = wordCount = 0;
+    words = filled = trail = marked = dirty = 0;
+    resize(defaultRows, defaultCols);
+}
+
+Board::~Board()
+{
+    delete[] words;
+}
+
+// Only reallocates when the number of words changes, the contents are left for initializeGrid()
+void Board::resize(int newRows, int newCols)
+{
+    int newWordCount = (newRows * newCols + bitsPerWord - 1) / bitsPerWord;
+    if (words == 0 || newWordCount != wordCount) {
+        delete[] words;
+        words = new uint64_t[newWordCount * 4];
+    }
+
+    rows = newRows;
+    cols = newCols;
+    wordCount = newWordCount;
+    filled = words;
+    trail = words + wordCount;
+    marked = words + wordCount * 2;
+    dirty = words + wordCount * 3;
+}
+
+bool isValidBoardSize(int rows, int cols)
+{
+    return rows >= minBoardRows && rows <= maxBoardRows && cols >= minBoardCols && cols <= maxBoardCols;
+}
+
+// Sets bits first to last (inclusive) of a plane a word at a time
+void setBitRange(uint64_t *plane, int first, int last)
+{
+    int firstWord = first / bitsPerWord;
+    int lastWord = last / bitsPerWord;
+    uint64_t firstMask = ~uint64_t(0) << (first % bitsPerWord);
+    uint64_t lastMask = ~uint64_t(0) >> (bitsPerWord - 1 - last % bitsPerWord);
+
+    if (firstWord == lastWord) {
+        plane[firstWord] |= firstMask & lastMask;
+        return;
+    }
+    plane[firstWord] |= firstMask;
+    for (int w = firstWord + 1; w < lastWord; w++)
+        plane[w] = ~uint64_t(0);
+    plane[lastWord] |= lastMask;
+}
+
+template <class Size>
+static void initializeCells(Board &board, Size size)
+{
+    const int rows = size.rows;
+    const int cols = size.cols;
+    const int wordCount = size.wordCount;
+
+    // Clear grid, every cell has to be drawn again
+    memset(board.words, 0, sizeof(uint64_t) * wordCount * 3);
+    memset(board.dirty, 0xff, sizeof(uint64_t) * wordCount);
+
+    // Set borders, the bits past the last cell count as filled
+    setBitRange(board.filled, 0, cols - 1);
+    setBitRange(board.filled, (rows - 1) * cols, wordCount * bitsPerWord - 1);
+    for (int i = 1; i < rows - 1; i++) {
+        board.filled[(i * cols) / bitsPerWord] |= Board::bitOf(i * cols);
+        board.filled[(i * cols + cols - 1) / bitsPerWord] |= Board::bitOf(i * cols + cols - 1);
+    }
+}
+
+/**
+ * Initialize the game grid with borders
+ */
+void initializeGrid(Board &board)
+{
+    withBoardSize(board, [&board](auto size) { initializeCells(board, size); });
+}
+
+// Filled cells that weren't part of the border initializeGrid() started with, the score of a game
+int capturedCellCount(const Board &board)
+{
+    int filledBits = 0;
+    for (int w = 0; w < board.wordCount; w++)
+        filledBits += countBits(board.filled[w]);
+    int paddingBits = board.wordCount * bitsPerWord - board.rows * board.cols;
+    int borderCells = 2 * board.cols + 2 * (board.rows - 2);
+    return filledBits - paddingBits - borderCells;
+}
+
+/**
+ * Sets the board to rows x cols with the given filled and trail planes,
+ * resizing it if needed, and clears the marks. Cells that end up different
+ * are marked dirty (every cell after a resize), so whoever draws the board
+ * only redraws what changed.
+ */
+void loadBoardCells(Board &board, int rows, int cols, const uint64_t *filled, const uint64_t *trail)
+{
+    bool sameSize = board.rows == rows && board.cols == cols;
+    if (!sameSize)
+        board.resize(rows, cols);
+
+    for (int w = 0; w < board.wordCount; w++)
+    {
+        uint64_t changed = ~uint64_t(0);
+        if (sameSize)
+            changed = board.dirty[w] | (board.filled[w] ^ filled[w]) | (board.trail[w] ^ trail[w]);
+        board.filled[w] = filled[w];
+        board.trail[w] = trail[w];
+        board.marked[w] = 0;
+        board.dirty[w] = changed;
+    }
+}
+
+// Makes to a copy of from, dirty cells as loadBoardCells() marks them
+void copyBoard(Board &to, const Board &from)
+{
+    loadBoardCells(to, from.rows, from.cols, from.filled, from.trail);
+    for (int w = 0; w < from.wordCount; w++)
+        to.marked[w] = from.marked[w];
+}
+
+/*
+ * Capture finalisation: whatever the flood fill did not mark is now filled,
+ * that covers the trail and every pocket without an enemy in it. Trail and
+ * marks are cleared for the next capture. Returns the newly filled cells.
+ */
+template <class Size>
+static int finalizeWords(Board &board, Size size, int firstWord)
+{
+    const int wordCount = size.wordCount;
+    int capturedCells = 0;
+
+    for (int w = firstWord; w < wordCount; w++)
+    {
+        uint64_t nowFilled = ~board.marked[w];
+        uint64_t captured = nowFilled & ~board.filled[w];
+        capturedCells += countBits(captured);
+        board.dirty[w] |= captured;
+        board.filled[w] = nowFilled;
+        board.trail[w] = 0;
+        board.marked[w] = 0;
+    }
+    return capturedCells;
+}
+
+#ifdef XONIX_HAS_AVX2_PATH
+// Same as finalizeWords() four words at a time, returns the first word it didn't handle
+__attribute__((target("avx2,popcnt")))
+static int finalizeWordsAvx2(Board &board, int &capturedCells)
+{
+    const __m256i allOnes = _mm256_set1_epi64x(-1);
+    const __m256i zero = _mm256_setzero_si256();
+    int w = 0;
+
+    for (; w + 4 <= board.wordCount; w += 4)
+    {
+        __m256i marked = _mm256_loadu_si256((const __m256i *)(board.marked + w));
+        __m256i filled = _mm256_loadu_si256((const __m256i *)(board.filled + w));
+        __m256i nowFilled = _mm256_xor_si256(marked, allOnes);
+        __m256i captured = _mm256_andnot_si256(filled, nowFilled);
+        __m256i dirty = _mm256_loadu_si256((const __m256i *)(board.dirty + w));
+
+        capturedCells += int(_mm_popcnt_u64(_mm256_extract_epi64(captured, 0)) +
+                             _mm_popcnt_u64(_mm256_extract_epi64(captured, 1)) +
+                             _mm_popcnt_u64(_mm256_extract_epi64(captured, 2)) +
+                             _mm_popcnt_u64(_mm256_extract_epi64(captured, 3)));
+
+        _mm256_storeu_si256((__m256i *)(board.dirty + w), _mm256_or_si256(dirty, captured));
+        _mm256_storeu_si256((__m256i *)(board.filled + w), nowFilled);
+        _mm256_storeu_si256((__m256i *)(board.trail + w), zero);
+        _mm256_storeu_si256((__m256i *)(board.marked + w), zero);
+    }
+    return w;
+}
+#endif
+
+bool captureUsesAvx2()
+{
+#ifdef XONIX_HAS_AVX2_PATH
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    return hasAvx2;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Finishes a capture once floodFill() has marked every cell an enemy can reach.
+ * Marked cells stay empty and everything else becomes filled.
+ * Returns how many cells were newly filled (captured empty cells plus the trail).
+ */
+int finalizeCapture(Board &board)
+{
+    int capturedCells = 0;
+    int firstWord = 0;
+
+#ifdef XONIX_HAS_AVX2_PATH
+    if (captureUsesAvx2())
+        firstWord = finalizeWordsAvx2(board, capturedCells);
+#endif
+
+    // The scalar loop does the whole board without AVX2, or the last few words with it
+    capturedCells += withBoardSize(board, [&board, firstWord](auto size) { return finalizeWords(board, size, firstWord); });
+    return capturedCells;
+}
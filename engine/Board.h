@@ -0,0 +1,176 @@
+#ifndef XONIX_BOARD_H
+#define XONIX_BOARD_H
+
+#include <stdint.h>
+
+const int defaultRows = 25;
+const int defaultCols = 40;
+const int ts = 18; // tile size
+
+// Limits on the board size that can be picked at startup
+const int minBoardRows = 20;    // Enemies spawn at (300, 300) so the board must reach past it
+const int minBoardCols = 20;
+const int maxBoardRows = 4096;
+const int maxBoardCols = 4096;
+
+// Values returned by Board::get()
+const int CELL_MARKED = -1;  // Reached by the flood fill while a capture is being worked out
+const int CELL_EMPTY = 0;
+const int CELL_FILLED = 1;
+const int CELL_TRAIL = 2;    // Tiles the player is still building
+
+const int bitsPerWord = 64;
+
+// Number of set bits in a word
+inline int countBits(uint64_t word)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word != 0; word &= word - 1)
+        count++;
+    return count;
+#endif
+}
+
+// Position of the lowest and highest set bit of a word that isn't zero
+inline int lowestBit(uint64_t word)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while ((word & 1) == 0) { word >>= 1; bit++; }
+    return bit;
+#endif
+}
+
+inline int highestBit(uint64_t word)
+{
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(word);
+#else
+    int bit = 63;
+    while ((word >> 63) == 0) { word <<= 1; bit--; }
+    return bit;
+#endif
+}
+
+/**
+ * Game grid whose size is picked at startup, stored as bitplanes: filled,
+ * trail and marked hold the cell states, and dirty remembers which cells
+ * changed since whoever draws the board last cleared it. Cell (y, x) is
+ * bit y * cols + x of each plane. All planes share one buffer, and the
+ * bits past the last cell are kept filled so whole-word operations never
+ * have to mask them out.
+ */
+struct Board
+{
+    int rows, cols;
+    int wordCount;       // 64 bit words in each plane
+    uint64_t *words;     // The buffer holding all four planes
+    uint64_t *filled;
+    uint64_t *trail;
+    uint64_t *marked;
+    uint64_t *dirty;
+
+    Board();
+    ~Board();
+
+    void resize(int newRows, int newCols);
+
+    static uint64_t bitOf(int index) { return uint64_t(1) << (index % bitsPerWord); }
+
+    bool isFilled(int y, int x) const
+    {
+        int index = y * cols + x;
+        return (filled[index / bitsPerWord] & bitOf(index)) != 0;
+    }
+
+    // Open cells are not filled, not trail and not already marked by the flood fill
+    uint64_t openWord(int w) const
+    {
+        return ~(filled[w] | trail[w] | marked[w]);
+    }
+
+    bool isOpen(int index) const
+    {
+        return (openWord(index / bitsPerWord) & bitOf(index)) != 0;
+    }
+
+    int get(int y, int x) const
+    {
+        int index = y * cols + x;
+        int w = index / bitsPerWord;
+        uint64_t bit = bitOf(index);
+        if (filled[w] & bit) return CELL_FILLED;
+        if (trail[w] & bit) return CELL_TRAIL;
+        if (marked[w] & bit) return CELL_MARKED;
+        return CELL_EMPTY;
+    }
+
+    // Only CELL_EMPTY, CELL_FILLED and CELL_TRAIL are stored this way, marking is done by floodFill()
+    void set(int y, int x, int value)
+    {
+        int index = y * cols + x;
+        int w = index / bitsPerWord;
+        uint64_t bit = bitOf(index);
+        filled[w] &= ~bit;
+        trail[w] &= ~bit;
+        marked[w] &= ~bit;
+        if (value == CELL_FILLED) filled[w] |= bit;
+        if (value == CELL_TRAIL) trail[w] |= bit;
+        dirty[w] |= bit;
+    }
+
+    Board(const Board &) = delete;
+    Board &operator=(const Board &) = delete;
+};
+
+bool isValidBoardSize(int rows, int cols);
+void setBitRange(uint64_t *plane, int first, int last);
+void initializeGrid(Board &board);
+int capturedCellCount(const Board &board);
+void loadBoardCells(Board &board, int rows, int cols, const uint64_t *filled, const uint64_t *trail);
+void copyBoard(Board &to, const Board &from);
+int finalizeCapture(Board &board);
+bool captureUsesAvx2();
+
+/**
+ * Board sizes used by the loops over the whole grid. The common sizes get a
+ * FixedBoardSize where the dimensions and word count are compile time
+ * constants, so the compiler can unroll those loops and use a constant row
+ * stride. Any other size falls back to RuntimeBoardSize.
+ */
+template <int Rows, int Cols>
+struct FixedBoardSize
+{
+    static const int rows = Rows;
+    static const int cols = Cols;
+    static const int wordCount = (Rows * Cols + bitsPerWord - 1) / bitsPerWord;
+};
+
+struct RuntimeBoardSize
+{
+    int rows;
+    int cols;
+    int wordCount;
+};
+
+// Calls function with the most specialised size type that matches the board
+template <class Function>
+auto withBoardSize(const Board &board, Function function) -> decltype(function(RuntimeBoardSize()))
+{
+    if (board.rows == 25 && board.cols == 40)
+        return function(FixedBoardSize<25, 40>());
+    if (board.rows == 50 && board.cols == 80)
+        return function(FixedBoardSize<50, 80>());
+    if (board.rows == 100 && board.cols == 160)
+        return function(FixedBoardSize<100, 160>());
+
+    RuntimeBoardSize size = {board.rows, board.cols, board.wordCount};
+    return function(size);
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef XONIX_BYTE_ORDER_H
+#define XONIX_BYTE_ORDER_H
+
+// Little endian fields of the engine's file headers, written and read through a moving pointer
+
+inline void putBytes(unsigned char *&out, unsigned long long value, int byteCount)
+{
+    for (int i = 0; i < byteCount; i++)
+        *out++ = (unsigned char)(value >> (8 * i));
+}
+
+inline unsigned long long getBytes(const unsigned char *&in, int byteCount)
+{
+    unsigned long long value = 0;
+    for (int i = 0; i < byteCount; i++)
+        value |= (unsigned long long)(*in++) << (8 * i);
+    return value;
+}
+
+#endif
@@ -0,0 +1,456 @@
+#include "Enemy.h"
+#include "Sweep.h"
+#include <cmath>
+#include <cstring>
+
+// AVX2 is picked at runtime so the same binary still runs on CPUs without it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define XONIX_HAS_AVX2_PATH 1
+#endif
+
+// Number of float arrays sharing EnemyPool::data, and of int arrays sharing the motion buffer
+const int floatFieldCount = 10;
+const int intFieldCount = 2;
+
+EnemyPool::EnemyPool()
+{
+    count = capacity = 0;
+    data = 0;
+    x = y = dx = dy = previousX = previousY = speedInitial = timeOfPattern = stepX = stepY = 0;
+    motion = cells = 0;
+    memset(groupStart, 0, sizeof(groupStart));
+    spareData = 0;
+    spareInts = 0;
+    spareCapacity = 0;
+    reserve(initialEnemyCapacity);
+}
+
+EnemyPool::~EnemyPool()
+{
+    delete[] data;
+    delete[] motion;    // cells shares this buffer
+    delete[] spareData;
+    delete[] spareInts;
+}
+
+// Points every field array into the two buffers, capacity entries each
+static void pointFields(EnemyPool &pool, float *data, int *ints, int capacity)
+{
+    pool.data = data;
+    pool.x = data;
+    pool.y = data + capacity;
+    pool.dx = data + capacity * 2;
+    pool.dy = data + capacity * 3;
+    pool.previousX = data + capacity * 4;
+    pool.previousY = data + capacity * 5;
+    pool.speedInitial = data + capacity * 6;
+    pool.timeOfPattern = data + capacity * 7;
+    pool.stepX = data + capacity * 8;
+    pool.stepY = data + capacity * 9;
+    pool.motion = ints;
+    pool.cells = ints + capacity;
+    pool.capacity = capacity;
+}
+
+// Grows the arrays, keeping the enemies already in the pool
+void EnemyPool::reserve(int newCapacity)
+{
+    if (newCapacity <= capacity)
+        return;
+
+    float *oldData = data;
+    int *oldInts = motion;
+    int oldCapacity = capacity;
+    pointFields(*this, new float[newCapacity * floatFieldCount], new int[newCapacity * intFieldCount], newCapacity);
+
+    if (oldData != 0) {
+        for (int f = 0; f < floatFieldCount; f++)
+            memcpy(data + f * newCapacity, oldData + f * oldCapacity, sizeof(float) * count);
+        for (int f = 0; f < intFieldCount; f++)
+            memcpy(motion + f * newCapacity, oldInts + f * oldCapacity, sizeof(int) * count);
+    }
+    delete[] oldData;
+    delete[] oldInts;
+}
+
+void clearEnemies(EnemyPool &pool)
+{
+    pool.count = 0;
+    memset(pool.groupStart, 0, sizeof(pool.groupStart));
+}
+
+// Makes to hold the same enemies as from, in the same order and groups
+void copyEnemies(EnemyPool &to, const EnemyPool &from)
+{
+    to.reserve(from.count);
+    for (int f = 0; f < floatFieldCount; f++)
+        memcpy(to.data + f * to.capacity, from.data + f * from.capacity, sizeof(float) * from.count);
+    memcpy(to.motion, from.motion, sizeof(int) * from.count);
+    to.count = from.count;
+    memcpy(to.groupStart, from.groupStart, sizeof(to.groupStart));
+}
+
+// Copies every field of one enemy over another (the scratch arrays don't need to move)
+static void copyEnemy(EnemyPool &pool, int from, int to)
+{
+    pool.x[to] = pool.x[from];
+    pool.y[to] = pool.y[from];
+    pool.dx[to] = pool.dx[from];
+    pool.dy[to] = pool.dy[from];
+    pool.previousX[to] = pool.previousX[from];
+    pool.previousY[to] = pool.previousY[from];
+    pool.speedInitial[to] = pool.speedInitial[from];
+    pool.timeOfPattern[to] = pool.timeOfPattern[from];
+    pool.motion[to] = pool.motion[from];
+}
+
+/**
+ * Adds an enemy with a random velocity at the spawn point, moving in a
+ * straight line. Returns its index, which stays valid until the pool is sorted
+ * or another enemy is added.
+ */
+int addEnemy(EnemyPool &pool, Random &rng)
+{
+    if (pool.count == pool.capacity)
+        pool.reserve(pool.capacity * 2);
+
+    // Make room at the end of the straight-line group by moving the first enemy of each later group to its end
+    int slot = pool.count;
+    pool.groupStart[numOfMotionGroups]++;
+    for (int g = numOfMotionGroups - 1; g >= 1; g--)
+    {
+        if (pool.groupStart[g] != slot)
+            copyEnemy(pool, pool.groupStart[g], slot);
+        slot = pool.groupStart[g];
+        pool.groupStart[g]++;
+    }
+    pool.count++;
+
+    float dx = float(4 - rng.nextInt(8));
+    float dy = float(4 - rng.nextInt(8));
+
+    // We need to store the initial speed's magnitude
+    float speedInitial = sqrt(dx * dx + dy * dy);
+
+    // We adjust the speed of the enemy if they are 'stationary'
+    if (dx == 0 && dy == 0) {
+      dx = 1;
+      speedInitial = 1;
+    }
+
+    // Enemies used to pick their pattern here. The draw is kept so every later number the game
+    // takes from rng stays where it was: the same seed still spawns the same enemies, which
+    // recorded replays and clients predicting a net match both rely on
+    rng.nextInt(numOfPatterns);
+
+    pool.x[slot] = pool.y[slot] = 300;
+    pool.previousX[slot] = pool.previousY[slot] = 300;
+    pool.dx[slot] = dx;
+    pool.dy[slot] = dy;
+    pool.speedInitial[slot] = speedInitial;
+    pool.timeOfPattern[slot] = 0.0f;
+    pool.motion[slot] = MOTION_LINEAR;
+    return slot;
+}
+
+/**
+ * Puts the enemies back into motion groups after their motion[] entries were
+ * changed. The order inside a group is kept.
+ */
+void sortEnemiesByMotion(EnemyPool &pool)
+{
+    int groupSize[numOfMotionGroups] = {};
+    for (int i = 0; i < pool.count; i++)
+        groupSize[pool.motion[i] + 1]++;
+
+    int next[numOfMotionGroups];
+    pool.groupStart[0] = 0;
+    for (int g = 0; g < numOfMotionGroups; g++) {
+        next[g] = pool.groupStart[g];
+        pool.groupStart[g + 1] = pool.groupStart[g] + groupSize[g];
+    }
+
+    // Scatter into the spare buffers and swap them in, they are only made again when the pool has grown
+    int capacity = pool.capacity;
+    if (pool.spareCapacity != capacity) {
+        delete[] pool.spareData;
+        delete[] pool.spareInts;
+        pool.spareData = new float[capacity * floatFieldCount];
+        pool.spareInts = new int[capacity * intFieldCount];
+        pool.spareCapacity = capacity;
+    }
+    float *oldData = pool.data;
+    int *oldInts = pool.motion;
+    pointFields(pool, pool.spareData, pool.spareInts, capacity);
+    pool.spareData = oldData;
+    pool.spareInts = oldInts;
+
+    for (int i = 0; i < pool.count; i++)
+    {
+        int to = next[oldInts[i] + 1]++;
+        for (int f = 0; f < floatFieldCount; f++)
+            pool.data[f * capacity + to] = oldData[f * capacity + i];
+        pool.motion[to] = oldInts[i];
+    }
+}
+
+/**
+ * Moves enemy i by its step for this tick and bounces it off filled cells.
+ * Patterned enemies also move bounceTime seconds on in their pattern per
+ * bounce. Returns true if it went through the player's trail on the way.
+ */
+static bool moveEnemy(EnemyPool &pool, const Board &board, int i, float bounceTime)
+{
+    // Apply change on the x-axis and check for collisions along the whole step, not just where it ends
+    float startX = pool.x[i];
+    float x = startX + pool.stepX[i];
+    SweepHit hitX = sweepPath(board, startX, pool.y[i], x, pool.y[i]);
+    if (hitX.hit) {
+      pool.dx[i] = -pool.dx[i];
+      x = startX;
+      pool.timeOfPattern[i] += bounceTime;    // Small step in pattern time to avoid getting stuck
+    }
+    pool.x[i] = x;
+
+    float startY = pool.y[i];
+    float y = startY + pool.stepY[i];
+    SweepHit hitY = sweepPath(board, x, startY, x, y);
+    if (hitY.hit) {
+      pool.dy[i] = -pool.dy[i];
+      y = startY;
+      pool.timeOfPattern[i] += bounceTime;
+    }
+    pool.y[i] = y;
+
+    return hitX.crossedTrail || hitY.crossedTrail;
+}
+
+#ifdef XONIX_HAS_AVX2_PATH
+/*
+ * The sweep of sweepPath() along one axis for eight enemies at once. Lanes
+ * move from cell fromCell to toCell in the row (alongX) or column fixedCell.
+ * Returns the lanes that hit a filled cell and adds the ones that went
+ * through trail before it to crossedTrail.
+ */
+__attribute__((target("avx2")))
+static __m256i sweepAxisAvx2(const Board &board, __m256i fromCell, __m256i toCell, __m256i fixedCell,
+                             bool alongX, __m256i &crossedTrail)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i rows = _mm256_set1_epi32(board.rows);
+    const __m256i cols = _mm256_set1_epi32(board.cols);
+    const __m256i wordMask = _mm256_set1_epi32(31);
+
+    __m256i direction = _mm256_sub_epi32(_mm256_cmpgt_epi32(fromCell, toCell), _mm256_cmpgt_epi32(toCell, fromCell));
+    __m256i span = _mm256_abs_epi32(_mm256_sub_epi32(toCell, fromCell));
+    __m256i hit = zero;
+    __m256i cell = fromCell;
+
+    // Step 0 is the start cell, which only counts when the lane never leaves it
+    __m256i active = _mm256_cmpeq_epi32(span, zero);
+    for (int k = 0; ; k++)
+    {
+        __m256i cellX = alongX ? cell : fixedCell;
+        __m256i cellY = alongX ? fixedCell : cell;
+        __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(zero, cellX), _mm256_cmpgt_epi32(cellX, _mm256_sub_epi32(cols, one))),
+                                          _mm256_or_si256(_mm256_cmpgt_epi32(zero, cellY), _mm256_cmpgt_epi32(cellY, _mm256_sub_epi32(rows, one))));
+        __m256i load = _mm256_andnot_si256(outside, active);
+
+        // Cell c is bit c % 32 of the c / 32th 32-bit half word of a plane
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(cellY, cols), cellX);
+        __m256i word = _mm256_srli_epi32(index, 5);
+        __m256i shift = _mm256_and_si256(index, wordMask);
+        __m256i filledWords = _mm256_mask_i32gather_epi32(zero, (const int *)board.filled, word, load, 4);
+        __m256i trailWords = _mm256_mask_i32gather_epi32(zero, (const int *)board.trail, word, load, 4);
+        __m256i isFilled = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(filledWords, shift), one), one);
+        __m256i isTrail = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(trailWords, shift), one), one);
+
+        // Cells outside the board block like the border, filled cells stop the sweep before their trail bit counts
+        __m256i blocked = _mm256_and_si256(active, _mm256_or_si256(outside, isFilled));
+        crossedTrail = _mm256_or_si256(crossedTrail, _mm256_andnot_si256(_mm256_or_si256(outside, isFilled), _mm256_and_si256(load, isTrail)));
+        hit = _mm256_or_si256(hit, blocked);
+
+        // Lanes carry on while they have cells left and haven't hit anything
+        cell = _mm256_add_epi32(cell, direction);
+        active = _mm256_andnot_si256(hit, _mm256_cmpgt_epi32(span, _mm256_set1_epi32(k)));
+        if (_mm256_testz_si256(active, active))
+            return hit;
+    }
+}
+
+// moveEnemy() for eight enemies at a time from first, returns the first enemy it didn't handle
+__attribute__((target("avx2")))
+static int moveEnemiesAvx2(EnemyPool &pool, const Board &board, int first, int end, float bounceTime, bool &crossedTrail)
+{
+    const __m256 tileSize = _mm256_set1_ps(float(ts));
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 bounceStep = _mm256_set1_ps(bounceTime);
+    __m256i trail = _mm256_setzero_si256();
+    int i = first;
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(pool.x + i);
+        __m256 y = _mm256_loadu_ps(pool.y + i);
+        __m256 time = _mm256_loadu_ps(pool.timeOfPattern + i);
+        __m256i cellX = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(x, tileSize)));
+        __m256i cellY = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(y, tileSize)));
+
+        // x-axis first, enemies that hit something stay where they were and turn around
+        __m256 movedX = _mm256_add_ps(x, _mm256_loadu_ps(pool.stepX + i));
+        __m256i endX = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(movedX, tileSize)));
+        __m256 hitX = _mm256_castsi256_ps(sweepAxisAvx2(board, cellX, endX, cellY, true, trail));
+        x = _mm256_blendv_ps(movedX, x, hitX);
+        __m256 dx = _mm256_loadu_ps(pool.dx + i);
+        _mm256_storeu_ps(pool.dx + i, _mm256_xor_ps(dx, _mm256_and_ps(hitX, signBit)));
+        time = _mm256_add_ps(time, _mm256_and_ps(hitX, bounceStep));
+        _mm256_storeu_ps(pool.x + i, x);
+
+        // Then y from the new x
+        cellX = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(x, tileSize)));
+        __m256 movedY = _mm256_add_ps(y, _mm256_loadu_ps(pool.stepY + i));
+        __m256i endY = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(movedY, tileSize)));
+        __m256 hitY = _mm256_castsi256_ps(sweepAxisAvx2(board, cellY, endY, cellX, false, trail));
+        _mm256_storeu_ps(pool.y + i, _mm256_blendv_ps(movedY, y, hitY));
+        __m256 dy = _mm256_loadu_ps(pool.dy + i);
+        _mm256_storeu_ps(pool.dy + i, _mm256_xor_ps(dy, _mm256_and_ps(hitY, signBit)));
+        time = _mm256_add_ps(time, _mm256_and_ps(hitY, bounceStep));
+        _mm256_storeu_ps(pool.timeOfPattern + i, time);
+    }
+
+    if (!_mm256_testz_si256(trail, trail))
+        crossedTrail = true;
+    return i;
+}
+#endif
+
+bool enemyMoveUsesAvx2()
+{
+#ifdef XONIX_HAS_AVX2_PATH
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Steps for this tick of the enemies [first, end) following Pattern. The
+ * pattern is a template argument, so its table is inlined into this loop.
+ */
+template <class Pattern>
+static void patternSteps(EnemyPool &pool, int first, int end, float dt, float scale)
+{
+    const int size = Pattern::table.size;
+    for (int i = first; i < end; i++)
+    {
+        pool.timeOfPattern[i] += dt;
+        int step = int(pool.timeOfPattern[i] * Pattern::stepsPerSecond) % size;
+        pool.stepX[i] = Pattern::table.x[step] * pool.speedInitial[i];
+        pool.stepY[i] = Pattern::table.y[step] * pool.speedInitial[i];
+        pool.stepX[i] *= scale;
+        pool.stepY[i] *= scale;
+    }
+}
+
+// One specialised loop per pattern, each over the group following it
+template <class... Patterns>
+static void allPatternSteps(PatternRegistry<Patterns...>, EnemyPool &pool, float dt, float scale)
+{
+    int g = 1;
+    ((patternSteps<Patterns>(pool, pool.groupStart[g], pool.groupStart[g + 1], dt, scale), g++), ...);
+}
+
+/*
+ * Steps of the hunters: one lookup in the trail distance field gives the
+ * way to the trail from the cell each one is in. Out of its range, or
+ * without a field, they carry on in a straight line, and a hunter that
+ * turned keeps heading that way once the trail is gone.
+ */
+static void hunterSteps(EnemyPool &pool, const Board &board, const TrailDistanceField *trailDistances, float scale)
+{
+    const float headingX[] = {0, -1, 1, 0, 0};
+    const float headingY[] = {0, 0, 0, -1, 1};
+
+    for (int i = pool.groupStart[MOTION_HUNTER + 1]; i < pool.count; i++)
+    {
+        int heading = HEADING_NONE;
+        int x = int(pool.x[i] / ts);
+        int y = int(pool.y[i] / ts);
+        if (trailDistances && x >= 0 && x < board.cols && y >= 0 && y < board.rows)
+            heading = trailHeadingAt(*trailDistances, y * board.cols + x);
+
+        if (heading != HEADING_NONE) {
+            float speed = pool.speedInitial[i] * hunterSpeedFactor;
+            pool.dx[i] = headingX[heading] * speed;
+            pool.dy[i] = headingY[heading] * speed;
+        }
+        pool.stepX[i] = pool.dx[i] * scale;
+        pool.stepY[i] = pool.dy[i] * scale;
+    }
+}
+
+// Moves the enemies [first, end) by their steps, see moveEnemy()
+static bool moveEnemyRange(EnemyPool &pool, const Board &board, int first, int end, float bounceTime)
+{
+    bool crossedTrail = false;
+
+#ifdef XONIX_HAS_AVX2_PATH
+    if (enemyMoveUsesAvx2())
+        first = moveEnemiesAvx2(pool, board, first, end, bounceTime, crossedTrail);
+#endif
+    // The scalar loop does the whole range without AVX2, or the last few enemies with it
+    for (int i = first; i < end; i++)
+        if (moveEnemy(pool, board, i, bounceTime))
+            crossedTrail = true;
+    return crossedTrail;
+}
+
+/**
+ * Moves every enemy for a tick of dt seconds and bounces them off filled
+ * cells. Each motion group works out its steps in its own loop (straight
+ * lines, or one pattern known at compile time), then the moves and bounce
+ * tests run eight enemies at a time where AVX2 is there.
+ * Returns true if any enemy went through the player's trail on the way.
+ */
+bool moveEnemies(EnemyPool &pool, const Board &board, float speedMultiplier, float dt,
+                 const TrailDistanceField *trailDistances)
+{
+    float tickScale = dt * referenceTickRate;    // 1 at 60 ticks per second
+
+    memcpy(pool.previousX, pool.x, sizeof(float) * pool.count);
+    memcpy(pool.previousY, pool.y, sizeof(float) * pool.count);
+
+    // Regular linear movement, the current speed multiplier has to be applied
+    int patternStart = pool.groupStart[1];
+    for (int i = 0; i < patternStart; i++) {
+      pool.stepX[i] = speedMultiplier * pool.dx[i] * tickScale;
+      pool.stepY[i] = speedMultiplier * pool.dy[i] * tickScale;
+    }
+    allPatternSteps(MotionPatterns(), pool, dt, speedMultiplier * tickScale);
+    hunterSteps(pool, board, trailDistances, speedMultiplier * tickScale);
+
+    // Enemies on a pattern bounce off the walls without changing pattern, with a small step in
+    // pattern time to avoid getting stuck. Hunters bounce like straight line enemies
+    int hunterStart = pool.groupStart[MOTION_HUNTER + 1];
+    bool crossedTrail = moveEnemyRange(pool, board, 0, patternStart, 0.0f);
+    if (moveEnemyRange(pool, board, patternStart, hunterStart, 0.25f))
+        crossedTrail = true;
+    if (moveEnemyRange(pool, board, hunterStart, pool.count, 0.0f))
+        crossedTrail = true;
+    return crossedTrail;
+}
+
+// A tick where nobody moves, so drawing between the last two positions keeps them where they are
+void holdEnemies(EnemyPool &pool)
+{
+    memcpy(pool.previousX, pool.x, sizeof(float) * pool.count);
+    memcpy(pool.previousY, pool.y, sizeof(float) * pool.count);
+}
+
+int hunterCount(const EnemyPool &pool)
+{
+    return pool.count - pool.groupStart[MOTION_HUNTER + 1];
+}
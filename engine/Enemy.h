@@ -0,0 +1,64 @@
+#ifndef XONIX_ENEMY_H
+#define XONIX_ENEMY_H
+
+#include "Board.h"
+#include "MotionPatterns.h"
+#include "Random.h"
+#include "TrailDistance.h"
+
+// Enemy speeds are in pixels per tick of the original 60 fps game, they are scaled for other tick rates
+const float referenceTickRate = 60.0f;
+
+const int numOfPatterns = MotionPatterns::count;
+
+// Enemies that don't follow one of the MotionPatterns move in a straight line
+const int MOTION_LINEAR = -1;
+// Hunters head for the player's trail when it is close enough, and move in a straight line otherwise
+const int MOTION_HUNTER = numOfPatterns;
+const int numOfMotionGroups = numOfPatterns + 2;
+const float hunterSpeedFactor = 0.6f;    // Hunters steer at this much of their starting speed
+const int initialEnemyCapacity = 16;
+const int maxEnemyCount = 1000000;    // Stress modes stop here, files and messages with more are rejected
+
+/**
+ * Every enemy of a game, stored as one array per field so a whole group can
+ * be moved in SIMD batches. Enemies are kept sorted by motion: group 0 moves
+ * in straight lines, group g + 1 follows pattern g and the last group hunts,
+ * each group covers [groupStart[g], groupStart[g + 1]). Index i is one enemy
+ * across all arrays.
+ */
+struct EnemyPool
+{
+    int count, capacity;
+    float *data;             // One buffer holding every float array below, capacity entries each
+    float *x, *y, *dx, *dy;  // Floats so speed changes stay smooth
+    float *previousX, *previousY;    // Position before the last move, for drawing between ticks
+    float *speedInitial;     // Magnitude of the starting velocity, patterns are scaled by it
+    float *timeOfPattern;    // Tracks how long it has been since the last pattern change
+    float *stepX, *stepY;    // This tick's movement, scratch for moveEnemies()
+    int *motion;             // MOTION_LINEAR, MOTION_HUNTER or the index of a pattern in MotionPatterns
+    int *cells;              // Flat board index of each enemy, scratch for captures
+    int groupStart[numOfMotionGroups + 1];
+    float *spareData;        // Buffers sortEnemiesByMotion() scatters into and swaps with the live ones
+    int *spareInts;
+    int spareCapacity;
+
+    EnemyPool();
+    ~EnemyPool();
+    void reserve(int newCapacity);
+
+    EnemyPool(const EnemyPool &) = delete;
+    EnemyPool &operator=(const EnemyPool &) = delete;
+};
+
+void clearEnemies(EnemyPool &pool);
+void copyEnemies(EnemyPool &to, const EnemyPool &from);
+int addEnemy(EnemyPool &pool, Random &rng);
+void sortEnemiesByMotion(EnemyPool &pool);
+bool moveEnemies(EnemyPool &pool, const Board &board, float speedMultiplier, float dt,
+                 const TrailDistanceField *trailDistances = 0);
+void holdEnemies(EnemyPool &pool);
+int hunterCount(const EnemyPool &pool);
+bool enemyMoveUsesAvx2();
+
+#endif
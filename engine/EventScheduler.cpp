@@ -0,0 +1,106 @@
+#include "EventScheduler.h"
+#include "GrowArray.h"
+#include <cstring>
+
+EventScheduler::EventScheduler()
+{
+    heap = 0;
+    count = capacity = 0;
+    nextOrder = 0;
+}
+
+EventScheduler::~EventScheduler()
+{
+    delete[] heap;
+}
+
+static bool dueBefore(const ScheduledEvent &a, const ScheduledEvent &b)
+{
+    return a.time < b.time || (a.time == b.time && a.order < b.order);
+}
+
+static void siftUp(EventScheduler &events, int i)
+{
+    ScheduledEvent event = events.heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!dueBefore(event, events.heap[parent]))
+            break;
+        events.heap[i] = events.heap[parent];
+        i = parent;
+    }
+    events.heap[i] = event;
+}
+
+static void siftDown(EventScheduler &events, int i)
+{
+    ScheduledEvent event = events.heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= events.count)
+            break;
+        if (child + 1 < events.count && dueBefore(events.heap[child + 1], events.heap[child]))
+            child++;
+        if (!dueBefore(events.heap[child], event))
+            break;
+        events.heap[i] = events.heap[child];
+        i = child;
+    }
+    events.heap[i] = event;
+}
+
+// Drops every pending event, the heap is kept for the next game
+void clearEvents(EventScheduler &events)
+{
+    events.count = 0;
+    events.nextOrder = 0;
+}
+
+void copyEvents(EventScheduler &to, const EventScheduler &from)
+{
+    loadEvents(to, from.heap, from.count, from.nextOrder);
+}
+
+// Sets the pending events to a heap saved from another scheduler
+void loadEvents(EventScheduler &events, const ScheduledEvent *heap, int count, unsigned int nextOrder)
+{
+    growArray(events.heap, 0, events.capacity, count);
+    if (count > 0)
+        memcpy(events.heap, heap, sizeof(ScheduledEvent) * count);
+    events.count = count;
+    events.nextOrder = nextOrder;
+}
+
+void scheduleEvent(EventScheduler &events, float time, int type, float interval)
+{
+    growArray(events.heap, events.count, events.capacity, events.count + 1);
+    ScheduledEvent &event = events.heap[events.count];
+    event.time = time;
+    event.interval = interval;
+    event.type = type;
+    event.order = events.nextOrder++;
+    siftUp(events, events.count++);
+}
+
+/**
+ * Takes the earliest event if it is due by now, returns false if none is.
+ * A recurring event is put back for its next time before it is returned,
+ * so one that fell more than an interval behind comes up again straight
+ * away.
+ */
+bool popDueEvent(EventScheduler &events, float now, ScheduledEvent &event)
+{
+    if (events.count == 0 || events.heap[0].time > now)
+        return false;
+
+    event = events.heap[0];
+    if (event.interval > 0) {
+        events.heap[0].time += event.interval;
+        events.heap[0].order = events.nextOrder++;
+    }
+    else
+        events.heap[0] = events.heap[--events.count];
+    if (events.count > 0)
+        siftDown(events, 0);
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef XONIX_EVENT_SCHEDULER_H
+#define XONIX_EVENT_SCHEDULER_H
+
+// Timed things the rules react to
+enum GameEventType {
+    EVENT_SPEED_INCREASE,    // Every speedIncreaseInterval, the enemies speed up
+    EVENT_PATTERN_SWITCH,    // Once, half the enemies take up a motion pattern
+    EVENT_FREEZE_END,        // A freeze power-up wears off
+    EVENT_TYPE_COUNT
+};
+
+// One pending event, stored as it is in save states
+struct ScheduledEvent
+{
+    float time;            // Game time it is due at
+    float interval;        // A recurring event is due again this long after it fires, 0 fires once
+    int type;              // GameEventType
+    unsigned int order;    // When it was scheduled, so events due at the same time always fire in the same order
+};
+
+/**
+ * The timed events of one game, in a binary min-heap on the time they are
+ * due. Scheduling an event or firing one costs O(log n), and a tick with
+ * nothing due only looks at the top of the heap, so a game can have
+ * hundreds of effects running and only pay for the ones that end.
+ */
+struct EventScheduler
+{
+    ScheduledEvent *heap;
+    int count, capacity;
+    unsigned int nextOrder;
+
+    EventScheduler();
+    ~EventScheduler();
+
+    EventScheduler(const EventScheduler &) = delete;
+    EventScheduler &operator=(const EventScheduler &) = delete;
+};
+
+void clearEvents(EventScheduler &events);
+void copyEvents(EventScheduler &to, const EventScheduler &from);
+void loadEvents(EventScheduler &events, const ScheduledEvent *heap, int count, unsigned int nextOrder);
+void scheduleEvent(EventScheduler &events, float time, int type, float interval = 0);
+bool popDueEvent(EventScheduler &events, float now, ScheduledEvent &event);
+
+#endif
@@ -0,0 +1,127 @@
+#include "FloodFill.h"
+#include "GrowArray.h"
+#include <cstring>
+
+const int initialSeedCapacity = 64;
+
+FloodFillWorkspace::FloodFillWorkspace()
+{
+    seeds = new int[initialSeedCapacity];
+    capacity = initialSeedCapacity;
+    count = 0;
+}
+
+FloodFillWorkspace::~FloodFillWorkspace()
+{
+    delete[] seeds;
+}
+
+void FloodFillWorkspace::reserve(int newCapacity)
+{
+    growArray(seeds, count, capacity, newCapacity);
+}
+
+// First cell after index, up to limit, that isn't open. Returns limit + 1 if they all are
+static int findBlockedAfter(const Board &board, int index, int limit)
+{
+    for (int i = index + 1; i <= limit; )
+    {
+        int bit = i % bitsPerWord;
+        uint64_t blocked = ~board.openWord(i / bitsPerWord) >> bit;
+        if (blocked != 0) {
+            int found = i + lowestBit(blocked);
+            return found <= limit ? found : limit + 1;
+        }
+        i += bitsPerWord - bit;
+    }
+    return limit + 1;
+}
+
+// Last cell before index, down to limit, that isn't open. Returns limit - 1 if they all are
+static int findBlockedBefore(const Board &board, int index, int limit)
+{
+    for (int i = index - 1; i >= limit; )
+    {
+        int bit = i % bitsPerWord;
+        uint64_t blocked = ~board.openWord(i / bitsPerWord) << (bitsPerWord - 1 - bit);
+        if (blocked != 0) {
+            int found = i - (bitsPerWord - 1 - highestBit(blocked));
+            return found >= limit ? found : limit - 1;
+        }
+        i -= bit + 1;
+    }
+    return limit - 1;
+}
+
+// Pushes one seed for the first cell of every run of open cells between first and last
+static void pushRuns(const Board &board, int first, int last, FloodFillWorkspace &work)
+{
+    bool previousOpen = false;
+    for (int i = first; i <= last; )
+    {
+        int bit = i % bitsPerWord;
+        int length = bitsPerWord - bit;
+        if (length > last - i + 1)
+            length = last - i + 1;
+
+        uint64_t open = board.openWord(i / bitsPerWord) >> bit;
+        if (length < bitsPerWord)
+            open &= (uint64_t(1) << length) - 1;
+
+        // A run starts at every open cell whose left neighbour isn't open
+        uint64_t starts = open & ~((open << 1) | (previousOpen ? 1 : 0));
+        while (starts != 0) {
+            work.push(i + lowestBit(starts));
+            starts &= starts - 1;
+        }
+
+        previousOpen = ((open >> (length - 1)) & 1) != 0;
+        i += length;
+    }
+}
+
+/**
+ * Scanline flood fill that sets the marked bit of every empty cell connected to (y, x).
+ * Each seed is widened into a whole horizontal span first, so rows are walked
+ * left to right instead of jumping around the grid one neighbour at a time,
+ * and the stack only holds one entry per span instead of one per cell.
+ * Spans and runs are found 64 cells at a time from the bitplanes.
+ * Returns how many cells were marked.
+ */
+int floodFill(Board &board, int y, int x, FloodFillWorkspace &work)
+{
+    const int rows = board.rows;
+    const int cols = board.cols;
+    if (y < 0 || y >= rows || x < 0 || x >= cols || !board.isOpen(y * cols + x))
+        return 0;
+
+    int markedCells = 0;
+    work.count = 0;
+    work.push(y * cols + x);
+
+    while (work.count > 0)
+    {
+        int seed = work.seeds[--work.count];
+        int seedY = seed / cols;
+        int rowStart = seedY * cols;
+
+        // A seed can be queued twice by neighbouring spans, the second one finds it already marked
+        if (!board.isOpen(seed))
+            continue;
+
+        // Widen the seed into the whole empty span on this row
+        int left = findBlockedBefore(board, seed, rowStart) + 1 - rowStart;
+        int right = findBlockedAfter(board, seed, rowStart + cols - 1) - 1 - rowStart;
+
+        setBitRange(board.marked, rowStart + left, rowStart + right);
+        markedCells += right - left + 1;
+
+        // Queue the empty runs touching this span on the rows above and below
+        if (seedY > 0)
+            pushRuns(board, rowStart - cols + left, rowStart - cols + right, work);
+        if (seedY < rows - 1)
+            pushRuns(board, rowStart + cols + left, rowStart + cols + right, work);
+    }
+
+    return markedCells;
+}
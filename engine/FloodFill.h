@@ -0,0 +1,34 @@
+#ifndef XONIX_FLOOD_FILL_H
+#define XONIX_FLOOD_FILL_H
+
+#include "Board.h"
+
+/**
+ * Stack of seed cells used by floodFill(). It is kept between captures so
+ * the fill doesn't allocate while the game is running, and only grows when
+ * a bigger board needs more room than it had.
+ */
+struct FloodFillWorkspace
+{
+    int *seeds;      // Flat cell indexes (y * cols + x) still waiting to be scanned
+    int capacity;
+    int count;
+
+    FloodFillWorkspace();
+    ~FloodFillWorkspace();
+
+    void reserve(int newCapacity);
+    void push(int index)
+    {
+        if (count == capacity)
+            reserve(capacity * 2);
+        seeds[count++] = index;
+    }
+
+    FloodFillWorkspace(const FloodFillWorkspace &) = delete;
+    FloodFillWorkspace &operator=(const FloodFillWorkspace &) = delete;
+};
+
+int floodFill(Board &board, int y, int x, FloodFillWorkspace &work);
+
+#endif
@@ -0,0 +1,94 @@
+#include "FrameHandoff.h"
+#include "SimulationClock.h"
+
+const int frameFreshBit = 4;    // Set in shared next to the slot index while that slot is a new frame
+
+FrameSnapshot::FrameSnapshot()
+{
+    sequence = 0;
+    gameNumber = 0;
+    running = false;
+    tickSeconds = 1.0f / defaultTickRate;
+    playerX = playerY = 0;
+    moveCounter = 0;
+    elapsedTime = 0;
+    speedMultiplier = 1;
+    mapRow = mapCol = 0;
+    hasOpponent = false;
+    opponentX = opponentY = 0;
+    showScores = false;
+    netText[0] = scoresText[0] = tickProfileText[0] = '\0';
+}
+
+FrameHandoff::FrameHandoff()
+{
+    back = 0;
+    shared = 1;
+    front = 2;
+    published = 0;
+    dropped = 0;
+    shown = 0;
+    repeated = 0;
+}
+
+// The slot the simulation fills next, nobody else looks at it until publishFrame()
+FrameSnapshot &backFrame(FrameHandoff &handoff)
+{
+    return handoff.slots[handoff.back];
+}
+
+// Copies what is drawn of game into frame, the text and the opponent are left to the caller
+void captureFrame(FrameSnapshot &frame, const Game &game)
+{
+    copyBoard(frame.board, game.board);
+    copyEnemies(frame.enemies, game.enemies);
+    frame.playerX = game.playerX;
+    frame.playerY = game.playerY;
+    frame.moveCounter = game.moveCounter;
+    frame.elapsedTime = game.elapsedTime;
+    frame.speedMultiplier = game.speedMultiplier;
+}
+
+/**
+ * Hands the back slot over as the newest frame and takes the shared slot
+ * as the next back slot. If the renderer never took the frame that was
+ * there it is dropped.
+ */
+void publishFrame(FrameHandoff &handoff)
+{
+    long long sequence = handoff.published.load(std::memory_order_relaxed);
+    handoff.slots[handoff.back].sequence = sequence;
+
+    // Release makes the slot's contents visible to the renderer that takes it
+    int previous = handoff.shared.exchange(handoff.back | frameFreshBit, std::memory_order_acq_rel);
+    if (previous & frameFreshBit)
+        handoff.dropped.fetch_add(1, std::memory_order_relaxed);
+    handoff.back = previous & ~frameFreshBit;
+    handoff.published.store(sequence + 1, std::memory_order_relaxed);
+}
+
+// Swaps in the newest frame if there is one the renderer hasn't had, returns whether there was
+bool takeLatestFrame(FrameHandoff &handoff)
+{
+    if ((handoff.shared.load(std::memory_order_relaxed) & frameFreshBit) == 0)
+        return false;
+    int previous = handoff.shared.exchange(handoff.front, std::memory_order_acq_rel);
+    handoff.front = previous & ~frameFreshBit;
+    return true;
+}
+
+// The frame the renderer holds, it stays the same until takeLatestFrame() returns true
+const FrameSnapshot &frontFrame(const FrameHandoff &handoff)
+{
+    return handoff.slots[handoff.front];
+}
+
+void writeFrameHandoffReport(const FrameHandoff &handoff, std::ostream &out)
+{
+    long long published = handoff.published.load();
+    long long dropped = handoff.dropped.load();
+    out << "Frames: " << published << " published by the simulation, " << dropped << " dropped ("
+        << (published > 0 ? 100.0 * dropped / published : 0) << "%), " << handoff.shown << " drawn, "
+        << handoff.repeated << " repeated (" << (handoff.shown > 0 ? 100.0 * handoff.repeated / handoff.shown : 0)
+        << "%)" << std::endl;
+}
@@ -0,0 +1,82 @@
+#ifndef XONIX_FRAME_HANDOFF_H
+#define XONIX_FRAME_HANDOFF_H
+
+#include "FrameProfiler.h"
+#include "Game.h"
+#include <atomic>
+#include <ostream>
+
+const int frameSlotCount = 3;
+const int maxFrameTextLength = 384;    // Same as the longest HUD field
+
+/**
+ * Everything the window draws of a game, as the simulation thread left it
+ * after a batch of ticks: the board planes, the player, the enemies with
+ * their positions one tick back for interpolation, the HUD values and the
+ * text the simulation formats for the HUD. Once published it isn't
+ * written again until the renderer hands it back.
+ */
+struct FrameSnapshot
+{
+    long long sequence;       // Frames published before this one
+    int gameNumber;           // Which game it shows, a new game or a restored one gets a new number
+    bool running;             // False once the game is over
+    ProfileClock::time_point publishedAt;
+    float tickSeconds;
+
+    Board board;
+    EnemyPool enemies;
+    int playerX, playerY;
+    int moveCounter;
+    float elapsedTime, speedMultiplier;
+    int mapRow, mapCol;       // On a big map, the cell the board's top left corner is on
+
+    bool hasOpponent;         // Online, the first opponent's board as of the last server snapshot
+    Board opponent;
+    int opponentX, opponentY;
+
+    bool showScores;
+    char netText[maxFrameTextLength + 1];
+    char scoresText[maxFrameTextLength + 1];
+    char tickProfileText[maxFrameTextLength + 1];    // The simulation's rows of the timings overlay
+
+    FrameSnapshot();
+};
+
+/**
+ * Lock-free triple buffer between one simulation thread and one render
+ * thread. The simulation fills the back slot and swaps it with the shared
+ * one; the renderer swaps the shared slot with its front slot when it holds
+ * a frame it hasn't seen. Neither side ever waits on the other: a frame the
+ * renderer didn't get to in time is dropped for the newer one, and a render
+ * frame without a new snapshot draws the last one again.
+ */
+struct FrameHandoff
+{
+    FrameSnapshot slots[frameSlotCount];
+    int back;                         // Only touched by the simulation thread
+    int front;                        // Only touched by the render thread
+    std::atomic<int> shared;          // Slot in the middle, frameFreshBit while the renderer hasn't taken it
+
+    std::atomic<long long> published;
+    std::atomic<long long> dropped;   // Published frames swapped out again before the renderer took them
+    long long shown;                  // Render frames drawn
+    long long repeated;               // Render frames drawn again from a frame already shown
+
+    FrameHandoff();
+
+    FrameHandoff(const FrameHandoff &) = delete;
+    FrameHandoff &operator=(const FrameHandoff &) = delete;
+};
+
+// Simulation side
+FrameSnapshot &backFrame(FrameHandoff &handoff);
+void captureFrame(FrameSnapshot &frame, const Game &game);
+void publishFrame(FrameHandoff &handoff);
+
+// Render side
+bool takeLatestFrame(FrameHandoff &handoff);
+const FrameSnapshot &frontFrame(const FrameHandoff &handoff);
+void writeFrameHandoffReport(const FrameHandoff &handoff, std::ostream &out);
+
+#endif
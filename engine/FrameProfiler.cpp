@@ -0,0 +1,159 @@
+#include "FrameProfiler.h"
+#include <fstream>
+
+const char *const phaseNames[PHASE_COUNT + 1] = {
+    "events", "timers", "player", "enemies", "capture", "collisions", "hud", "render", "present", "frame"
+};
+
+const int profileColumns = PHASE_COUNT + 1;
+
+static double millisecondsSince(ProfileClock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(ProfileClock::now() - start).count();
+}
+
+FrameProfiler::FrameProfiler()
+{
+    capacity = 0;
+    samples = sortScratch = 0;
+    resetFrameProfiler(*this);
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    delete[] samples;
+    delete[] sortScratch;
+}
+
+ProfileScope::ProfileScope(FrameProfiler *profiler, ProfilePhase phase)
+    : profiler(profiler), phase(phase)
+{
+    if (profiler)
+        start = ProfileClock::now();
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (profiler)
+        addPhaseTime(*profiler, phase, start);
+}
+
+// Adds the time since start to a phase, for code that can't be wrapped in a ProfileScope block
+void addPhaseTime(FrameProfiler &profiler, ProfilePhase phase, ProfileClock::time_point start)
+{
+    profiler.current[phase] += millisecondsSince(start);
+}
+
+// Forgets every recorded frame, the buffers are only reallocated when the capacity changes
+void resetFrameProfiler(FrameProfiler &profiler, int capacity)
+{
+    if (capacity != profiler.capacity) {
+        delete[] profiler.samples;
+        delete[] profiler.sortScratch;
+        profiler.samples = new float[capacity * profileColumns];
+        profiler.sortScratch = new float[capacity];
+        profiler.capacity = capacity;
+    }
+    profiler.frameCount = 0;
+    for (int p = 0; p < PHASE_COUNT; p++)
+        profiler.current[p] = 0;
+    profiler.frameStart = ProfileClock::now();
+}
+
+void beginProfiledFrame(FrameProfiler &profiler)
+{
+    for (int p = 0; p < PHASE_COUNT; p++)
+        profiler.current[p] = 0;
+    profiler.frameStart = ProfileClock::now();
+}
+
+// Stores the phases timed since beginProfiledFrame() as the newest row of the ring
+void endProfiledFrame(FrameProfiler &profiler)
+{
+    float *row = profiler.samples + (profiler.frameCount % profiler.capacity) * profileColumns;
+    for (int p = 0; p < PHASE_COUNT; p++)
+        row[p] = float(profiler.current[p]);
+    row[PHASE_COUNT] = float(millisecondsSince(profiler.frameStart));
+    profiler.frameCount++;
+}
+
+// How many rows of the ring hold frames
+int profiledFrames(const FrameProfiler &profiler)
+{
+    return profiler.frameCount < profiler.capacity ? int(profiler.frameCount) : profiler.capacity;
+}
+
+// Puts the k-th smallest value at values[k] (quickselect), the rest ends up on the correct side of it
+static void selectKth(float *values, int count, int k)
+{
+    int low = 0, high = count - 1;
+    while (low < high)
+    {
+        float pivot = values[(low + high) / 2];
+        int i = low, j = high;
+        while (i <= j) {
+            while (values[i] < pivot) i++;
+            while (values[j] > pivot) j--;
+            if (i <= j) {
+                float swap = values[i];
+                values[i] = values[j];
+                values[j] = swap;
+                i++;
+                j--;
+            }
+        }
+        if (k <= j) high = j;
+        else if (k >= i) low = i;
+        else return;
+    }
+}
+
+// Nearest-rank percentile (0-100) of count values, which get reordered
+float percentileOf(float *values, int count, float percentile)
+{
+    if (count == 0)
+        return 0;
+
+    int rank = int(percentile / 100 * count + 0.5f) - 1;
+    if (rank < 0) rank = 0;
+    if (rank > count - 1) rank = count - 1;
+    selectKth(values, count, rank);
+    return values[rank];
+}
+
+/**
+ * Nearest-rank percentile (0-100) in milliseconds of one phase over the
+ * frames in the ring, column PHASE_COUNT is the whole frame
+ */
+float phasePercentile(FrameProfiler &profiler, int column, float percentile)
+{
+    int count = profiledFrames(profiler);
+    for (int f = 0; f < count; f++)
+        profiler.sortScratch[f] = profiler.samples[f * profileColumns + column];
+    return percentileOf(profiler.sortScratch, count, percentile);
+}
+
+// Writes the frames in the ring, oldest first, one row per frame with every phase in milliseconds
+bool writeProfileCsv(const FrameProfiler &profiler, const char *path)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+
+    out << "frame";
+    for (int p = 0; p < profileColumns; p++)
+        out << "," << phaseNames[p] << "_ms";
+    out << "\n";
+
+    int count = profiledFrames(profiler);
+    long long first = profiler.frameCount - count;
+    for (long long f = first; f < profiler.frameCount; f++)
+    {
+        const float *row = profiler.samples + (f % profiler.capacity) * profileColumns;
+        out << f;
+        for (int p = 0; p < profileColumns; p++)
+            out << "," << row[p];
+        out << "\n";
+    }
+    return bool(out);
+}
@@ -0,0 +1,67 @@
+#ifndef XONIX_FRAME_PROFILER_H
+#define XONIX_FRAME_PROFILER_H
+
+#include <chrono>
+
+// The parts of a frame that are timed separately, PHASE_COUNT is also the column of the whole frame
+enum ProfilePhase {
+    PHASE_EVENTS,        // Window events and keyboard
+    PHASE_TIMERS,        // Elapsed time, speed increases and pattern switches
+    PHASE_PLAYER,        // Player steps and trail
+    PHASE_ENEMIES,       // Enemy moves and bounces
+    PHASE_CAPTURE,       // Turning a closed trail into filled cells
+    PHASE_COLLISIONS,    // Enemies sitting on the trail
+    PHASE_HUD,           // Updating the HUD strings
+    PHASE_RENDER,        // Board, sprites and text
+    PHASE_PRESENT,       // Waiting on display() (frame limit and vsync)
+    PHASE_COUNT
+};
+
+extern const char *const phaseNames[PHASE_COUNT + 1];
+
+const int defaultProfileFrames = 1024;
+
+typedef std::chrono::steady_clock ProfileClock;
+
+/**
+ * Keeps the time of every phase for the last capacity frames in a ring.
+ * Phases can be timed several times in a frame (one game tick each), their
+ * times add up until the frame ends.
+ */
+struct FrameProfiler
+{
+    int capacity;
+    long long frameCount;       // Frames ended so far, the newest is row (frameCount - 1) % capacity
+    float *samples;             // capacity rows of PHASE_COUNT + 1 milliseconds, the last one is the whole frame
+    float *sortScratch;         // One column copied out for percentiles
+    double current[PHASE_COUNT];
+    ProfileClock::time_point frameStart;
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+    FrameProfiler(const FrameProfiler &) = delete;
+    FrameProfiler &operator=(const FrameProfiler &) = delete;
+};
+
+// Times the rest of the enclosing block as one phase, does nothing without a profiler
+struct ProfileScope
+{
+    FrameProfiler *profiler;
+    ProfilePhase phase;
+    ProfileClock::time_point start;
+
+    ProfileScope(FrameProfiler *profiler, ProfilePhase phase);
+    ~ProfileScope();
+};
+
+void resetFrameProfiler(FrameProfiler &profiler, int capacity = defaultProfileFrames);
+void beginProfiledFrame(FrameProfiler &profiler);
+void endProfiledFrame(FrameProfiler &profiler);
+void addPhaseTime(FrameProfiler &profiler, ProfilePhase phase, ProfileClock::time_point start);
+int profiledFrames(const FrameProfiler &profiler);
+float percentileOf(float *values, int count, float percentile);
+float phasePercentile(FrameProfiler &profiler, int column, float percentile);
+bool writeProfileCsv(const FrameProfiler &profiler, const char *path);
+
+#endif
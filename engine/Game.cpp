@@ -0,0 +1,307 @@
+#include "Game.h"
+
+// Slack for float rounding, so five 60 Hz ticks always add up to one step
+const float stepTimeTolerance = 1e-4f;
+
+// Easy has 2 enemies, medium 4 and hard 6
+int enemyCountForDifficulty(int difficultyLevel)
+{
+    if (difficultyLevel == 2)
+        return 4;
+    if (difficultyLevel == 3)
+        return 6;
+    return 2;
+}
+
+/**
+ * Resets the grid, the player, the enemies and all timers for a new game
+ * on a board of rows x cols cells (see isValidBoardSize()). An enemyCount
+ * of 0 uses the count for the difficulty, anything else is a stress mode.
+ * The last hunters of the enemies hunt the trail instead of moving in
+ * straight lines.
+ */
+void startGame(Game &game, int difficultyLevel, unsigned int seed, int rows, int cols, int enemyCount, int hunters)
+{
+    game.rng.seed(seed);
+    game.difficultyLevel = difficultyLevel;
+    if (enemyCount <= 0)
+        enemyCount = enemyCountForDifficulty(difficultyLevel);
+
+    game.board.resize(rows, cols);
+    initializeGrid(game.board);
+    resetRegions(game.regions, game.board);
+    resetTrailDistances(game.trailDistances, game.board);
+    resetGameStats(game.stats, game.board);
+    game.captureMode = CAPTURE_REGIONS;
+
+    clearEnemies(game.enemies);
+    game.enemies.reserve(enemyCount);
+    for (int i = 0; i < enemyCount; i++)
+        addEnemy(game.enemies, game.rng);
+    if (hunters > 0) {
+        int firstHunter = hunters < enemyCount ? enemyCount - hunters : 0;
+        for (int i = firstHunter; i < enemyCount; i++)
+            game.enemies.motion[i] = MOTION_HUNTER;
+        sortEnemiesByMotion(game.enemies);
+    }
+
+    game.playerX = 10;
+    game.playerY = 0;
+    game.moveX = game.moveY = 0;
+    game.playerTimer = 0;
+    game.moveCounter = 0;
+    game.prevOnBorder = true;
+    game.running = true;
+
+    game.elapsedTime = 0.0f;
+    game.speedMultiplier = 1.0f;
+    game.freezeEffects = 0;
+    clearEvents(game.events);
+    scheduleEvent(game.events, speedIncreaseInterval, EVENT_SPEED_INCREASE, speedIncreaseInterval);
+    scheduleEvent(game.events, patternSwitchInterval, EVENT_PATTERN_SWITCH);
+}
+
+/**
+ * Makes to an exact copy of from, so that both play out the same from here
+ * on given the same input. Used to roll a predicted game back to the last
+ * state the server confirmed.
+ */
+void copyGame(Game &to, const Game &from)
+{
+    copyBoard(to.board, from.board);
+    copyEnemies(to.enemies, from.enemies);
+    copyRegions(to.regions, from.regions);
+    copyTrailDistances(to.trailDistances, from.trailDistances);
+    to.difficultyLevel = from.difficultyLevel;
+
+    to.playerX = from.playerX;
+    to.playerY = from.playerY;
+    to.moveX = from.moveX;
+    to.moveY = from.moveY;
+    to.playerTimer = from.playerTimer;
+    to.moveCounter = from.moveCounter;
+    to.prevOnBorder = from.prevOnBorder;
+    to.running = from.running;
+
+    to.elapsedTime = from.elapsedTime;
+    to.speedMultiplier = from.speedMultiplier;
+    copyEvents(to.events, from.events);
+    to.freezeEffects = from.freezeEffects;
+
+    to.rng = from.rng;
+    to.captureMode = from.captureMode;
+    to.stats = from.stats;
+}
+
+void updateElapsedTimer(Game &game, float dt)
+{
+    game.elapsedTime += dt;
+}
+
+// This function switches the motion pattern of half the enemy sprites
+void switchEnemyPattern(Game &game)
+{
+    // Calculate half the enemy count to switch
+    int halfOfEnemies = game.enemies.count / 2;
+
+    // Switch the movement of the calculated half, nobody has switched yet so they are still in spawn order.
+    // Hunters come last and keep hunting
+    for (int i = 0; i < halfOfEnemies; i++) {
+      if (game.enemies.motion[i] != MOTION_LINEAR)
+        continue;
+
+      // The pattern assigned to each enemy will alternate
+      game.enemies.motion[i] = i % numOfPatterns;
+
+      // After switching, reset the timer
+      game.enemies.timeOfPattern[i] = 0;
+    }
+    sortEnemiesByMotion(game.enemies);
+}
+
+/**
+ * Holds every enemy still for the next seconds of game time. Freezes that
+ * overlap each run out on their own, the enemies move again once the last
+ * one has.
+ */
+void freezeEnemies(Game &game, float seconds)
+{
+    game.freezeEffects++;
+    scheduleEvent(game.events, game.elapsedTime + seconds, EVENT_FREEZE_END);
+}
+
+// Fires every event that has come due by the game clock, in the order they were due
+static void runDueEvents(Game &game, TickResult &result)
+{
+    ScheduledEvent event;
+    while (popDueEvent(game.events, game.elapsedTime, event)) {
+        switch (event.type) {
+        case EVENT_SPEED_INCREASE:
+            // Keeping an upper limit so that speed does not increase infinitely
+            game.speedMultiplier += speedFactor;
+            if (game.speedMultiplier > maxSpeedMultiplier)
+                game.speedMultiplier = maxSpeedMultiplier;
+            break;
+        case EVENT_PATTERN_SWITCH:
+            switchEnemyPattern(game);
+            result.patternSwitched = true;
+            break;
+        case EVENT_FREEZE_END:
+            game.freezeEffects--;
+            break;
+        }
+    }
+}
+
+// Moves the player one cell and lays down trail
+static void stepPlayer(Game &game)
+{
+    // We create variables that store the player's previous to ensure that it has actually moved to count moves
+    int previousX = game.playerX;
+    int previousY = game.playerY;
+
+    // Moving the player
+    game.playerX += game.moveX;
+    game.playerY += game.moveY;
+
+    // Handle boundaries
+    if (game.playerX < 0) game.playerX = 0;
+    if (game.playerX > game.board.cols - 1) game.playerX = game.board.cols - 1;
+    if (game.playerY < 0) game.playerY = 0;
+    if (game.playerY > game.board.rows - 1) game.playerY = game.board.rows - 1;
+
+    int cell = game.board.get(game.playerY, game.playerX);
+
+    // MOVEMENT TRACKING - Starts when player moves from border to unmarked space
+    bool nowOnBorder = (cell == CELL_FILLED);
+
+    // If the player was on a marked grid and now on unmarked one, this counts as a move
+    bool moved = (previousX != game.playerX || previousY != game.playerY);
+    if (moved && game.prevOnBorder && cell == CELL_EMPTY)
+        game.moveCounter++;
+
+    game.prevOnBorder = nowOnBorder;
+
+    // Check collisions
+    if (cell == CELL_TRAIL)
+        game.running = false;
+    if (cell == CELL_EMPTY) {
+        int index = game.playerY * game.board.cols + game.playerX;
+        game.board.set(game.playerY, game.playerX, CELL_TRAIL);
+        addTrailCell(game.regions, index);
+        noteTrailCell(game.stats);
+        if (hunterCount(game.enemies) > 0)
+            addTrailSource(game.trailDistances, game.board, index);
+    }
+}
+
+/**
+ * Fills the trail the player just closed and every pocket without an enemy,
+ * returns how many cells were filled
+ */
+static int captureArea(Game &game)
+{
+    if (game.captureMode == CAPTURE_FULL_BOARD) {
+        // Fill areas
+        for (int i = 0; i < game.enemies.count; i++)
+            floodFill(game.board, int(game.enemies.y[i] / ts), int(game.enemies.x[i] / ts), game.fillWork);
+
+        game.regions.trailCount = 0;
+        return finalizeCapture(game.board);
+    }
+
+    // Enemies outside the board protect nothing (the sweep keeps them in, this is only a safety net)
+    EnemyPool &enemies = game.enemies;
+    for (int i = 0; i < enemies.count; i++)
+    {
+        int y = int(enemies.y[i] / ts);
+        int x = int(enemies.x[i] / ts);
+        bool inside = y >= 0 && y < game.board.rows && x >= 0 && x < game.board.cols;
+        enemies.cells[i] = inside ? y * game.board.cols + x : -1;
+    }
+    return captureTrail(game.regions, game.board, enemies.cells, enemies.count);
+}
+
+/**
+ * Advances the game by dt seconds: timers, one player step when it is due,
+ * enemy movement, area capture and collisions. Each of those is timed into
+ * profiler when there is one.
+ */
+TickResult updateGame(Game &game, float dt, Direction input, FrameProfiler *profiler)
+{
+    TickResult result = {};
+
+    if (!game.running) {
+        result.gameOver = true;
+        return result;
+    }
+
+    {
+        ProfileScope scope(profiler, PHASE_TIMERS);
+        updateElapsedTimer(game, dt);
+        runDueEvents(game, result);
+    }
+
+    int trailBefore = game.regions.trailCount;
+    {
+        ProfileScope scope(profiler, PHASE_PLAYER);
+
+        // Handle input for movement
+        if (input == DIR_LEFT)  { game.moveX = -1; game.moveY = 0; }
+        if (input == DIR_RIGHT) { game.moveX = 1; game.moveY = 0; }
+        if (input == DIR_UP)    { game.moveX = 0; game.moveY = -1; }
+        if (input == DIR_DOWN)  { game.moveX = 0; game.moveY = 1; }
+
+        // Update player position, the leftover time is kept so the step rate doesn't depend on the tick rate
+        game.playerTimer += dt;
+        if (game.playerTimer + stepTimeTolerance >= playerStepInterval)
+        {
+            stepPlayer(game);
+            game.playerTimer -= playerStepInterval;
+            if (game.playerTimer < 0)
+                game.playerTimer = 0;
+            result.playerStepped = true;
+        }
+    }
+
+    {
+        // Move enemies by the current speed multiplier
+        ProfileScope scope(profiler, PHASE_ENEMIES);
+        if (game.freezeEffects > 0)
+            holdEnemies(game.enemies);
+        else if (moveEnemies(game.enemies, game.board, game.speedMultiplier, dt, &game.trailDistances))
+            game.running = false;    // One ran through the trail somewhere along this tick
+        checkNearMisses(game.stats, game.board, game.enemies, game.regions.trailCells + trailBefore,
+                        game.regions.trailCount - trailBefore);
+    }
+
+    // Check if player completed a section
+    if (game.board.isFilled(game.playerY, game.playerX))
+    {
+        game.moveX = game.moveY = 0;
+
+        if (game.regions.trailCount > 0) {
+            ProfileScope scope(profiler, PHASE_CAPTURE);
+            result.capturedCells = captureArea(game);
+            result.captured = true;
+            noteCapture(game.stats, result.capturedCells);
+            clearTrailDistances(game.trailDistances);    // The trail is filled now, there is nothing to hunt
+        }
+    }
+
+    {
+        // Check player-enemy collisions, an enemy off the board can't reach the trail
+        ProfileScope scope(profiler, PHASE_COLLISIONS);
+        for (int i = 0; i < game.enemies.count; i++)
+        {
+            int y = int(game.enemies.y[i] / ts);
+            int x = int(game.enemies.x[i] / ts);
+            bool inside = y >= 0 && y < game.board.rows && x >= 0 && x < game.board.cols;
+            if (inside && game.board.get(y, x) == CELL_TRAIL)
+                game.running = false;
+        }
+    }
+
+    result.gameOver = !game.running;
+    return result;
+}
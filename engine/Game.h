@@ -0,0 +1,84 @@
+#ifndef XONIX_GAME_H
+#define XONIX_GAME_H
+
+#include "Board.h"
+#include "Enemy.h"
+#include "EventScheduler.h"
+#include "FloodFill.h"
+#include "FrameProfiler.h"
+#include "GameStats.h"
+#include "Random.h"
+#include "Regions.h"
+#include "TrailDistance.h"
+
+const float playerStepInterval = 1.0f / 12.0f;   // The player steps 12 times a second, as it did at 60 fps
+
+// Speed increase variables
+const float speedFactor = 0.5f;    // Enemy speed will increase every 20s by a factor of 0.5
+const float speedIncreaseInterval = 20.0f;
+const float maxSpeedMultiplier = 4.0f;
+// Variables for enemy pattern switching
+const float patternSwitchInterval = 30.0f;    // The threshold time interval to switch the pattern
+// Power-ups
+const float freezeDuration = 3.0f;    // Seconds a freeze holds the enemies still
+
+// How a committed trail is turned into filled cells
+enum CaptureMode {
+    CAPTURE_REGIONS,      // Only explore the pockets next to the trail (the default)
+    CAPTURE_FULL_BOARD    // Flood fill from every enemy and rewrite the whole board, kept to cross-check the above
+};
+
+// Direction requested by the player for this tick, DIR_NONE keeps the current one
+enum Direction { DIR_NONE, DIR_LEFT, DIR_RIGHT, DIR_UP, DIR_DOWN };
+
+/**
+ * Everything the rules need to play one game. Nothing in here knows about
+ * SFML, so the same state is driven by the window in main.cpp and by the
+ * headless tools.
+ */
+struct Game
+{
+    Board board;
+    EnemyPool enemies;
+    int difficultyLevel;
+
+    int playerX, playerY;
+    int moveX, moveY;
+    float playerTimer;     // Time gathered towards the next player step
+    int moveCounter;
+    bool prevOnBorder;     // Whether the player stood on marked territory at the last step
+    bool running;
+
+    float elapsedTime;
+    float speedMultiplier;
+    EventScheduler events;    // Speed increases, the pattern switch and power-ups wearing off, on the elapsedTime clock
+    int freezeEffects;        // Freezes still running, the enemies stand still while there are any
+
+    Random rng;
+    RegionTracker regions;
+    TrailDistanceField trailDistances;    // Only kept up to date when there are hunters
+    CaptureMode captureMode;
+    FloodFillWorkspace fillWork;    // Reused by full board captures so filling never allocates mid-game
+    GameStats stats;
+};
+
+// What happened during one call to updateGame(), so callers can react without diffing the state
+struct TickResult
+{
+    bool playerStepped;
+    bool patternSwitched;
+    bool captured;
+    int capturedCells;
+    bool gameOver;
+};
+
+int enemyCountForDifficulty(int difficultyLevel);
+void startGame(Game &game, int difficultyLevel, unsigned int seed,
+               int rows = defaultRows, int cols = defaultCols, int enemyCount = 0, int hunters = 0);
+void copyGame(Game &to, const Game &from);
+void updateElapsedTimer(Game &game, float dt);
+void switchEnemyPattern(Game &game);
+void freezeEnemies(Game &game, float seconds = freezeDuration);
+TickResult updateGame(Game &game, float dt, Direction input, FrameProfiler *profiler = 0);
+
+#endif
@@ -0,0 +1,105 @@
+#include "GameStats.h"
+#include <cstdlib>
+
+// Filled cells on the board, not counting the padding bits past the last cell
+int countFilledCells(const Board &board)
+{
+    int filledBits = 0;
+    for (int w = 0; w < board.wordCount; w++)
+        filledBits += countBits(board.filled[w]);
+    return filledBits - (board.wordCount * bitsPerWord - board.rows * board.cols);
+}
+
+// Starts the totals of a new game on board
+void resetGameStats(GameStats &stats, const Board &board)
+{
+    stats.cellCount = board.rows * board.cols;
+    stats.filledCells = stats.startFilled = countFilledCells(board);
+    stats.trailLength = 0;
+    stats.longestTrail = 0;
+    stats.captures = 0;
+    stats.capturedCells = 0;
+    stats.nearMisses = 0;
+    stats.trailThreatened = false;
+}
+
+/**
+ * Counts the filled cells again after the whole board was replaced, moving
+ * the starting count with them so the cells captured so far still count.
+ */
+void recountFilledCells(GameStats &stats, const Board &board)
+{
+    int captured = stats.filledCells - stats.startFilled;
+    stats.cellCount = board.rows * board.cols;
+    stats.filledCells = countFilledCells(board);
+    stats.startFilled = stats.filledCells - captured;
+}
+
+// The player turned an empty cell into trail
+void noteTrailCell(GameStats &stats)
+{
+    stats.trailLength++;
+    if (stats.trailLength > stats.longestTrail)
+        stats.longestTrail = stats.trailLength;
+}
+
+// The trail was closed and capturedCells cells were filled, the trail among them
+void noteCapture(GameStats &stats, int capturedCells)
+{
+    stats.captures++;
+    stats.capturedCells += capturedCells;
+    stats.filledCells += capturedCells;
+    stats.trailLength = 0;
+    if (stats.trailThreatened)
+        stats.nearMisses++;
+    stats.trailThreatened = false;
+}
+
+static bool trailWithin(const Board &board, int y, int x, int distance)
+{
+    for (int ny = y - distance; ny <= y + distance; ny++)
+        for (int nx = x - distance; nx <= x + distance; nx++)
+            if (ny >= 0 && ny < board.rows && nx >= 0 && nx < board.cols && board.get(ny, nx) == CELL_TRAIL)
+                return true;
+    return false;
+}
+
+/**
+ * Marks the trail as threatened once any enemy is close to it. That can
+ * only change when an enemy moves into another cell or the trail grows, so
+ * only the enemies that changed cells this tick look at the cells around
+ * them, and the others are checked against the trail cells laid this tick
+ * (newTrail). Stops looking once it is marked, until the next trail.
+ */
+void checkNearMisses(GameStats &stats, const Board &board, const EnemyPool &enemies, const int *newTrail, int newCount)
+{
+    if (stats.trailLength == 0 || stats.trailThreatened)
+        return;
+    for (int i = 0; i < enemies.count; i++)
+    {
+        int y = int(enemies.y[i] / ts);
+        int x = int(enemies.x[i] / ts);
+        bool threat = false;
+        if (y != int(enemies.previousY[i] / ts) || x != int(enemies.previousX[i] / ts))
+            threat = trailWithin(board, y, x, nearMissCells);
+        else
+            for (int k = 0; k < newCount && !threat; k++)
+                threat = abs(newTrail[k] / board.cols - y) <= nearMissCells && abs(newTrail[k] % board.cols - x) <= nearMissCells;
+        if (threat) {
+            stats.trailThreatened = true;
+            return;
+        }
+    }
+}
+
+// Share of the cells that were open at the start that have been captured
+float capturedPercent(const GameStats &stats)
+{
+    int openCells = stats.cellCount - stats.startFilled;
+    return openCells > 0 ? 100.0f * (stats.filledCells - stats.startFilled) / openCells : 0;
+}
+
+float capturesPerMinute(const GameStats &stats, float elapsedTime)
+{
+    return elapsedTime > 0 ? stats.captures * 60.0f / elapsedTime : 0;
+}
@@ -0,0 +1,40 @@
+#ifndef XONIX_GAME_STATS_H
+#define XONIX_GAME_STATS_H
+
+#include "Board.h"
+#include "Enemy.h"
+
+const int nearMissCells = 2;    // An enemy this many cells or fewer from the trail is a threat to it
+
+/**
+ * Running totals of one game for balancing, kept up as cells change state
+ * instead of being counted off the board: a trail cell adds to the trail,
+ * a capture adds the cells it filled. Only starting a game or loading a
+ * whole board counts cells.
+ *
+ * A near miss is a trail that an enemy came within nearMissCells of and
+ * that the player still closed.
+ */
+struct GameStats
+{
+    int cellCount;
+    int startFilled;       // Filled cells when the board was loaded, the border and any obstacles
+    int filledCells;
+    int trailLength;       // Cells of the trail the player is building
+    int longestTrail;
+    int captures;
+    int capturedCells;     // Filled by captures, trail included
+    int nearMisses;
+    bool trailThreatened;  // An enemy has come close to the trail being built
+};
+
+int countFilledCells(const Board &board);
+void resetGameStats(GameStats &stats, const Board &board);
+void recountFilledCells(GameStats &stats, const Board &board);
+void noteTrailCell(GameStats &stats);
+void noteCapture(GameStats &stats, int capturedCells);
+void checkNearMisses(GameStats &stats, const Board &board, const EnemyPool &enemies, const int *newTrail, int newCount);
+float capturedPercent(const GameStats &stats);
+float capturesPerMinute(const GameStats &stats, float elapsedTime);
+
+#endif
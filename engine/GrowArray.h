@@ -0,0 +1,32 @@
+#ifndef XONIX_GROW_ARRAY_H
+#define XONIX_GROW_ARRAY_H
+
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Grows items so it can hold at least needed entries, keeping the first
+ * count of them. The capacity doubles from initialCapacity, so adding
+ * entries one at a time costs amortised O(1) and a buffer that has grown
+ * once is reused as it is.
+ */
+template <class T>
+void growArray(T *&items, int count, int &capacity, int needed, int initialCapacity = 16)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "entries are moved with memcpy()");
+    if (needed <= capacity)
+        return;
+
+    int newCapacity = capacity > 0 ? capacity : initialCapacity;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+
+    T *grown = new T[newCapacity];
+    if (count > 0)
+        memcpy(grown, items, sizeof(T) * count);
+    delete[] items;
+    items = grown;
+    capacity = newCapacity;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "MappedFile.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define XONIX_HAS_MMAP
+#endif
+
+bool mapFile(const char *path, const unsigned char *&data, size_t &size, bool &mapped)
+{
+#ifdef XONIX_HAS_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        mapping = mmap(0, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);    // The mapping stays valid without the descriptor
+    if (mapping == MAP_FAILED)
+        return false;
+
+    data = (const unsigned char *)mapping;
+    size = size_t(info.st_size);
+    mapped = true;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    size_t fileSize = size_t(file.tellg());
+    unsigned char *buffer = new unsigned char[fileSize];
+    file.seekg(0);
+    if (!file.read((char *)buffer, fileSize)) {
+        delete[] buffer;
+        return false;
+    }
+
+    data = buffer;
+    size = fileSize;
+    mapped = false;
+    return true;
+#endif
+}
+
+void unmapFile(const unsigned char *data, size_t size, bool mapped)
+{
+    if (!data)
+        return;
+#ifdef XONIX_HAS_MMAP
+    if (mapped) {
+        munmap((void *)data, size);
+        return;
+    }
+#endif
+    delete[] data;
+}
+
+bool mapWritableFile(const char *path, unsigned char *&data, size_t &size, bool &mapped)
+{
+#ifdef XONIX_HAS_MMAP
+    int fd = open(path, O_RDWR);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        mapping = mmap(0, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    data = (unsigned char *)mapping;
+    size = size_t(info.st_size);
+    mapped = true;
+    return true;
+#else
+    // Opening it for update first tells a read-only file apart before anything is changed
+    if (!std::ofstream(path, std::ios::binary | std::ios::in | std::ios::out))
+        return false;
+    const unsigned char *buffer;
+    if (!mapFile(path, buffer, size, mapped))
+        return false;
+    data = (unsigned char *)buffer;
+    return true;
+#endif
+}
+
+bool unmapWritableFile(const char *path, unsigned char *data, size_t size, bool mapped)
+{
+    if (!data)
+        return true;
+#ifdef XONIX_HAS_MMAP
+    if (mapped)
+        return munmap(data, size) == 0;
+#endif
+    std::ofstream file(path, std::ios::binary);
+    bool written = bool(file.write((const char *)data, size));
+    delete[] data;
+    return written;
+}
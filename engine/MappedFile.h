@@ -0,0 +1,23 @@
+#ifndef XONIX_MAPPED_FILE_H
+#define XONIX_MAPPED_FILE_H
+
+#include <cstddef>
+
+/**
+ * Read-only view of a whole file. Where there is mmap() the file is mapped,
+ * so nothing is copied until a page is touched; elsewhere it is read into
+ * a buffer. Either way unmapFile() gives it back.
+ */
+bool mapFile(const char *path, const unsigned char *&data, size_t &size, bool &mapped);
+void unmapFile(const unsigned char *data, size_t size, bool mapped);
+
+/**
+ * The same for a file that is changed in place: a shared mapping, so the
+ * system writes changed pages back on its own, or a buffer that
+ * unmapWritableFile() writes back to path. Returns false if the file can't
+ * be written, or (for unmapWritableFile()) if writing it back failed.
+ */
+bool mapWritableFile(const char *path, unsigned char *&data, size_t &size, bool &mapped);
+bool unmapWritableFile(const char *path, unsigned char *data, size_t size, bool mapped);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef XONIX_MOTION_PATTERNS_H
+#define XONIX_MOTION_PATTERNS_H
+
+/*
+ * Enemy motion patterns, all known at compile time. A pattern is a struct
+ * with a name, a velocity table and how many table steps it walks through
+ * per second. Enemies following it move by table[step] * their starting
+ * speed, so a pattern costs one table lookup per enemy per tick and adding
+ * one is just another struct in MotionPatterns below.
+ */
+
+constexpr double patternPi = 3.14159265358979323846;
+
+// sin() that also works at compile time, good to double precision for the angles used here
+constexpr double constexprSin(double angle)
+{
+    while (angle > patternPi)
+        angle -= 2 * patternPi;
+    while (angle < -patternPi)
+        angle += 2 * patternPi;
+
+    double term = angle;
+    double sum = angle;
+    for (int n = 1; n < 12; n++) {
+        term *= -angle * angle / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constexprCos(double angle)
+{
+    return constexprSin(angle + patternPi / 2);
+}
+
+// Velocity for each step of a pattern, multiplied by the enemy's starting speed
+template <int N>
+struct VelocityTable
+{
+    static constexpr int size = N;
+    float x[N];
+    float y[N];
+};
+
+// Changes the y direction every 0.5s while x stays the same
+struct ZigzagMotion
+{
+    static constexpr const char *name = "Zig-zag";
+    static constexpr float stepsPerSecond = 2.0f;
+    static constexpr VelocityTable<2> table = {{1.0f, 1.0f}, {0.5f, -0.5f}};
+};
+
+// Eight approximate points around a circle, four per second
+struct CircularMotion
+{
+    static constexpr const char *name = "Circular";
+    static constexpr float stepsPerSecond = 4.0f;
+    static constexpr VelocityTable<8> table = {{1.0f, 0.7f, 0.0f, -0.7f, -1.0f, -0.7f, 0.0f, 0.7f},
+                                               {0.0f, 0.7f, 1.0f, 0.7f, 0.0f, -0.7f, -1.0f, -0.7f}};
+};
+
+// Two turns while speeding up from half to one and a half times the starting speed, then starts over
+constexpr VelocityTable<32> makeSpiralTable()
+{
+    VelocityTable<32> table = {};
+    for (int i = 0; i < 32; i++) {
+        double angle = 2 * patternPi * i / 16;
+        double scale = 0.5 + i / 31.0;
+        table.x[i] = float(constexprCos(angle) * scale);
+        table.y[i] = float(constexprSin(angle) * scale);
+    }
+    return table;
+}
+
+struct SpiralMotion
+{
+    static constexpr const char *name = "Spiral";
+    static constexpr float stepsPerSecond = 8.0f;
+    static constexpr VelocityTable<32> table = makeSpiralTable();
+};
+
+// Traces the 3:2 Lissajous figure x = sin(3t), y = sin(2t), the table is its velocity
+constexpr VelocityTable<32> makeLissajousTable()
+{
+    VelocityTable<32> table = {};
+    for (int i = 0; i < 32; i++) {
+        double t = 2 * patternPi * i / 32;
+        table.x[i] = float(constexprCos(3 * t));
+        table.y[i] = float(2.0 / 3.0 * constexprCos(2 * t));
+    }
+    return table;
+}
+
+struct LissajousMotion
+{
+    static constexpr const char *name = "Lissajous";
+    static constexpr float stepsPerSecond = 8.0f;
+    static constexpr VelocityTable<32> table = makeLissajousTable();
+};
+
+template <class... Patterns>
+struct PatternRegistry
+{
+    static constexpr int count = sizeof...(Patterns);
+    static constexpr const char *names[count] = {Patterns::name...};
+};
+
+// Every pattern enemies can switch to, motion index i follows the i-th one
+typedef PatternRegistry<ZigzagMotion, CircularMotion, SpiralMotion, LissajousMotion> MotionPatterns;
+
+#endif
@@ -0,0 +1,657 @@
+#include "NetMatch.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+static const char helloMagic[4] = {'X', 'N', 'E', 'T'};
+const int endFlushAttempts = 200;    // Milliseconds given to the last messages to leave before closing
+
+/*
+ * Snapshot layout: u32 tick, u8 player count, then for each player:
+ * u8 running, u32 newest input tick + 1 (0 for none yet), u32 echoed send
+ * time, u32 microseconds that input was held for its tick, u16 x, u16 y, u32 moves, f32 elapsed time, f32 speed multiplier,
+ * u32 score, varint count of input runs and the runs (one byte each, the
+ * direction in the top 3 bits and run length - 1 in the low 5 as in
+ * replays), the enemies that didn't move as predicted (see
+ * writeEnemyDelta()) and the board delta (see writeBoardDelta()).
+ */
+
+static float tickSecondsOf(const NetMatchConfig &config)
+{
+    return 1.0f / config.tickRate;
+}
+
+static bool isValidMatchConfig(const NetMatchConfig &config)
+{
+    return config.playerCount >= 1 && config.playerCount <= maxNetPlayers &&
+           config.difficultyLevel >= 1 && config.difficultyLevel <= 3 &&
+           isValidBoardSize(config.rows, config.cols) && config.enemyCount >= 0 &&
+           config.enemyCount <= maxEnemyCount && config.tickRate > 0 &&
+           config.snapshotInterval >= 1 && config.snapshotInterval <= maxSnapshotInterval;
+}
+
+NetServer::NetServer()
+{
+    listener = -1;
+    joinedCount = 0;
+    started = false;
+    tick = 0;
+    snapshotsSent = 0;
+    deltaBytes = fullGridBytes = 0;
+    enemyBytes = fullEnemyBytes = 0;
+}
+
+static void resetServerPlayer(ServerPlayer &player)
+{
+    closeConnection(player.connection);
+    player.joined = false;
+    player.score = 0;
+    player.queueStart = player.queueCount = 0;
+    player.hasInput = false;
+    player.newestInputTick = 0;
+    player.echoMicros = 0;
+    player.heldMicros = 0;
+    player.appliedCount = 0;
+    player.lateInputs = 0;
+}
+
+// Opens the port and waits for config.playerCount players, returns false if the port can't be used
+bool startNetServer(NetServer &server, const NetMatchConfig &config, int port)
+{
+    if (!isValidMatchConfig(config))
+        return false;
+
+    server.config = config;
+    for (int p = 0; p < maxNetPlayers; p++)
+        resetServerPlayer(server.players[p]);
+    server.joinedCount = 0;
+    server.started = false;
+    server.tick = 0;
+    server.snapshotsSent = 0;
+    server.deltaBytes = server.fullGridBytes = 0;
+    server.enemyBytes = server.fullEnemyBytes = 0;
+
+    closeListener(server.listener);
+    server.listener = openListener(port);
+    return server.listener >= 0;
+}
+
+// Starts every player's game from the same seed and tells each client which player it is
+static void startMatch(NetServer &server)
+{
+    NetMatchConfig &config = server.config;
+    for (int p = 0; p < config.playerCount; p++)
+    {
+        Game &game = server.players[p].game;
+        startGame(game, config.difficultyLevel, config.seed, config.rows, config.cols, config.enemyCount);
+        memset(game.board.dirty, 0, sizeof(uint64_t) * game.board.wordCount);    // Clients start from the same grid
+        startEnemyTrack(server.players[p].enemyTrack, game.enemies);              // and the same enemies
+    }
+    config.enemyCount = server.players[0].game.enemies.count;
+
+    MessageWriter &message = server.message;
+    for (int p = 0; p < config.playerCount; p++)
+    {
+        clearMessage(message);
+        writeValue(message, p, 1);
+        writeValue(message, config.playerCount, 1);
+        writeValue(message, config.seed, 4);
+        writeValue(message, config.difficultyLevel, 1);
+        writeValue(message, config.rows, 2);
+        writeValue(message, config.cols, 2);
+        writeValue(message, config.enemyCount, 4);
+        writeFloat(message, config.tickRate);
+        writeValue(message, config.snapshotInterval, 1);
+        queueMessage(server.players[p].connection, MSG_WELCOME, message.data, message.length);
+        flushConnection(server.players[p].connection);
+    }
+    server.started = true;
+    server.tick = 0;
+}
+
+/**
+ * Takes waiting connections into free seats and checks their MSG_HELLO.
+ * Starts the match once every seat holds a player, returns true from then on.
+ */
+bool acceptNetPlayers(NetServer &server)
+{
+    if (server.started)
+        return true;
+
+    for (int p = 0; p < server.config.playerCount; p++)
+    {
+        ServerPlayer &player = server.players[p];
+        if (!isConnected(player.connection)) {
+            if (player.joined) {
+                player.joined = false;    // Left before the match started, the seat is free again
+                server.joinedCount--;
+            }
+            if (!acceptConnection(server.listener, player.connection))
+                continue;
+        }
+        if (player.joined)
+            continue;
+
+        receiveData(player.connection);
+        NetMessage message;
+        if (nextMessage(player.connection, message))
+        {
+            MessageReader reader;
+            startReading(reader, message);
+            const unsigned char *magic = readData(reader, 4);
+            int version = int(readValue(reader, 2));
+            if (message.type == MSG_HELLO && magic && memcmp(magic, helloMagic, 4) == 0 && version == netProtocolVersion) {
+                player.joined = true;
+                server.joinedCount++;
+            }
+            else
+                closeConnection(player.connection);
+        }
+    }
+
+    if (server.joinedCount == server.config.playerCount)
+        startMatch(server);
+    return server.started;
+}
+
+// Reads the input that arrived from every player, a player who disconnects forfeits their game
+void pollNetServer(NetServer &server)
+{
+    for (int p = 0; p < server.config.playerCount; p++)
+    {
+        ServerPlayer &player = server.players[p];
+        bool open = receiveData(player.connection);
+
+        NetMessage message;
+        while (nextMessage(player.connection, message))
+        {
+            if (message.type != MSG_INPUT)
+                continue;
+
+            MessageReader reader;
+            startReading(reader, message);
+            unsigned int tick = readValue(reader, 4);
+            unsigned int direction = readValue(reader, 1);
+            unsigned int micros = readValue(reader, 4);
+            if (reader.failed || direction > DIR_DOWN || player.queueCount == maxQueuedInputs)
+                continue;
+
+            int slot = (player.queueStart + player.queueCount) % maxQueuedInputs;
+            player.queuedTick[slot] = tick;
+            player.queuedDirection[slot] = (unsigned char)direction;
+            player.queuedMicros[slot] = micros;
+            player.queuedAt[slot] = ProfileClock::now();
+            player.queueCount++;
+            if (!player.hasInput || tick > player.newestInputTick)
+                player.newestInputTick = tick;
+            player.hasInput = true;
+        }
+
+        if (!open && !isConnected(player.connection))
+            player.game.running = false;
+    }
+}
+
+// Writes the input runs of the ticks since the last snapshot
+static void writeAppliedInput(MessageWriter &message, const ServerPlayer &player)
+{
+    unsigned char runs[maxSnapshotInterval];
+    int runCount = 0;
+    for (int i = 0; i < player.appliedCount; i++)
+    {
+        if (runCount > 0 && (runs[runCount - 1] >> 5) == player.applied[i] && (runs[runCount - 1] & 31) < 31)
+            runs[runCount - 1]++;
+        else
+            runs[runCount++] = (unsigned char)(player.applied[i] << 5);
+    }
+    writeVarint(message, runCount);
+    writeData(message, runs, runCount);
+}
+
+static void sendSnapshot(NetServer &server)
+{
+    MessageWriter &message = server.message;
+    clearMessage(message);
+    writeValue(message, server.tick, 4);
+    writeValue(message, server.config.playerCount, 1);
+
+    for (int p = 0; p < server.config.playerCount; p++)
+    {
+        ServerPlayer &player = server.players[p];
+        const Game &game = player.game;
+        writeValue(message, game.running ? 1 : 0, 1);
+        writeValue(message, player.hasInput ? player.newestInputTick + 1 : 0, 4);
+        writeValue(message, player.echoMicros, 4);
+        writeValue(message, player.heldMicros, 4);
+        writeValue(message, game.playerX, 2);
+        writeValue(message, game.playerY, 2);
+        writeValue(message, game.moveCounter, 4);
+        writeFloat(message, game.elapsedTime);
+        writeFloat(message, game.speedMultiplier);
+        writeValue(message, player.score, 4);
+
+        writeAppliedInput(message, player);
+        player.appliedCount = 0;
+
+        int enemyStart = message.length;
+        writeEnemyDelta(message, player.enemyTrack, game.enemies);
+        server.enemyBytes += message.length - enemyStart;
+        server.fullEnemyBytes += 9 * game.enemies.count;
+
+        int deltaStart = message.length;
+        writeBoardDelta(message, player.game.board);
+        server.deltaBytes += message.length - deltaStart;
+        server.fullGridBytes += game.board.rows * game.board.cols;
+    }
+
+    for (int p = 0; p < server.config.playerCount; p++) {
+        queueMessage(server.players[p].connection, MSG_SNAPSHOT, message.data, message.length);
+        flushConnection(server.players[p].connection);
+    }
+    server.snapshotsSent++;
+}
+
+/**
+ * Runs one tick of every player's game. Each uses the inputs its client
+ * sent for this tick or earlier (late ones are applied now), the newest
+ * direction winning. A snapshot goes out every snapshotInterval ticks and
+ * when the last game ends.
+ */
+void tickNetServer(NetServer &server)
+{
+    const float dt = tickSecondsOf(server.config);
+    for (int p = 0; p < server.config.playerCount; p++)
+    {
+        ServerPlayer &player = server.players[p];
+        Direction input = DIR_NONE;
+        while (player.queueCount > 0 && player.queuedTick[player.queueStart] <= server.tick)
+        {
+            int slot = player.queueStart;
+            if (player.queuedTick[slot] < server.tick)
+                player.lateInputs++;
+            if (player.queuedDirection[slot] != DIR_NONE)
+                input = Direction(player.queuedDirection[slot]);
+            player.echoMicros = player.queuedMicros[slot];
+            player.heldMicros = (unsigned int)std::chrono::duration_cast<std::chrono::microseconds>(
+                ProfileClock::now() - player.queuedAt[slot]).count();
+            player.queueStart = (player.queueStart + 1) % maxQueuedInputs;
+            player.queueCount--;
+        }
+
+        TickResult result = updateGame(player.game, dt, input);
+        player.score += result.capturedCells;
+        player.applied[player.appliedCount++] = (unsigned char)input;
+    }
+    server.tick++;
+
+    if (server.tick % server.config.snapshotInterval == 0 || netMatchOver(server))
+        sendSnapshot(server);
+}
+
+bool netMatchOver(const NetServer &server)
+{
+    if (!server.started)
+        return false;
+    for (int p = 0; p < server.config.playerCount; p++)
+        if (server.players[p].game.running)
+            return false;
+    return true;
+}
+
+// Sends everyone the final scores and closes the match
+void endNetServer(NetServer &server)
+{
+    MessageWriter &message = server.message;
+    clearMessage(message);
+    for (int p = 0; p < server.config.playerCount; p++)
+        writeValue(message, server.players[p].score, 4);
+
+    for (int p = 0; p < server.config.playerCount; p++)
+        queueMessage(server.players[p].connection, MSG_END, message.data, message.length);
+
+    for (int attempt = 0; attempt < endFlushAttempts; attempt++)
+    {
+        bool pending = false;
+        for (int p = 0; p < server.config.playerCount; p++)
+            if (flushConnection(server.players[p].connection) && server.players[p].connection.outCount > 0)
+                pending = true;
+        if (!pending)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (int p = 0; p < server.config.playerCount; p++)
+        closeConnection(server.players[p].connection);
+    closeListener(server.listener);
+    server.listener = -1;
+}
+
+// Bandwidth of every client and how much the board deltas saved over sending whole grids
+void writeNetServerReport(const NetServer &server, double seconds, std::ostream &out)
+{
+    out << "Ticks: " << server.tick << ", snapshots: " << server.snapshotsSent << std::endl;
+    for (int p = 0; p < server.config.playerCount; p++)
+    {
+        const ServerPlayer &player = server.players[p];
+        out << "Player " << p << ": score " << player.score
+            << ", sent " << player.connection.bytesSent / 1024.0 / seconds << " KB/s"
+            << ", received " << player.connection.bytesReceived / 1024.0 / seconds << " KB/s"
+            << ", late inputs " << player.lateInputs << std::endl;
+    }
+    if (server.snapshotsSent > 0)
+        out << "Board deltas: " << server.deltaBytes << " bytes, whole grids would have been "
+            << server.fullGridBytes << " bytes (" << double(server.fullGridBytes) / (server.deltaBytes > 0 ? server.deltaBytes : 1)
+            << "x more)" << std::endl;
+    if (server.snapshotsSent > 0)
+        out << "Enemy deltas: " << server.enemyBytes << " bytes, every position would have been "
+            << server.fullEnemyBytes << " bytes (" << double(server.fullEnemyBytes) / (server.enemyBytes > 0 ? server.enemyBytes : 1)
+            << "x more)" << std::endl;
+}
+
+NetClient::NetClient()
+{
+    state = NET_DISCONNECTED;
+    playerIndex = -1;
+    startTime = ProfileClock::now();
+    predictedTick = confirmedTick = 0;
+    for (int p = 0; p < maxNetPlayers; p++)
+        scores[p] = 0;
+    inputSlack = 0;
+    tickAdjust = 0;
+    adjustCooldown = 0;
+    snapshots = rollbacks = resimulatedTicks = desyncCells = 0;
+    lastEcho = 0;
+    latencyCount = 0;
+}
+
+static unsigned int clientMicros(const NetClient &client)
+{
+    return (unsigned int)std::chrono::duration_cast<std::chrono::microseconds>(ProfileClock::now() - client.startTime).count();
+}
+
+// Connects and says hello, the match starts when the server has every player
+bool connectNetClient(NetClient &client, const char *host, int port)
+{
+    if (!connectTo(client.connection, host, port)) {
+        client.state = NET_DISCONNECTED;
+        return false;
+    }
+    client.state = NET_WAITING;
+    client.startTime = ProfileClock::now();
+
+    MessageWriter hello;
+    writeData(hello, (const unsigned char *)helloMagic, 4);
+    writeValue(hello, netProtocolVersion, 2);
+    queueMessage(client.connection, MSG_HELLO, hello.data, hello.length);
+    return flushConnection(client.connection);
+}
+
+static bool handleWelcome(NetClient &client, MessageReader &reader)
+{
+    NetMatchConfig &config = client.config;
+    client.playerIndex = int(readValue(reader, 1));
+    config.playerCount = int(readValue(reader, 1));
+    config.seed = readValue(reader, 4);
+    config.difficultyLevel = int(readValue(reader, 1));
+    config.rows = int(readValue(reader, 2));
+    config.cols = int(readValue(reader, 2));
+    config.enemyCount = int(readValue(reader, 4));
+    config.tickRate = readFloat(reader);
+    config.snapshotInterval = int(readValue(reader, 1));
+    if (reader.failed || !isValidMatchConfig(config) || config.enemyCount == 0 || client.playerIndex >= config.playerCount)
+        return false;
+
+    startGame(client.predicted, config.difficultyLevel, config.seed, config.rows, config.cols, config.enemyCount);
+    startGame(client.confirmed, config.difficultyLevel, config.seed, config.rows, config.cols, config.enemyCount);
+
+    // Everyone starts from the same game, snapshots only carry what changes
+    for (int p = 0; p < config.playerCount; p++)
+    {
+        RemotePlayer &remote = client.remotes[p];
+        copyBoard(remote.board, client.confirmed.board);
+        copyEnemies(remote.enemies, client.confirmed.enemies);
+        startEnemyTrack(remote.enemyTrack, client.confirmed.enemies);
+        remote.playerX = client.confirmed.playerX;
+        remote.playerY = client.confirmed.playerY;
+        remote.moveCounter = 0;
+        remote.score = 0;
+        remote.elapsedTime = 0;
+        remote.speedMultiplier = client.confirmed.speedMultiplier;
+        remote.running = true;
+    }
+
+    client.predictedTick = client.confirmedTick = 0;
+    client.tickAdjust = initialInputLead;
+    client.adjustCooldown = 0;
+    client.state = NET_PLAYING;
+    return true;
+}
+
+// Runs the confirmed game through the ticks a snapshot covers, returns false if they don't add up
+static bool confirmTicks(NetClient &client, const unsigned char *runs, int runCount, unsigned int tick, bool &mispredicted)
+{
+    const float dt = tickSecondsOf(client.config);
+    unsigned int t = client.confirmedTick;
+    for (int r = 0; r < runCount; r++)
+    {
+        int direction = runs[r] >> 5;
+        if (direction > DIR_DOWN)
+            return false;
+
+        for (int k = 0; k <= (runs[r] & 31); k++, t++)
+        {
+            // A tick never predicted (the client fell behind) or predicted with other input has to be redone
+            if (t >= client.predictedTick || client.inputHistory[t % maxPredictedTicks] != direction)
+                mispredicted = true;
+            updateGame(client.confirmed, dt, Direction(direction));
+        }
+    }
+    client.confirmedTick = t;
+    return t == tick;
+}
+
+static void recordLatency(NetClient &client, unsigned int echo, unsigned int held)
+{
+    if (echo == client.lastEcho)
+        return;
+    client.lastEcho = echo;
+
+    int sample = int(client.latencyCount % maxLatencySamples);
+    unsigned int roundTrip = clientMicros(client) - echo;
+    client.latencyMs[sample] = roundTrip / 1000.0f;
+    client.networkMs[sample] = (held < roundTrip ? roundTrip - held : 0) / 1000.0f;
+    client.latencyCount++;
+}
+
+/**
+ * Confirms the ticks a snapshot covers, rolls the prediction back if they
+ * were not predicted right, updates everyone else's game and nudges the
+ * input lead so input keeps arriving just before the server needs it.
+ */
+static bool handleSnapshot(NetClient &client, MessageReader &reader)
+{
+    unsigned int tick = readValue(reader, 4);
+    int playerCount = int(readValue(reader, 1));
+    if (reader.failed || playerCount != client.config.playerCount || tick < client.confirmedTick ||
+        tick - client.confirmedTick > unsigned(maxSnapshotInterval))
+        return false;
+
+    unsigned int ticksCovered = tick - client.confirmedTick;
+    bool mispredicted = false;
+    for (int p = 0; p < playerCount; p++)
+    {
+        RemotePlayer &remote = client.remotes[p];
+        remote.running = readValue(reader, 1) != 0;
+        unsigned int newestInput = readValue(reader, 4);
+        unsigned int echo = readValue(reader, 4);
+        unsigned int held = readValue(reader, 4);
+        remote.playerX = int(readValue(reader, 2));
+        remote.playerY = int(readValue(reader, 2));
+        remote.moveCounter = int(readValue(reader, 4));
+        remote.elapsedTime = readFloat(reader);
+        remote.speedMultiplier = readFloat(reader);
+        remote.score = int(readValue(reader, 4));
+        int runCount = int(readVarint(reader));
+        const unsigned char *runs = readData(reader, runCount);
+        if (reader.failed)
+            return false;
+
+        if (p == client.playerIndex)
+        {
+            if (!confirmTicks(client, runs, runCount, tick, mispredicted))
+                return false;
+            if (!readEnemyDelta(reader, remote.enemyTrack, 0))    // Our own enemies are simulated here
+                return false;
+
+            int corrected = readBoardDelta(reader, client.confirmed.board);
+            if (corrected < 0)
+                return false;
+            client.desyncCells += corrected;
+
+            if (newestInput > 0)
+                client.inputSlack = int(newestInput - 1 - tick);
+            recordLatency(client, echo, held);
+        }
+        else
+        {
+            if (!readEnemyDelta(reader, remote.enemyTrack, &remote.enemies) || readBoardDelta(reader, remote.board) < 0)
+                return false;
+        }
+    }
+    if (reader.failed)
+        return false;
+    client.snapshots++;
+
+    if (mispredicted)
+    {
+        const float dt = tickSecondsOf(client.config);
+        client.rollbacks++;
+        copyGame(client.predicted, client.confirmed);
+        if (client.predictedTick < tick)
+            client.predictedTick = tick;
+        for (unsigned int t = tick; t < client.predictedTick; t++) {
+            updateGame(client.predicted, dt, Direction(client.inputHistory[t % maxPredictedTicks]));
+            client.resimulatedTicks++;
+        }
+    }
+
+    // Aim for input landing one to six ticks early, the effect only shows a round trip later
+    client.adjustCooldown -= int(ticksCovered);
+    if (client.adjustCooldown <= 0) {
+        int adjust = client.inputSlack < 1 ? 1 : (client.inputSlack > 6 ? -1 : 0);
+        if (adjust != 0) {
+            client.tickAdjust += adjust;
+            client.adjustCooldown = int(client.config.tickRate / 2);
+        }
+    }
+    return true;
+}
+
+/**
+ * Handles everything the server sent since the last call. Returns false
+ * once the match is over or the connection was lost.
+ */
+bool pollNetClient(NetClient &client)
+{
+    if (client.state == NET_FINISHED || client.state == NET_DISCONNECTED)
+        return false;
+
+    bool open = receiveData(client.connection);
+    NetMessage message;
+    while (nextMessage(client.connection, message))
+    {
+        MessageReader reader;
+        startReading(reader, message);
+        bool valid = true;
+
+        if (message.type == MSG_WELCOME && client.state == NET_WAITING)
+            valid = handleWelcome(client, reader);
+        else if (message.type == MSG_SNAPSHOT && client.state == NET_PLAYING)
+            valid = handleSnapshot(client, reader);
+        else if (message.type == MSG_END) {
+            for (int p = 0; p < client.config.playerCount; p++)
+                client.scores[p] = int(readValue(reader, 4));
+            client.state = NET_FINISHED;
+            closeConnection(client.connection);
+            return false;
+        }
+
+        if (!valid) {
+            closeConnection(client.connection);
+            client.state = NET_DISCONNECTED;
+            return false;
+        }
+    }
+
+    if (!open || !flushConnection(client.connection)) {
+        client.state = NET_DISCONNECTED;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Sends the input for the next tick and runs that tick on the predicted
+ * game. Returns false without doing anything when the match isn't running
+ * or the client is already too far ahead of the last snapshot.
+ */
+bool stepNetClient(NetClient &client, Direction input)
+{
+    if (client.state != NET_PLAYING || client.predictedTick - client.confirmedTick >= unsigned(maxPredictedTicks))
+        return false;
+
+    unsigned char message[9];
+    unsigned int tick = client.predictedTick;
+    unsigned int micros = clientMicros(client);
+    for (int i = 0; i < 4; i++) {
+        message[i] = (unsigned char)(tick >> (8 * i));
+        message[5 + i] = (unsigned char)(micros >> (8 * i));
+    }
+    message[4] = (unsigned char)input;
+    queueMessage(client.connection, MSG_INPUT, message, sizeof(message));
+    flushConnection(client.connection);
+
+    client.inputHistory[tick % maxPredictedTicks] = (unsigned char)input;
+    updateGame(client.predicted, tickSecondsOf(client.config), input);
+    client.predictedTick++;
+    return true;
+}
+
+/**
+ * How many ticks to run for the ticks the simulation clock asked for, with
+ * the input lead correction taken out of it. Corrections that would go
+ * below zero are kept for the next frame.
+ */
+int adjustClientTicks(NetClient &client, int ticks)
+{
+    ticks += client.tickAdjust;
+    client.tickAdjust = 0;
+    if (ticks < 0) {
+        client.tickAdjust = ticks;
+        ticks = 0;
+    }
+    return ticks;
+}
+
+// Latency, prediction and bandwidth of the match so far
+void writeNetClientReport(NetClient &client, double seconds, std::ostream &out)
+{
+    int samples = client.latencyCount < maxLatencySamples ? int(client.latencyCount) : maxLatencySamples;
+    out << "Player " << client.playerIndex << " of " << client.config.playerCount
+        << ": " << client.predictedTick << " ticks predicted, " << client.snapshots << " snapshots" << std::endl;
+    out << "Rollbacks: " << client.rollbacks << " (" << client.resimulatedTicks << " ticks simulated again)"
+        << ", desynced cells: " << client.desyncCells << std::endl;
+    out << "Latency (input to snapshot): p50 " << percentileOf(client.latencyMs, samples, 50)
+        << " ms, p99 " << percentileOf(client.latencyMs, samples, 99)
+        << " ms, max " << percentileOf(client.latencyMs, samples, 100) << " ms" << std::endl;
+    out << "Network round trip: p50 " << percentileOf(client.networkMs, samples, 50)
+        << " ms, p99 " << percentileOf(client.networkMs, samples, 99) << " ms" << std::endl;
+    out << "Bandwidth: down " << client.connection.bytesReceived / 1024.0 / seconds
+        << " KB/s, up " << client.connection.bytesSent / 1024.0 / seconds << " KB/s" << std::endl;
+    if (client.state == NET_FINISHED) {
+        out << "Scores:";
+        for (int p = 0; p < client.config.playerCount; p++)
+            out << " " << client.scores[p] << (p == client.playerIndex ? " (you)" : "");
+        out << std::endl;
+    }
+}
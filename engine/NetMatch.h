@@ -0,0 +1,152 @@
+#ifndef XONIX_NET_MATCH_H
+#define XONIX_NET_MATCH_H
+
+#include "Game.h"
+#include "NetProtocol.h"
+#include "SimulationClock.h"
+#include <ostream>
+
+const int maxNetPlayers = 4;
+const int maxQueuedInputs = 256;       // Inputs a server keeps per player before they are due
+const int maxSnapshotInterval = 60;    // Ticks one snapshot can cover
+const int maxPredictedTicks = 256;     // How far a client may run ahead of the last snapshot
+const int initialInputLead = 2;        // Ticks a client starts ahead of the server so its input arrives in time
+const int maxLatencySamples = 4096;
+
+/**
+ * How the server sets up the match. Every player gets a game of their own
+ * started from the same seed, so the two boards begin identical and
+ * whoever captures more wins. The server sends it to each client in
+ * MSG_WELCOME when the last player has joined.
+ */
+struct NetMatchConfig
+{
+    int playerCount = 2;
+    unsigned int seed = 1;
+    int difficultyLevel = 1;
+    int rows = defaultRows;
+    int cols = defaultCols;
+    int enemyCount = 0;             // 0 uses the difficulty's enemy count
+    float tickRate = defaultTickRate;
+    int snapshotInterval = 1;       // Ticks between snapshots
+};
+
+// A player as the server sees it: the authoritative game and the inputs that arrived for it
+struct ServerPlayer
+{
+    NetConnection connection;
+    bool joined;                 // Sent a valid MSG_HELLO
+    Game game;
+    int score;                   // Cells captured so far
+
+    // Inputs waiting for the tick they were sent for
+    unsigned int queuedTick[maxQueuedInputs];
+    unsigned char queuedDirection[maxQueuedInputs];
+    unsigned int queuedMicros[maxQueuedInputs];
+    ProfileClock::time_point queuedAt[maxQueuedInputs];
+    int queueStart, queueCount;
+
+    bool hasInput;
+    unsigned int newestInputTick;    // Newest tick the client has sent input for
+    unsigned int echoMicros;         // Send time of the last input applied, echoed back for latency
+    unsigned int heldMicros;         // How long that input waited here for its tick
+    unsigned char applied[maxSnapshotInterval];    // Input used on each tick since the last snapshot
+    int appliedCount;
+    long long lateInputs;            // Inputs that arrived after their tick and were applied late
+    EnemyTrack enemyTrack;           // The enemies as the clients last saw them
+};
+
+/**
+ * The authoritative side of a match. It runs every player's game with the
+ * input each client sent for that tick and sends snapshots holding the
+ * input it actually used, the players, the enemies that strayed from where
+ * they were heading, and the cells that changed since the last snapshot.
+ * The whole grid is never sent.
+ */
+struct NetServer
+{
+    NetMatchConfig config;
+    int listener;
+    ServerPlayer players[maxNetPlayers];
+    int joinedCount;
+    bool started;
+    unsigned int tick;               // Ticks simulated since the match started
+    MessageWriter message;           // Reused for every message sent
+    long long snapshotsSent;
+    long long deltaBytes;            // Board deltas sent to one client so far
+    long long fullGridBytes;         // What sending every grid whole at each snapshot would have cost
+    long long enemyBytes;            // Enemy deltas sent to one client so far
+    long long fullEnemyBytes;        // What sending every enemy's floats and motion would have cost
+
+    NetServer();
+};
+
+// Someone else's game as a client sees it, only what the snapshots carry
+struct RemotePlayer
+{
+    Board board;
+    EnemyPool enemies;
+    int playerX, playerY;
+    int moveCounter;
+    int score;
+    float elapsedTime, speedMultiplier;
+    bool running;
+    EnemyTrack enemyTrack;    // Kept for our own game too, its deltas build on the last ones
+};
+
+enum NetClientState { NET_WAITING, NET_PLAYING, NET_FINISHED, NET_DISCONNECTED };
+
+/**
+ * A player's side of a match. Its own game is predicted: every tick runs
+ * locally with the local input straight away. A second copy only advances
+ * when a snapshot says which input the server used on each tick. When
+ * that differs from what was predicted, the predicted game is rolled back
+ * to the confirmed one and the ticks since are simulated again.
+ */
+struct NetClient
+{
+    NetConnection connection;
+    NetClientState state;
+    NetMatchConfig config;
+    int playerIndex;
+    ProfileClock::time_point startTime;    // Input send times are in microseconds since this
+
+    Game predicted, confirmed;
+    unsigned int predictedTick, confirmedTick;
+    unsigned char inputHistory[maxPredictedTicks];    // Local input used on each predicted tick
+    RemotePlayer remotes[maxNetPlayers];
+    int scores[maxNetPlayers];             // Final scores from MSG_END
+
+    // Keeping inputs ahead of the server: the caller runs tickAdjust extra (or fewer) ticks
+    int inputSlack;                        // How many ticks early the newest input reached the server
+    int tickAdjust;
+    int adjustCooldown;
+
+    // Metrics
+    long long snapshots;
+    long long rollbacks;
+    long long resimulatedTicks;
+    long long desyncCells;                 // Cells the server's delta corrected on the confirmed game, 0 when deterministic
+    unsigned int lastEcho;
+    float latencyMs[maxLatencySamples];    // Input sent to its snapshot back, newest samples
+    float networkMs[maxLatencySamples];    // The same without the time the input waited on the server for its tick
+    long long latencyCount;
+
+    NetClient();
+};
+
+bool startNetServer(NetServer &server, const NetMatchConfig &config, int port);
+bool acceptNetPlayers(NetServer &server);
+void pollNetServer(NetServer &server);
+void tickNetServer(NetServer &server);
+bool netMatchOver(const NetServer &server);
+void endNetServer(NetServer &server);
+void writeNetServerReport(const NetServer &server, double seconds, std::ostream &out);
+
+bool connectNetClient(NetClient &client, const char *host, int port);
+bool pollNetClient(NetClient &client);
+bool stepNetClient(NetClient &client, Direction input);
+int adjustClientTicks(NetClient &client, int ticks);
+void writeNetClientReport(NetClient &client, double seconds, std::ostream &out);
+
+#endif
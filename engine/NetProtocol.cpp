@@ -0,0 +1,373 @@
+#include "NetProtocol.h"
+#include "GrowArray.h"
+#include <cmath>
+#include <cstring>
+
+const int initialMessageCapacity = 1024;
+const int maxTrackedPosition = 1 << 28;
+
+MessageWriter::MessageWriter()
+{
+    data = 0;
+    length = capacity = 0;
+}
+
+MessageWriter::~MessageWriter()
+{
+    delete[] data;
+}
+
+void clearMessage(MessageWriter &writer)
+{
+    writer.length = 0;
+}
+
+void writeValue(MessageWriter &writer, unsigned int value, int byteCount)
+{
+    growArray(writer.data, writer.length, writer.capacity, writer.length + byteCount, initialMessageCapacity);
+    for (int i = 0; i < byteCount; i++)
+        writer.data[writer.length++] = (unsigned char)(value >> (8 * i));
+}
+
+void writeVarint(MessageWriter &writer, unsigned int value)
+{
+    growArray(writer.data, writer.length, writer.capacity, writer.length + 5, initialMessageCapacity);
+    while (value >= 0x80) {
+        writer.data[writer.length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    writer.data[writer.length++] = (unsigned char)value;
+}
+
+void writeFloat(MessageWriter &writer, float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    writeValue(writer, bits, 4);
+}
+
+void writeData(MessageWriter &writer, const unsigned char *data, int length)
+{
+    growArray(writer.data, writer.length, writer.capacity, writer.length + length, initialMessageCapacity);
+    memcpy(writer.data + writer.length, data, length);
+    writer.length += length;
+}
+
+void startReading(MessageReader &reader, const NetMessage &message)
+{
+    reader.data = message.body;
+    reader.length = message.length;
+    reader.position = 0;
+    reader.failed = false;
+}
+
+unsigned int readValue(MessageReader &reader, int byteCount)
+{
+    if (reader.failed || reader.position + byteCount > reader.length) {
+        reader.failed = true;
+        return 0;
+    }
+
+    unsigned int value = 0;
+    for (int i = 0; i < byteCount; i++)
+        value |= (unsigned int)reader.data[reader.position++] << (8 * i);
+    return value;
+}
+
+unsigned int readVarint(MessageReader &reader)
+{
+    unsigned int value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        unsigned int byte = readValue(reader, 1);
+        value |= (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    reader.failed = true;
+    return 0;
+}
+
+float readFloat(MessageReader &reader)
+{
+    unsigned int bits = readValue(reader, 4);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Points at the next length bytes of the message, 0 if there aren't that many left
+const unsigned char *readData(MessageReader &reader, int length)
+{
+    if (reader.failed || length < 0 || reader.position + length > reader.length) {
+        reader.failed = true;
+        return 0;
+    }
+    const unsigned char *data = reader.data + reader.position;
+    reader.position += length;
+    return data;
+}
+
+/**
+ * Writes the cells in the board's dirty plane as runs of consecutive cells
+ * holding the same value, and clears the plane. A run is the number of
+ * cells skipped since the last run followed by its length and value packed
+ * as length << 2 | value, both varints, so a capture filling a pocket costs
+ * a few bytes per row instead of a byte per cell. Returns the run count.
+ */
+int writeBoardDelta(MessageWriter &writer, Board &board)
+{
+    const int cellCount = board.rows * board.cols;
+    int countPosition = writer.length;
+    writeValue(writer, 0, 4);    // Filled in once the runs are known
+
+    int runCount = 0;
+    int runStart = 0, runLength = 0, runValue = 0;
+    int previousEnd = 0;
+
+    for (int w = 0; w < board.wordCount; w++)
+    {
+        uint64_t changed = board.dirty[w];
+        board.dirty[w] = 0;
+
+        while (changed != 0)
+        {
+            int index = w * bitsPerWord + lowestBit(changed);
+            changed &= changed - 1;
+            if (index >= cellCount)
+                break;
+
+            int value = board.get(index / board.cols, index % board.cols);
+            if (value < CELL_EMPTY)
+                value = CELL_EMPTY;    // Marks only exist while a capture runs
+
+            if (runLength > 0 && index == runStart + runLength && value == runValue) {
+                runLength++;
+                continue;
+            }
+            if (runLength > 0) {
+                writeVarint(writer, runStart - previousEnd);
+                writeVarint(writer, (unsigned int)runLength << 2 | runValue);
+                previousEnd = runStart + runLength;
+                runCount++;
+            }
+            runStart = index;
+            runLength = 1;
+            runValue = value;
+        }
+    }
+    if (runLength > 0) {
+        writeVarint(writer, runStart - previousEnd);
+        writeVarint(writer, (unsigned int)runLength << 2 | runValue);
+        runCount++;
+    }
+
+    for (int i = 0; i < 4; i++)
+        writer.data[countPosition + i] = (unsigned char)((unsigned int)runCount >> (8 * i));
+    return runCount;
+}
+
+/**
+ * Applies runs written by writeBoardDelta() to a board of the same size.
+ * Returns how many cells actually changed (those are marked dirty), or -1
+ * if the runs don't fit the board.
+ */
+int readBoardDelta(MessageReader &reader, Board &board)
+{
+    const int cellCount = board.rows * board.cols;
+    int runCount = int(readValue(reader, 4));
+    int position = 0;
+    int changedCells = 0;
+
+    for (int r = 0; r < runCount && !reader.failed; r++)
+    {
+        unsigned int gap = readVarint(reader);
+        unsigned int packed = readVarint(reader);
+        unsigned int length = packed >> 2;
+        int value = int(packed & 3);
+        if (gap > unsigned(cellCount - position) || length > unsigned(cellCount - position) - gap || value > CELL_TRAIL)
+            return -1;
+
+        position += int(gap);
+        for (unsigned int i = 0; i < length; i++, position++)
+        {
+            int y = position / board.cols;
+            int x = position % board.cols;
+            if (board.get(y, x) != value) {
+                board.set(y, x, value);
+                changedCells++;
+            }
+        }
+    }
+    return reader.failed ? -1 : changedCells;
+}
+
+EnemyTrack::EnemyTrack()
+{
+    count = 0;
+    data = 0;
+    x = y = lastX = lastY = motion = 0;
+}
+
+EnemyTrack::~EnemyTrack()
+{
+    delete[] data;
+}
+
+static int quantizePosition(float position)
+{
+    return int(lroundf(position * enemyPositionScale));
+}
+
+static unsigned int zigzag(int value)
+{
+    return (unsigned int)value << 1 ^ (unsigned int)(value >> 31);
+}
+
+static int unzigzag(unsigned int value)
+{
+    return int(value >> 1) ^ -int(value & 1);
+}
+
+// Both ends start their tracks from the same game, standing still
+void startEnemyTrack(EnemyTrack &track, const EnemyPool &enemies)
+{
+    if (track.count != enemies.count) {
+        delete[] track.data;
+        track.count = enemies.count;
+        track.data = new int[5 * track.count];
+        track.x = track.data;
+        track.y = track.x + track.count;
+        track.lastX = track.y + track.count;
+        track.lastY = track.lastX + track.count;
+        track.motion = track.lastY + track.count;
+    }
+    for (int i = 0; i < track.count; i++) {
+        track.x[i] = track.lastX[i] = quantizePosition(enemies.x[i]);
+        track.y[i] = track.lastY[i] = quantizePosition(enemies.y[i]);
+        track.motion[i] = enemies.motion[i];
+    }
+}
+
+/**
+ * Writes the enemies as corrections to the track's prediction and moves
+ * the track on to them, the track has to have been started from the same
+ * number of enemies. The enemy count is followed by the enemies whose
+ * quantized position differs from the prediction, as the index gap since
+ * the last one and the x and y error (zigzag varints), then the enemies
+ * whose motion changed as the index gap and u8 motion + 1. Both lists
+ * start with a u32 count. Returns how many enemies were off their
+ * prediction.
+ */
+int writeEnemyDelta(MessageWriter &writer, EnemyTrack &track, const EnemyPool &enemies)
+{
+    writeVarint(writer, track.count);
+
+    int countPosition = writer.length;
+    writeValue(writer, 0, 4);
+    int moved = 0, previous = 0;
+    for (int i = 0; i < track.count; i++)
+    {
+        int x = quantizePosition(enemies.x[i]);
+        int y = quantizePosition(enemies.y[i]);
+        int errorX = x - (2 * track.x[i] - track.lastX[i]);
+        int errorY = y - (2 * track.y[i] - track.lastY[i]);
+        if (errorX != 0 || errorY != 0) {
+            writeVarint(writer, i - previous);
+            writeVarint(writer, zigzag(errorX));
+            writeVarint(writer, zigzag(errorY));
+            previous = i;
+            moved++;
+        }
+        track.lastX[i] = track.x[i];
+        track.lastY[i] = track.y[i];
+        track.x[i] = x;
+        track.y[i] = y;
+    }
+    for (int i = 0; i < 4; i++)
+        writer.data[countPosition + i] = (unsigned char)((unsigned int)moved >> (8 * i));
+
+    countPosition = writer.length;
+    writeValue(writer, 0, 4);
+    int changed = 0;
+    previous = 0;
+    for (int i = 0; i < track.count; i++)
+    {
+        if (enemies.motion[i] == track.motion[i])
+            continue;
+        writeVarint(writer, i - previous);
+        writeValue(writer, enemies.motion[i] + 1, 1);
+        track.motion[i] = enemies.motion[i];
+        previous = i;
+        changed++;
+    }
+    for (int i = 0; i < 4; i++)
+        writer.data[countPosition + i] = (unsigned char)((unsigned int)changed >> (8 * i));
+    return moved;
+}
+
+/**
+ * Applies what writeEnemyDelta() wrote to the track, and to enemies when
+ * given (the caller simulates its own enemies and only keeps the track in
+ * step). Returns false if the counts or indices don't fit the track.
+ */
+bool readEnemyDelta(MessageReader &reader, EnemyTrack &track, EnemyPool *enemies)
+{
+    if (readVarint(reader) != unsigned(track.count) || (enemies && enemies->count != track.count))
+        return false;
+
+    // Every enemy moves on to its prediction, the listed ones are corrected after
+    for (int i = 0; i < track.count; i++) {
+        int x = 2 * track.x[i] - track.lastX[i];
+        int y = 2 * track.y[i] - track.lastY[i];
+        track.lastX[i] = track.x[i];
+        track.lastY[i] = track.y[i];
+        track.x[i] = x;
+        track.y[i] = y;
+    }
+
+    unsigned int moved = readValue(reader, 4);
+    int index = 0;
+    for (unsigned int m = 0; m < moved && !reader.failed; m++)
+    {
+        unsigned int gap = readVarint(reader);
+        if (gap >= unsigned(track.count - index) || (m > 0 && gap == 0))
+            return false;
+        int errorX = unzigzag(readVarint(reader));
+        int errorY = unzigzag(readVarint(reader));
+        if (errorX < -maxTrackedPosition || errorX > maxTrackedPosition ||
+            errorY < -maxTrackedPosition || errorY > maxTrackedPosition)
+            return false;
+        index += int(gap);
+        track.x[index] += errorX;
+        track.y[index] += errorY;
+    }
+
+    unsigned int changed = readValue(reader, 4);
+    index = 0;
+    for (unsigned int c = 0; c < changed && !reader.failed; c++)
+    {
+        unsigned int gap = readVarint(reader);
+        int motion = int(readValue(reader, 1)) - 1;
+        if (gap >= unsigned(track.count - index) || (c > 0 && gap == 0) || motion > MOTION_HUNTER)
+            return false;
+        index += int(gap);
+        track.motion[index] = motion;
+    }
+    if (reader.failed)
+        return false;
+
+    for (int i = 0; i < track.count; i++)
+    {
+        // Far enough out to be garbage, and before predictions could overflow
+        if (track.x[i] < -maxTrackedPosition || track.x[i] > maxTrackedPosition ||
+            track.y[i] < -maxTrackedPosition || track.y[i] > maxTrackedPosition)
+            return false;
+        if (enemies) {
+            enemies->x[i] = enemies->previousX[i] = track.x[i] / enemyPositionScale;
+            enemies->y[i] = enemies->previousY[i] = track.y[i] / enemyPositionScale;
+            enemies->motion[i] = track.motion[i];
+        }
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef XONIX_NET_PROTOCOL_H
+#define XONIX_NET_PROTOCOL_H
+
+#include "Board.h"
+#include "Enemy.h"
+#include "NetSocket.h"
+
+const int netProtocolVersion = 3;    // 2: speed increases fire on the game clock, 3: enemies sent as deltas
+const int defaultNetPort = 7777;
+const float enemyPositionScale = 8;    // Enemy positions travel in eighths of a pixel
+
+// Every message starts with its type, see NetSocket.h for the framing
+enum NetMessageType
+{
+    MSG_HELLO = 1,     // Client to server on connecting: "XNET", u16 version
+    MSG_WELCOME,       // Server to each client when the match starts: its player index and the match settings
+    MSG_INPUT,         // Client to server every tick: u32 tick, u8 direction, u32 send time in microseconds
+    MSG_SNAPSHOT,      // Server to clients: the state of every player's game, see NetMatch.cpp
+    MSG_END            // Server to clients: every game is over, u32 score per player
+};
+
+/**
+ * A message being built. Values are little-endian, counts and board runs
+ * are varints (7 bits a byte, low bits first). The buffer is kept between
+ * messages so steady traffic never allocates.
+ */
+struct MessageWriter
+{
+    unsigned char *data;
+    int length, capacity;
+
+    MessageWriter();
+    ~MessageWriter();
+
+    MessageWriter(const MessageWriter &) = delete;
+    MessageWriter &operator=(const MessageWriter &) = delete;
+};
+
+// Reads a received message, running past the end sets failed and returns zeros from then on
+struct MessageReader
+{
+    const unsigned char *data;
+    int length, position;
+    bool failed;
+};
+
+void clearMessage(MessageWriter &writer);
+void writeValue(MessageWriter &writer, unsigned int value, int byteCount);
+void writeVarint(MessageWriter &writer, unsigned int value);
+void writeFloat(MessageWriter &writer, float value);
+void writeData(MessageWriter &writer, const unsigned char *data, int length);
+
+void startReading(MessageReader &reader, const NetMessage &message);
+unsigned int readValue(MessageReader &reader, int byteCount);
+unsigned int readVarint(MessageReader &reader);
+float readFloat(MessageReader &reader);
+const unsigned char *readData(MessageReader &reader, int length);
+
+/**
+ * Where one side of a connection last saw a game's enemies, in eighths of
+ * a pixel. Both ends keep the same track and predict that every enemy
+ * keeps the velocity it had between the last two snapshots, so only the
+ * ones that bounced, turned or changed motion cost anything to send.
+ */
+struct EnemyTrack
+{
+    int count;
+    int *data;                   // One buffer holding every array below, count entries each
+    int *x, *y;                  // Position at the last snapshot
+    int *lastX, *lastY;          // Position at the one before
+    int *motion;
+
+    EnemyTrack();
+    ~EnemyTrack();
+
+    EnemyTrack(const EnemyTrack &) = delete;
+    EnemyTrack &operator=(const EnemyTrack &) = delete;
+};
+
+int writeBoardDelta(MessageWriter &writer, Board &board);
+int readBoardDelta(MessageReader &reader, Board &board);
+void startEnemyTrack(EnemyTrack &track, const EnemyPool &enemies);
+int writeEnemyDelta(MessageWriter &writer, EnemyTrack &track, const EnemyPool &enemies);
+bool readEnemyDelta(MessageReader &reader, EnemyTrack &track, EnemyPool *enemies);
+
+#endif
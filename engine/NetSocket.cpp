@@ -0,0 +1,271 @@
+#include "NetSocket.h"
+#include "GrowArray.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define XONIX_HAS_SOCKETS
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0    // macOS uses SO_NOSIGPIPE on the socket instead
+#endif
+
+const int initialNetBufferSize = 4096;
+const int receiveChunkSize = 64 * 1024;
+
+NetConnection::NetConnection()
+{
+    socket = -1;
+    inData = outData = 0;
+    inStart = inCount = inCapacity = 0;
+    outCount = outCapacity = 0;
+    bytesSent = bytesReceived = 0;
+}
+
+NetConnection::~NetConnection()
+{
+    closeConnection(*this);
+    delete[] inData;
+    delete[] outData;
+}
+
+#ifdef XONIX_HAS_SOCKETS
+
+// Non-blocking, and without Nagle's delay since every message is latency sensitive
+static void configureSocket(int socket)
+{
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+// Listens for players on every interface, returns -1 if the port can't be used
+int openListener(int port)
+{
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        return -1;
+
+    int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)port);
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 8) != 0) {
+        close(listener);
+        return -1;
+    }
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+    return listener;
+}
+
+void closeListener(int listener)
+{
+    if (listener >= 0)
+        close(listener);
+}
+
+// Takes the next waiting player if there is one, never blocks
+bool acceptConnection(int listener, NetConnection &connection)
+{
+    int socket = accept(listener, 0, 0);
+    if (socket < 0)
+        return false;
+
+    closeConnection(connection);
+    configureSocket(socket);
+    connection.socket = socket;
+    return true;
+}
+
+// Connects to host:port, blocking until the connection is made or refused
+bool connectTo(NetConnection &connection, const char *host, int port)
+{
+    closeConnection(connection);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+
+    addrinfo *addresses = 0;
+    if (getaddrinfo(host, service, &hints, &addresses) != 0)
+        return false;
+
+    for (addrinfo *a = addresses; a != 0; a = a->ai_next)
+    {
+        int socket = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (socket < 0)
+            continue;
+        if (connect(socket, a->ai_addr, a->ai_addrlen) == 0) {
+            configureSocket(socket);
+            connection.socket = socket;
+            break;
+        }
+        close(socket);
+    }
+    freeaddrinfo(addresses);
+    return connection.socket >= 0;
+}
+
+// Drops the socket and anything still buffered, the byte counts are kept
+void closeConnection(NetConnection &connection)
+{
+    if (connection.socket >= 0)
+        close(connection.socket);
+    connection.socket = -1;
+    connection.inStart = connection.inCount = 0;
+    connection.outCount = 0;
+}
+
+/**
+ * Sends as much of the queued data as the socket takes without blocking.
+ * Returns false, closing the connection, if the other side went away.
+ */
+bool flushConnection(NetConnection &connection)
+{
+    int sent = 0;
+    while (connection.socket >= 0 && sent < connection.outCount)
+    {
+        ssize_t result = send(connection.socket, connection.outData + sent, connection.outCount - sent, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            closeConnection(connection);
+            return false;
+        }
+        sent += int(result);
+        connection.bytesSent += result;
+    }
+
+    if (sent > 0) {
+        memmove(connection.outData, connection.outData + sent, connection.outCount - sent);
+        connection.outCount -= sent;
+    }
+    return connection.socket >= 0;
+}
+
+/**
+ * Reads whatever has arrived without blocking. The messages returned by
+ * nextMessage() before this call are no longer valid afterwards. Returns
+ * false when the other side closed the connection, the messages that
+ * arrived before that are still returned by nextMessage().
+ */
+bool receiveData(NetConnection &connection)
+{
+    if (connection.socket < 0)
+        return false;
+
+    // Drop the messages already read
+    if (connection.inStart > 0) {
+        memmove(connection.inData, connection.inData + connection.inStart, connection.inCount - connection.inStart);
+        connection.inCount -= connection.inStart;
+        connection.inStart = 0;
+    }
+
+    while (true)
+    {
+        growArray(connection.inData, connection.inCount, connection.inCapacity, connection.inCount + receiveChunkSize,
+                  initialNetBufferSize);
+        ssize_t result = recv(connection.socket, connection.inData + connection.inCount,
+                              connection.inCapacity - connection.inCount, 0);
+        if (result > 0) {
+            connection.inCount += int(result);
+            connection.bytesReceived += result;
+            continue;
+        }
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+
+        // Closed by the other side, what it sent before that can still be read
+        close(connection.socket);
+        connection.socket = -1;
+        return false;
+    }
+}
+
+#else
+
+// No socket support on this platform yet, every attempt to connect fails
+int openListener(int) { return -1; }
+void closeListener(int) {}
+bool acceptConnection(int, NetConnection &) { return false; }
+bool connectTo(NetConnection &, const char *, int) { return false; }
+
+void closeConnection(NetConnection &connection)
+{
+    connection.socket = -1;
+    connection.inStart = connection.inCount = 0;
+    connection.outCount = 0;
+}
+
+bool flushConnection(NetConnection &) { return false; }
+bool receiveData(NetConnection &) { return false; }
+
+#endif
+
+bool isConnected(const NetConnection &connection)
+{
+    return connection.socket >= 0;
+}
+
+// Adds a message to the outgoing queue, flushConnection() sends it
+void queueMessage(NetConnection &connection, int type, const unsigned char *body, int length)
+{
+    growArray(connection.outData, connection.outCount, connection.outCapacity, connection.outCount + netHeaderSize + length,
+              initialNetBufferSize);
+    unsigned char *out = connection.outData + connection.outCount;
+    for (int i = 0; i < 4; i++)
+        out[i] = (unsigned char)((unsigned int)length >> (8 * i));
+    out[4] = (unsigned char)type;
+    if (length > 0)
+        memcpy(out + netHeaderSize, body, length);
+    connection.outCount += netHeaderSize + length;
+}
+
+/**
+ * Takes the next complete message out of the received data. Returns false
+ * when no whole message is waiting, or the stream is broken (the
+ * connection is closed then).
+ */
+bool nextMessage(NetConnection &connection, NetMessage &message)
+{
+    int available = connection.inCount - connection.inStart;
+    if (available < netHeaderSize)
+        return false;
+
+    const unsigned char *in = connection.inData + connection.inStart;
+    unsigned int length = in[0] | (in[1] << 8) | (in[2] << 16) | ((unsigned int)in[3] << 24);
+    if (length > (unsigned int)maxNetMessageSize) {
+        closeConnection(connection);
+        return false;
+    }
+    if (available < netHeaderSize + int(length))
+        return false;
+
+    message.type = in[4];
+    message.body = in + netHeaderSize;
+    message.length = int(length);
+    connection.inStart += netHeaderSize + int(length);
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef XONIX_NET_SOCKET_H
+#define XONIX_NET_SOCKET_H
+
+const int netHeaderSize = 5;                   // u32 length of the body, u8 message type
+const int maxNetMessageSize = 64 * 1024 * 1024;    // Anything longer is treated as a broken stream
+
+// A received message, body points into the connection's buffer until the next receiveData()
+struct NetMessage
+{
+    int type;
+    const unsigned char *body;
+    int length;
+};
+
+/**
+ * A non-blocking TCP connection exchanging length-prefixed messages.
+ * Outgoing messages are queued and sent by flushConnection(), incoming
+ * bytes are gathered by receiveData() and split up by nextMessage(). Both
+ * directions are counted so callers can report bandwidth.
+ */
+struct NetConnection
+{
+    int socket;               // -1 when closed
+    unsigned char *inData;
+    int inStart, inCount, inCapacity;    // Unread bytes are [inStart, inCount)
+    unsigned char *outData;
+    int outCount, outCapacity;
+    long long bytesSent, bytesReceived;
+
+    NetConnection();
+    ~NetConnection();
+
+    NetConnection(const NetConnection &) = delete;
+    NetConnection &operator=(const NetConnection &) = delete;
+};
+
+int openListener(int port);
+void closeListener(int listener);
+bool acceptConnection(int listener, NetConnection &connection);
+bool connectTo(NetConnection &connection, const char *host, int port);
+void closeConnection(NetConnection &connection);
+bool isConnected(const NetConnection &connection);
+
+void queueMessage(NetConnection &connection, int type, const unsigned char *body, int length);
+bool flushConnection(NetConnection &connection);
+bool receiveData(NetConnection &connection);
+bool nextMessage(NetConnection &connection, NetMessage &message);
+
+#endif
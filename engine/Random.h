@@ -0,0 +1,41 @@
+#ifndef XONIX_RANDOM_H
+#define XONIX_RANDOM_H
+
+/**
+ * Small xorshift random number generator owned by each game.
+ * rand() is shared by the whole process, so two games running on different
+ * threads (or a game being replayed) could never get the same numbers back.
+ */
+struct Random
+{
+    unsigned int state;
+
+    Random()
+    {
+        seed(1);
+    }
+
+    void seed(unsigned int value)
+    {
+        // Scramble the seed so that neighbouring seeds give unrelated sequences
+        state = value * 2654435761u ^ 0x9E3779B9u;
+        if (state == 0)
+            state = 1;   // xorshift gets stuck on zero
+    }
+
+    unsigned int next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Returns a number from 0 to bound - 1, used the same way as rand() % bound
+    int nextInt(int bound)
+    {
+        return int(next() % (unsigned int)bound);
+    }
+};
+
+#endif
@@ -0,0 +1,324 @@
+#include "Regions.h"
+#include "GrowArray.h"
+#include <cstring>
+
+RegionTracker::RegionTracker()
+{
+    labels = 0;
+    cellCount = 0;
+    nextLabel = 1;
+    trailCells = 0;
+    trailCount = trailCapacity = 0;
+    fills = 0;
+    fillCapacity = 0;
+    fillParent = 0;
+    fillHasEnemy = 0;
+    activeFills = 0;
+    spans = 0;
+    spanCount = spanCapacity = 0;
+}
+
+RegionTracker::~RegionTracker()
+{
+    delete[] labels;
+    delete[] trailCells;
+    delete[] fills;
+    delete[] fillParent;
+    delete[] fillHasEnemy;
+    delete[] activeFills;
+    delete[] spans;
+}
+
+/**
+ * Labels a freshly initialised board: a new game has a single open region
+ */
+void resetRegions(RegionTracker &regions, const Board &board)
+{
+    int cellCount = board.rows * board.cols;
+    if (regions.cellCount != cellCount) {
+        delete[] regions.labels;
+        regions.labels = new int[cellCount];
+        regions.cellCount = cellCount;
+    }
+
+    for (int i = 0; i < cellCount; i++)
+        regions.labels[i] = board.isOpen(i) ? 1 : 0;
+
+    regions.nextLabel = 2;
+    regions.trailCount = 0;
+}
+
+// Sets the labels and trail being tracked, as saved from another tracker
+void loadRegions(RegionTracker &regions, const int *labels, int cellCount, int nextLabel,
+                 const int *trailCells, int trailCount)
+{
+    if (regions.cellCount != cellCount) {
+        delete[] regions.labels;
+        regions.labels = new int[cellCount];
+        regions.cellCount = cellCount;
+    }
+    memcpy(regions.labels, labels, sizeof(int) * cellCount);
+    regions.nextLabel = nextLabel;
+
+    growArray(regions.trailCells, 0, regions.trailCapacity, trailCount);
+    memcpy(regions.trailCells, trailCells, sizeof(int) * trailCount);
+    regions.trailCount = trailCount;
+}
+
+// Makes to track the same regions and trail as from, the capture scratch space isn't copied
+void copyRegions(RegionTracker &to, const RegionTracker &from)
+{
+    loadRegions(to, from.labels, from.cellCount, from.nextLabel, from.trailCells, from.trailCount);
+}
+
+// Called for every cell the player turns into trail, trail cells belong to no region
+void addTrailCell(RegionTracker &regions, int index)
+{
+    regions.labels[index] = 0;
+    growArray(regions.trailCells, regions.trailCount, regions.trailCapacity, regions.trailCount + 1);
+    regions.trailCells[regions.trailCount++] = index;
+}
+
+static int findFill(RegionTracker &regions, int fill)
+{
+    while (regions.fillParent[fill] != fill) {
+        regions.fillParent[fill] = regions.fillParent[regions.fillParent[fill]];
+        fill = regions.fillParent[fill];
+    }
+    return fill;
+}
+
+// Two fills reached each other so they are exploring the same pocket, the smaller stack is moved onto the bigger one
+static void mergeFills(RegionTracker &regions, int a, int b)
+{
+    a = findFill(regions, a);
+    b = findFill(regions, b);
+    if (a == b)
+        return;
+
+    if (regions.fills[a].count < regions.fills[b].count) {
+        int swap = a;
+        a = b;
+        b = swap;
+    }
+
+    FloodFillWorkspace &from = regions.fills[b];
+    for (int i = 0; i < from.count; i++)
+        regions.fills[a].push(from.seeds[i]);
+    from.count = 0;
+    regions.fillParent[b] = a;
+}
+
+/**
+ * Runs one span of a fill: widens a seed over the cells still carrying the
+ * old region label, relabels them for this fill and queues the runs above
+ * and below. Cells that already belong to another fill merge the two.
+ */
+static void stepFill(RegionTracker &regions, const Board &board, int fill, int oldLabel, int firstLabel)
+{
+    int *labels = regions.labels;
+    const int cols = board.cols;
+
+    FloodFillWorkspace &work = regions.fills[fill];
+    int seed = work.seeds[--work.count];
+    if (labels[seed] != oldLabel) {
+        if (labels[seed] >= firstLabel)
+            mergeFills(regions, fill, labels[seed] - firstLabel);
+        return;
+    }
+
+    int rowStart = seed - seed % cols;
+    int rowEnd = rowStart + cols - 1;
+    int left = seed;
+    int right = seed;
+    while (left > rowStart && labels[left - 1] == oldLabel)
+        left--;
+    while (right < rowEnd && labels[right + 1] == oldLabel)
+        right++;
+
+    int label = firstLabel + fill;
+    for (int i = left; i <= right; i++)
+        labels[i] = label;
+
+    growArray(regions.spans, regions.spanCount, regions.spanCapacity, regions.spanCount + 1);
+    RegionSpan span = {left, right - left + 1, fill};
+    regions.spans[regions.spanCount++] = span;
+
+    // Cells next to the span that another fill already took
+    if (left > rowStart && labels[left - 1] >= firstLabel)
+        mergeFills(regions, fill, labels[left - 1] - firstLabel);
+    if (right < rowEnd && labels[right + 1] >= firstLabel)
+        mergeFills(regions, fill, labels[right + 1] - firstLabel);
+
+    // Queue the runs of the old region touching this span on the rows above and below
+    for (int direction = -1; direction <= 1; direction += 2)
+    {
+        int offset = direction * cols;
+        if (rowStart + offset < 0 || rowStart + offset >= board.rows * cols)
+            continue;
+
+        for (int i = left; i <= right; i++)
+        {
+            int neighbour = i + offset;
+            int neighbourLabel = labels[neighbour];
+            if (neighbourLabel == oldLabel) {
+                if (i == left || labels[neighbour - 1] != oldLabel)
+                    regions.fills[findFill(regions, fill)].push(neighbour);
+            }
+            else if (neighbourLabel >= firstLabel)
+                mergeFills(regions, fill, neighbourLabel - firstLabel);
+        }
+    }
+}
+
+/**
+ * Drops the fills that ran out of seeds or were merged into another from
+ * the worklist, keeping the rest in order, and returns how many are left.
+ * A fill never starts growing again once it is off the list: a merge
+ * keeps whichever of the two has more seeds.
+ */
+static int compactActiveFills(RegionTracker &regions, int activeCount)
+{
+    int kept = 0;
+    for (int a = 0; a < activeCount; a++) {
+        int f = regions.activeFills[a];
+        if (regions.fillParent[f] == f && regions.fills[f].count > 0)
+            regions.activeFills[kept++] = f;
+    }
+    return kept;
+}
+
+/**
+ * Commits the player's trail and fills every pocket it sealed off that has
+ * no enemy in it. enemyCells holds the flat cell index of each enemy, or -1.
+ *
+ * A fill is started next to every trail cell and all of them advance one
+ * span at a time, merging when they meet. A fill that runs out of seeds has
+ * explored a whole pocket. Once only one fill is still going it must be the
+ * rest of the old region, so it is left alone when it holds an enemy. The
+ * work done is therefore bounded by the size of the smaller pockets, not by
+ * the board. Returns the number of newly filled cells, trail included.
+ */
+int captureTrail(RegionTracker &regions, Board &board, const int *enemyCells, int enemyCount)
+{
+    const int rows = board.rows;
+    const int cols = board.cols;
+    int *labels = regions.labels;
+    int capturedCells = 0;
+
+    // The trail itself is always captured
+    for (int t = 0; t < regions.trailCount; t++) {
+        int index = regions.trailCells[t];
+        board.set(index / cols, index % cols, CELL_FILLED);
+        capturedCells++;
+    }
+
+    // Every open cell next to the trail belongs to the region the trail was drawn through
+    int maxFills = regions.trailCount * 4;
+    if (maxFills > regions.fillCapacity) {
+        delete[] regions.fills;
+        delete[] regions.fillParent;
+        delete[] regions.fillHasEnemy;
+        delete[] regions.activeFills;
+        regions.fills = new FloodFillWorkspace[maxFills];
+        regions.fillParent = new int[maxFills];
+        regions.fillHasEnemy = new bool[maxFills];
+        regions.activeFills = new int[maxFills];
+        regions.fillCapacity = maxFills;
+    }
+
+    int oldLabel = 0;
+    int firstLabel = regions.nextLabel;
+    int fillCount = 0;
+    const int offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+    for (int t = 0; t < regions.trailCount; t++)
+    {
+        int index = regions.trailCells[t];
+        int y = index / cols;
+        int x = index % cols;
+        for (int k = 0; k < 4; k++)
+        {
+            int ny = y + offsets[k][0];
+            int nx = x + offsets[k][1];
+            if (ny < 0 || ny >= rows || nx < 0 || nx >= cols)
+                continue;
+
+            int neighbour = ny * cols + nx;
+            if (labels[neighbour] == 0)
+                continue;
+            oldLabel = labels[neighbour];
+
+            int fill = fillCount++;
+            regions.fills[fill].count = 0;
+            regions.fills[fill].push(neighbour);
+            regions.fillParent[fill] = fill;
+            regions.fillHasEnemy[fill] = false;
+            regions.activeFills[fill] = fill;
+        }
+    }
+    regions.trailCount = 0;
+    regions.spanCount = 0;
+    regions.nextLabel = firstLabel + fillCount;
+
+    if (fillCount == 0)
+        return capturedCells;
+
+    // Advance all fills together until at most one is left exploring, each round only visits the ones still going
+    int activeCount = fillCount;
+    while ((activeCount = compactActiveFills(regions, activeCount)) > 1)
+        for (int a = 0; a < activeCount; a++) {
+            int f = regions.activeFills[a];
+            if (regions.fillParent[f] == f && regions.fills[f].count > 0)
+                stepFill(regions, board, f, oldLabel, firstLabel);
+        }
+    int remaining = activeCount == 1 ? regions.activeFills[0] : -1;
+
+    // Find out which pockets hold an enemy
+    bool enemyInRest = false;
+    for (int e = 0; e < enemyCount; e++)
+    {
+        if (enemyCells[e] < 0)
+            continue;
+        int label = labels[enemyCells[e]];
+        if (label >= firstLabel)
+            regions.fillHasEnemy[findFill(regions, label - firstLabel)] = true;
+        else if (label == oldLabel)
+            enemyInRest = true;    // Not reached yet, so it is in the part the last fill was exploring
+    }
+
+    // The last fill keeps the old label if it has an enemy, otherwise it is explored to the end and captured
+    bool keepRemaining = false;
+    if (remaining >= 0) {
+        keepRemaining = enemyInRest || regions.fillHasEnemy[remaining];
+        if (!keepRemaining)
+            while (regions.fills[remaining].count > 0)
+                stepFill(regions, board, remaining, oldLabel, firstLabel);
+    }
+
+    for (int s = 0; s < regions.spanCount; s++)
+    {
+        const RegionSpan &span = regions.spans[s];
+        int fill = findFill(regions, span.fill);
+        int last = span.start + span.length - 1;
+
+        if (fill == remaining && keepRemaining) {
+            for (int i = span.start; i <= last; i++)
+                labels[i] = oldLabel;
+        }
+        else if (!regions.fillHasEnemy[fill]) {
+            setBitRange(board.filled, span.start, last);
+            setBitRange(board.dirty, span.start, last);
+            for (int i = span.start; i <= last; i++)
+                labels[i] = 0;
+            capturedCells += span.length;
+        }
+        else {
+            // Merged fills share one label from now on
+            for (int i = span.start; i <= last; i++)
+                labels[i] = firstLabel + fill;
+        }
+    }
+
+    return capturedCells;
+}
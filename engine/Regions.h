@@ -0,0 +1,56 @@
+#ifndef XONIX_REGIONS_H
+#define XONIX_REGIONS_H
+
+#include "Board.h"
+#include "FloodFill.h"
+
+// One horizontal run of cells visited by a capture fill
+struct RegionSpan
+{
+    int start;     // Flat index of the first cell
+    int length;
+    int fill;      // Which fill visited it (index into the capture's fills)
+};
+
+/**
+ * Labels every open cell with the id of the connected open region it
+ * belongs to (0 for filled and trail cells), and remembers the trail the
+ * player is building. When the trail is committed only the pockets next to
+ * it are explored, so a capture costs time in proportion to the area that
+ * changed instead of the whole board.
+ */
+struct RegionTracker
+{
+    int *labels;
+    int cellCount;
+    int nextLabel;
+
+    int *trailCells;     // Flat indexes of the current trail, in the order they were laid
+    int trailCount;
+    int trailCapacity;
+
+    // Scratch space reused by every capture
+    FloodFillWorkspace *fills;    // One seed stack per fill started next to the trail
+    int fillCapacity;
+    int *fillParent;              // Fills that ran into each other are merged, union-find style
+    bool *fillHasEnemy;
+    int *activeFills;             // Fills that may still be growing, the rest are dropped as they finish
+    RegionSpan *spans;
+    int spanCount;
+    int spanCapacity;
+
+    RegionTracker();
+    ~RegionTracker();
+
+    RegionTracker(const RegionTracker &) = delete;
+    RegionTracker &operator=(const RegionTracker &) = delete;
+};
+
+void resetRegions(RegionTracker &regions, const Board &board);
+void loadRegions(RegionTracker &regions, const int *labels, int cellCount, int nextLabel,
+                 const int *trailCells, int trailCount);
+void copyRegions(RegionTracker &to, const RegionTracker &from);
+void addTrailCell(RegionTracker &regions, int index);
+int captureTrail(RegionTracker &regions, Board &board, const int *enemyCells, int enemyCount);
+
+#endif
@@ -0,0 +1,161 @@
+#include "Replay.h"
+#include "ByteOrder.h"
+#include "GrowArray.h"
+#include "SimulationClock.h"
+#include <cstring>
+#include <fstream>
+
+static const char replayMagic[4] = {'X', 'R', 'P', 'L'};
+const int replayHeaderSize = 32;
+
+Replay::Replay()
+{
+    runs = 0;
+    runCapacity = 0;
+    beginReplay(*this, 1, 1, defaultRows, defaultCols, enemyCountForDifficulty(1), defaultTickRate);
+}
+
+Replay::~Replay()
+{
+    delete[] runs;
+}
+
+// Drops any recorded input and starts a new recording for a game started with these settings
+void beginReplay(Replay &replay, unsigned int seed, int difficultyLevel, int rows, int cols, int enemyCount, float tickRate, int hunterCount)
+{
+    replay.seed = seed;
+    replay.difficultyLevel = difficultyLevel;
+    replay.rows = rows;
+    replay.cols = cols;
+    replay.enemyCount = enemyCount;
+    replay.hunterCount = hunterCount;
+    replay.tickRate = tickRate;
+    replay.tickCount = 0;
+    replay.runCount = 0;
+}
+
+// Adds the input given to updateGame() for the next tick
+void recordReplayTick(Replay &replay, Direction input)
+{
+    replay.tickCount++;
+
+    // Lengthen the last run when the input is the same and it still has room
+    if (replay.runCount > 0) {
+        unsigned char &last = replay.runs[replay.runCount - 1];
+        if ((last >> 5) == input && (last & 31) < maxReplayRun - 1) {
+            last++;
+            return;
+        }
+    }
+
+    growArray(replay.runs, replay.runCount, replay.runCapacity, replay.runCount + 1, initialReplayCapacity);
+    replay.runs[replay.runCount++] = (unsigned char)(input << 5);
+}
+
+bool saveReplay(const Replay &replay, const char *path)
+{
+    unsigned char header[replayHeaderSize];
+    unsigned char *out = header;
+    unsigned int tickRateBits;
+    memcpy(&tickRateBits, &replay.tickRate, sizeof(tickRateBits));
+
+    memcpy(out, replayMagic, 4);
+    out += 4;
+    putBytes(out, replayVersion, 2);
+    putBytes(out, replay.difficultyLevel, 1);
+    putBytes(out, replay.hunterCount, 1);
+    putBytes(out, replay.seed, 4);
+    putBytes(out, replay.rows, 2);
+    putBytes(out, replay.cols, 2);
+    putBytes(out, replay.enemyCount, 4);
+    putBytes(out, tickRateBits, 4);
+    putBytes(out, replay.tickCount, 4);
+    putBytes(out, replay.runCount, 4);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write((const char *)header, replayHeaderSize);
+    file.write((const char *)replay.runs, replay.runCount);
+    return bool(file);
+}
+
+// Reads a replay written by saveReplay(), returns false (leaving replay unusable) if the file is not a valid one
+bool loadReplay(Replay &replay, const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    unsigned char header[replayHeaderSize];
+    if (!file.read((char *)header, replayHeaderSize) || memcmp(header, replayMagic, 4) != 0)
+        return false;
+
+    const unsigned char *in = header + 4;
+    if (int(getBytes(in, 2)) != replayVersion)
+        return false;
+    replay.difficultyLevel = int(getBytes(in, 1));
+    replay.hunterCount = int(getBytes(in, 1));
+    replay.seed = getBytes(in, 4);
+    replay.rows = int(getBytes(in, 2));
+    replay.cols = int(getBytes(in, 2));
+    replay.enemyCount = int(getBytes(in, 4));
+    unsigned int tickRateBits = getBytes(in, 4);
+    memcpy(&replay.tickRate, &tickRateBits, sizeof(tickRateBits));
+    replay.tickCount = int(getBytes(in, 4));
+    int runCount = int(getBytes(in, 4));
+
+    if (!isValidBoardSize(replay.rows, replay.cols) || replay.difficultyLevel < 1 || replay.difficultyLevel > 3 ||
+        replay.enemyCount <= 0 || replay.enemyCount > maxEnemyCount || replay.hunterCount > replay.enemyCount ||
+        !(replay.tickRate > 0) || replay.tickCount < 0 || runCount < 0)
+        return false;
+
+    // The runs are the rest of the file, a count past its end is refused before anything is allocated for it
+    std::streamoff runsStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff fileSize = file.tellg();
+    file.seekg(runsStart);
+    if (!file || runCount > fileSize - runsStart)
+        return false;
+
+    replay.runCount = 0;
+    growArray(replay.runs, 0, replay.runCapacity, runCount, initialReplayCapacity);
+    if (runCount > 0 && !file.read((char *)replay.runs, runCount))
+        return false;
+    replay.runCount = runCount;
+
+    // The runs have to add up to the tick count and hold real directions
+    long long ticks = 0;
+    for (int r = 0; r < runCount; r++) {
+        if ((replay.runs[r] >> 5) > DIR_DOWN)
+            return false;
+        ticks += (replay.runs[r] & 31) + 1;
+    }
+    return ticks == replay.tickCount;
+}
+
+// Starts the game the replay was recorded from, playback then feeds nextReplayInput() to updateGame()
+void startReplayGame(Game &game, const Replay &replay, ReplayCursor &cursor)
+{
+    startGame(game, replay.difficultyLevel, replay.seed, replay.rows, replay.cols, replay.enemyCount, replay.hunterCount);
+    cursor.run = 0;
+    cursor.tickInRun = 0;
+    cursor.tick = 0;
+}
+
+bool replayFinished(const Replay &replay, const ReplayCursor &cursor)
+{
+    return cursor.tick >= replay.tickCount;
+}
+
+// Input for the next tick, DIR_NONE once the replay has run out
+Direction nextReplayInput(const Replay &replay, ReplayCursor &cursor)
+{
+    if (replayFinished(replay, cursor))
+        return DIR_NONE;
+
+    unsigned char run = replay.runs[cursor.run];
+    cursor.tick++;
+    if (++cursor.tickInRun > (run & 31)) {
+        cursor.run++;
+        cursor.tickInRun = 0;
+    }
+    return Direction(run >> 5);
+}
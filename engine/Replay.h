@@ -0,0 +1,57 @@
+#ifndef XONIX_REPLAY_H
+#define XONIX_REPLAY_H
+
+#include "Game.h"
+
+const int replayVersion = 2;    // 2: speed increases fire on the game clock, so version 1 replays play out differently
+const int initialReplayCapacity = 256;
+const int maxReplayRun = 32;    // Ticks one byte of input can cover
+const int maxReplayHunters = 255;    // The header keeps the hunter count in one byte
+
+/**
+ * Everything needed to play a game again tick for tick: how it was started
+ * and the input of every tick. Input is stored as runs of the same
+ * direction, one byte each (direction in the top 3 bits, run length - 1 in
+ * the low 5), so a minute of play usually takes a few hundred bytes.
+ *
+ * File layout, little-endian: "XRPL", u16 version, u8 difficulty, u8 hunters,
+ * u32 seed, u16 rows, u16 cols, u32 enemy count, f32 tick rate,
+ * u32 tick count, u32 run count, then the run bytes.
+ */
+struct Replay
+{
+    unsigned int seed;
+    int difficultyLevel;
+    int rows, cols;
+    int enemyCount;
+    int hunterCount;         // How many of the enemies hunt the trail, 0 in replays from before hunters
+    float tickRate;          // Ticks per second the game ran at, every tick was 1 / tickRate seconds
+    int tickCount;
+    unsigned char *runs;
+    int runCount, runCapacity;
+
+    Replay();
+    ~Replay();
+
+    Replay(const Replay &) = delete;
+    Replay &operator=(const Replay &) = delete;
+};
+
+// Where playback has got to in a replay's input
+struct ReplayCursor
+{
+    int run;
+    int tickInRun;
+    int tick;
+};
+
+void beginReplay(Replay &replay, unsigned int seed, int difficultyLevel, int rows, int cols, int enemyCount, float tickRate, int hunterCount = 0);
+void recordReplayTick(Replay &replay, Direction input);
+bool saveReplay(const Replay &replay, const char *path);
+bool loadReplay(Replay &replay, const char *path);
+
+void startReplayGame(Game &game, const Replay &replay, ReplayCursor &cursor);
+bool replayFinished(const Replay &replay, const ReplayCursor &cursor);
+Direction nextReplayInput(const Replay &replay, ReplayCursor &cursor);
+
+#endif
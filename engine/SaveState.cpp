@@ -0,0 +1,428 @@
+#include "SaveState.h"
+#include "ByteOrder.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+static const char saveStateMagic[4] = {'X', 'S', 'A', 'V'};
+const unsigned int byteOrderMark = 0x01020304;
+const int groupStartOffset = 72;
+const int enemyFloatArrays = 8;
+
+const int statsOffset = groupStartOffset + (numOfMotionGroups + 1) * 4;
+
+static_assert(statsOffset + 28 <= saveStateHeaderSize, "enemy groups, stats and the event counters must fit the header");
+static_assert(sizeof(ScheduledEvent) == 16, "events are saved as they are in memory");
+
+// Bits of the flags byte
+const int FLAG_PREV_ON_BORDER = 1;
+const int FLAG_RUNNING = 2;
+// 4 was whether the enemies had switched pattern, the pending events say that now
+const int FLAG_FULL_BOARD_CAPTURE = 8;
+const int FLAG_TRAIL_THREATENED = 16;
+
+// Where each array of a snapshot starts, worked out from the sizes in its header
+struct SaveStateLayout
+{
+    size_t filled, trail;
+    size_t enemyFloats[enemyFloatArrays];
+    size_t motion;
+    size_t labels;
+    size_t trailCells;
+    size_t events;
+    size_t size;
+};
+
+static size_t alignOffset(size_t offset)
+{
+    return (offset + saveStateAlignment - 1) / saveStateAlignment * saveStateAlignment;
+}
+
+static SaveStateLayout layoutFor(int rows, int cols, int enemyCount, int trailCount, int eventCount)
+{
+    SaveStateLayout layout;
+    size_t cellCount = size_t(rows) * cols;
+    size_t wordCount = (cellCount + bitsPerWord - 1) / bitsPerWord;
+
+    size_t offset = saveStateHeaderSize;
+    layout.filled = offset;
+    offset = alignOffset(offset + wordCount * sizeof(uint64_t));
+    layout.trail = offset;
+    offset = alignOffset(offset + wordCount * sizeof(uint64_t));
+    for (int f = 0; f < enemyFloatArrays; f++) {
+        layout.enemyFloats[f] = offset;
+        offset = alignOffset(offset + size_t(enemyCount) * sizeof(float));
+    }
+    layout.motion = offset;
+    offset = alignOffset(offset + size_t(enemyCount) * sizeof(int));
+    layout.labels = offset;
+    offset = alignOffset(offset + cellCount * sizeof(int));
+    layout.trailCells = offset;
+    offset = alignOffset(offset + size_t(trailCount) * sizeof(int));
+    layout.events = offset;
+    layout.size = offset + size_t(eventCount) * sizeof(ScheduledEvent);
+    return layout;
+}
+
+// The enemy arrays that are saved, in file order
+static float *enemyFloatArray(const EnemyPool &pool, int f)
+{
+    float *const arrays[enemyFloatArrays] = {pool.x, pool.y, pool.dx, pool.dy, pool.previousX, pool.previousY,
+                                             pool.speedInitial, pool.timeOfPattern};
+    return arrays[f];
+}
+
+static void putFloat(unsigned char *&out, float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putBytes(out, bits, 4);
+}
+
+static float getFloat(const unsigned char *&in)
+{
+    unsigned int bits = getBytes(in, 4);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// The header fields restoreSaveState() needs before it can touch the arrays
+struct SaveStateHeader
+{
+    int version;
+    int difficultyLevel;
+    int flags;
+    unsigned int byteOrder;
+    int rows, cols;
+    int enemyCount;
+    int playerX, playerY, moveX, moveY;
+    int moveCounter;
+    float playerTimer, elapsedTime, speedMultiplier;
+    int eventCount;
+    unsigned int rngState;
+    int nextLabel;
+    int trailCount;
+    size_t size;
+    int groupStart[numOfMotionGroups + 1];
+    int captures, capturedCells, nearMisses, longestTrail, startFilled;
+    unsigned int nextEventOrder;
+    int freezeEffects;
+};
+
+static bool readHeader(const unsigned char *data, size_t size, SaveStateHeader &header)
+{
+    if (!data || size < size_t(saveStateHeaderSize) || memcmp(data, saveStateMagic, 4) != 0)
+        return false;
+
+    const unsigned char *in = data + 4;
+    header.version = int(getBytes(in, 2));
+    header.difficultyLevel = int(getBytes(in, 1));
+    header.flags = int(getBytes(in, 1));
+    memcpy(&header.byteOrder, in, 4);
+    in += 4;
+    header.rows = int(getBytes(in, 2));
+    header.cols = int(getBytes(in, 2));
+    header.enemyCount = int(getBytes(in, 4));
+    header.playerX = int(getBytes(in, 4));
+    header.playerY = int(getBytes(in, 4));
+    header.moveX = int(getBytes(in, 4));
+    header.moveY = int(getBytes(in, 4));
+    header.moveCounter = int(getBytes(in, 4));
+    header.playerTimer = getFloat(in);
+    header.elapsedTime = getFloat(in);
+    header.eventCount = int(getBytes(in, 4));
+    header.speedMultiplier = getFloat(in);
+    header.rngState = getBytes(in, 4);
+    header.nextLabel = int(getBytes(in, 4));
+    header.trailCount = int(getBytes(in, 4));
+    header.size = getBytes(in, 4);
+    for (int g = 0; g <= numOfMotionGroups; g++)
+        header.groupStart[g] = int(getBytes(in, 4));
+    header.captures = int(getBytes(in, 4));
+    header.capturedCells = int(getBytes(in, 4));
+    header.nearMisses = int(getBytes(in, 4));
+    header.longestTrail = int(getBytes(in, 4));
+    header.startFilled = int(getBytes(in, 4));
+    header.nextEventOrder = getBytes(in, 4);
+    header.freezeEffects = int(getBytes(in, 4));
+
+    if (header.version != saveStateVersion || header.byteOrder != byteOrderMark ||
+        !isValidBoardSize(header.rows, header.cols) || header.enemyCount < 0 || header.trailCount < 0 ||
+        header.trailCount > header.rows * header.cols || header.eventCount < 0 || header.size != size)
+        return false;
+    if (header.enemyCount > int(size / (enemyFloatArrays * sizeof(float))) ||
+        header.eventCount > int(size / sizeof(ScheduledEvent)))
+        return false;    // Keeps the layout below from overflowing on a bad count
+    return layoutFor(header.rows, header.cols, header.enemyCount, header.trailCount, header.eventCount).size == size;
+}
+
+SaveState::SaveState()
+{
+    data = 0;
+    size = 0;
+    buffer = 0;
+    capacity = 0;
+    mapped = false;
+}
+
+SaveState::~SaveState()
+{
+    closeSaveState(*this);
+    delete[] buffer;
+}
+
+/**
+ * Takes a snapshot of the game into the state's own buffer, which is only
+ * reallocated when the snapshot outgrows it. Closes any file the state had
+ * open.
+ */
+void captureSaveState(SaveState &state, const Game &game)
+{
+    closeSaveState(state);
+
+    const Board &board = game.board;
+    const EnemyPool &enemies = game.enemies;
+    const RegionTracker &regions = game.regions;
+    SaveStateLayout layout = layoutFor(board.rows, board.cols, enemies.count, regions.trailCount, game.events.count);
+    if (layout.size > state.capacity) {
+        delete[] state.buffer;
+        state.buffer = new unsigned char[layout.size];
+        state.capacity = layout.size;
+    }
+
+    unsigned char *out = state.buffer;
+    memset(out, 0, saveStateHeaderSize);
+    memcpy(out, saveStateMagic, 4);
+    out += 4;
+    int flags = (game.prevOnBorder ? FLAG_PREV_ON_BORDER : 0) | (game.running ? FLAG_RUNNING : 0) |
+                (game.captureMode == CAPTURE_FULL_BOARD ? FLAG_FULL_BOARD_CAPTURE : 0) |
+                (game.stats.trailThreatened ? FLAG_TRAIL_THREATENED : 0);
+    putBytes(out, saveStateVersion, 2);
+    putBytes(out, game.difficultyLevel, 1);
+    putBytes(out, flags, 1);
+    memcpy(out, &byteOrderMark, 4);
+    out += 4;
+    putBytes(out, board.rows, 2);
+    putBytes(out, board.cols, 2);
+    putBytes(out, enemies.count, 4);
+    putBytes(out, game.playerX, 4);
+    putBytes(out, game.playerY, 4);
+    putBytes(out, game.moveX, 4);
+    putBytes(out, game.moveY, 4);
+    putBytes(out, game.moveCounter, 4);
+    putFloat(out, game.playerTimer);
+    putFloat(out, game.elapsedTime);
+    putBytes(out, game.events.count, 4);
+    putFloat(out, game.speedMultiplier);
+    putBytes(out, game.rng.state, 4);
+    putBytes(out, regions.nextLabel, 4);
+    putBytes(out, regions.trailCount, 4);
+    putBytes(out, (unsigned int)layout.size, 4);
+    for (int g = 0; g <= numOfMotionGroups; g++)
+        putBytes(out, enemies.groupStart[g], 4);
+    putBytes(out, game.stats.captures, 4);
+    putBytes(out, game.stats.capturedCells, 4);
+    putBytes(out, game.stats.nearMisses, 4);
+    putBytes(out, game.stats.longestTrail, 4);
+    putBytes(out, game.stats.startFilled, 4);
+    putBytes(out, game.events.nextOrder, 4);
+    putBytes(out, game.freezeEffects, 4);
+
+    // The arrays go in as they are, with the alignment padding zeroed so saved files are reproducible
+    unsigned char *base = state.buffer;
+    memset(base + saveStateHeaderSize, 0, layout.size - saveStateHeaderSize);
+    memcpy(base + layout.filled, board.filled, sizeof(uint64_t) * board.wordCount);
+    memcpy(base + layout.trail, board.trail, sizeof(uint64_t) * board.wordCount);
+    for (int f = 0; f < enemyFloatArrays; f++)
+        memcpy(base + layout.enemyFloats[f], enemyFloatArray(enemies, f), sizeof(float) * enemies.count);
+    memcpy(base + layout.motion, enemies.motion, sizeof(int) * enemies.count);
+    memcpy(base + layout.labels, regions.labels, sizeof(int) * regions.cellCount);
+    memcpy(base + layout.trailCells, regions.trailCells, sizeof(int) * regions.trailCount);
+    memcpy(base + layout.events, game.events.heap, sizeof(ScheduledEvent) * game.events.count);
+
+    state.data = state.buffer;
+    state.size = layout.size;
+}
+
+/**
+ * Puts the game back exactly as it was when the snapshot was taken, so it
+ * plays out the same from there given the same input. Only the header is
+ * checked here; files are checked in full when they are opened. Cells that
+ * change are marked dirty on the board. Returns false, leaving the game
+ * alone, if the state doesn't hold a valid snapshot.
+ */
+bool restoreSaveState(Game &game, const SaveState &state)
+{
+    SaveStateHeader header;
+    if (!readHeader(state.data, state.size, header))
+        return false;
+
+    const unsigned char *base = state.data;
+    SaveStateLayout layout = layoutFor(header.rows, header.cols, header.enemyCount, header.trailCount,
+                                       header.eventCount);
+    loadBoardCells(game.board, header.rows, header.cols,
+                   (const uint64_t *)(base + layout.filled), (const uint64_t *)(base + layout.trail));
+    loadRegions(game.regions, (const int *)(base + layout.labels), header.rows * header.cols, header.nextLabel,
+                (const int *)(base + layout.trailCells), header.trailCount);
+
+    EnemyPool &enemies = game.enemies;
+    clearEnemies(enemies);
+    enemies.reserve(header.enemyCount);
+    for (int f = 0; f < enemyFloatArrays; f++)
+        memcpy(enemyFloatArray(enemies, f), base + layout.enemyFloats[f], sizeof(float) * header.enemyCount);
+    memcpy(enemies.motion, base + layout.motion, sizeof(int) * header.enemyCount);
+    memcpy(enemies.groupStart, header.groupStart, sizeof(enemies.groupStart));
+    enemies.count = header.enemyCount;
+    if (hunterCount(enemies) > 0)
+        rebuildTrailDistances(game.trailDistances, game.board, game.regions.trailCells, game.regions.trailCount);
+    else
+        resetTrailDistances(game.trailDistances, game.board);
+
+    game.difficultyLevel = header.difficultyLevel;
+    game.playerX = header.playerX;
+    game.playerY = header.playerY;
+    game.moveX = header.moveX;
+    game.moveY = header.moveY;
+    game.playerTimer = header.playerTimer;
+    game.moveCounter = header.moveCounter;
+    game.prevOnBorder = (header.flags & FLAG_PREV_ON_BORDER) != 0;
+    game.running = (header.flags & FLAG_RUNNING) != 0;
+
+    game.elapsedTime = header.elapsedTime;
+    game.speedMultiplier = header.speedMultiplier;
+    loadEvents(game.events, (const ScheduledEvent *)(base + layout.events), header.eventCount, header.nextEventOrder);
+    game.freezeEffects = header.freezeEffects;
+
+    game.rng.state = header.rngState;
+    game.captureMode = (header.flags & FLAG_FULL_BOARD_CAPTURE) != 0 ? CAPTURE_FULL_BOARD : CAPTURE_REGIONS;
+
+    // The filled cells are counted off the restored board, the rest of the stats can't be
+    GameStats &stats = game.stats;
+    stats.cellCount = header.rows * header.cols;
+    stats.filledCells = countFilledCells(game.board);
+    stats.startFilled = header.startFilled;
+    stats.trailLength = header.trailCount;
+    stats.longestTrail = header.longestTrail;
+    stats.captures = header.captures;
+    stats.capturedCells = header.capturedCells;
+    stats.nearMisses = header.nearMisses;
+    stats.trailThreatened = (header.flags & FLAG_TRAIL_THREATENED) != 0;
+    return true;
+}
+
+bool writeSaveState(const SaveState &state, const char *path)
+{
+    if (!state.data)
+        return false;
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write((const char *)state.data, state.size);
+    return bool(file);
+}
+
+/**
+ * The pending events have to be a heap of known events, one freeze ending
+ * for each freeze running, and every recurring event ahead of the clock,
+ * so the first tick can't spend forever catching one up.
+ */
+static bool validSavedEvents(const ScheduledEvent *events, const SaveStateHeader &header)
+{
+    int freezeEnds = 0;
+    for (int i = 0; i < header.eventCount; i++) {
+        const ScheduledEvent &event = events[i];
+        if (event.type < 0 || event.type >= EVENT_TYPE_COUNT || !std::isfinite(event.time) ||
+            !std::isfinite(event.interval) || event.interval < 0 || event.order >= header.nextEventOrder)
+            return false;
+        if (event.interval > 0 && (event.time <= header.elapsedTime || event.time + event.interval == event.time))
+            return false;
+        if (i > 0) {
+            const ScheduledEvent &parent = events[(i - 1) / 2];
+            if (event.time < parent.time || (event.time == parent.time && event.order < parent.order))
+                return false;
+        }
+        if (event.type == EVENT_FREEZE_END)
+            freezeEnds++;
+    }
+    return freezeEnds == header.freezeEffects;
+}
+
+/**
+ * Everything in a snapshot has to be in range before a game runs from it:
+ * enemy groups in order, known motions, enemies on the board, the player
+ * and the trail on the board, and region labels below the next label the
+ * tracker hands out.
+ */
+static bool validSaveStateArrays(const unsigned char *base, const SaveStateHeader &header)
+{
+    SaveStateLayout layout = layoutFor(header.rows, header.cols, header.enemyCount, header.trailCount,
+                                       header.eventCount);
+    const int cellCount = header.rows * header.cols;
+
+    if (header.groupStart[0] != 0 || header.groupStart[numOfMotionGroups] != header.enemyCount)
+        return false;
+    for (int g = 0; g < numOfMotionGroups; g++)
+        if (header.groupStart[g] > header.groupStart[g + 1])
+            return false;
+
+    const int *motion = (const int *)(base + layout.motion);
+    for (int i = 0; i < header.enemyCount; i++)
+        if (motion[i] < MOTION_LINEAR || motion[i] > MOTION_HUNTER)
+            return false;
+
+    // Enemy positions pick the board cells they are tested against
+    const float *enemyX = (const float *)(base + layout.enemyFloats[0]);
+    const float *enemyY = (const float *)(base + layout.enemyFloats[1]);
+    const float width = float(header.cols * ts), height = float(header.rows * ts);
+    for (int i = 0; i < header.enemyCount; i++)
+        if (!std::isfinite(enemyX[i]) || !std::isfinite(enemyY[i]) || enemyX[i] < 0 || enemyX[i] >= width ||
+            enemyY[i] < 0 || enemyY[i] >= height)
+            return false;
+
+    if (header.playerX < 0 || header.playerX >= header.cols || header.playerY < 0 || header.playerY >= header.rows ||
+        header.difficultyLevel < 1 || header.difficultyLevel > 3 || header.nextLabel < 1)
+        return false;
+
+    const int *trailCells = (const int *)(base + layout.trailCells);
+    for (int i = 0; i < header.trailCount; i++)
+        if (trailCells[i] < 0 || trailCells[i] >= cellCount)
+            return false;
+
+    const int *labels = (const int *)(base + layout.labels);
+    for (int i = 0; i < cellCount; i++)
+        if (labels[i] < 0 || labels[i] >= header.nextLabel)
+            return false;
+    return validSavedEvents((const ScheduledEvent *)(base + layout.events), header);
+}
+
+/**
+ * Maps a snapshot saved by writeSaveState() so restoreSaveState() reads
+ * it straight from the mapping. Returns false, with the state left empty,
+ * if the file is missing or not a valid snapshot.
+ */
+bool openSaveState(SaveState &state, const char *path)
+{
+    closeSaveState(state);
+    if (!mapFile(path, state.data, state.size, state.mapped))
+        return false;
+
+    SaveStateHeader header;
+    if (!readHeader(state.data, state.size, header) || !validSaveStateArrays(state.data, header)) {
+        closeSaveState(state);
+        return false;
+    }
+    return true;
+}
+
+// Unmaps any file the state has open, a captured buffer is kept for the next capture
+void closeSaveState(SaveState &state)
+{
+    if (state.data != state.buffer)
+        unmapFile(state.data, state.size, state.mapped);
+    state.data = 0;
+    state.size = 0;
+    state.mapped = false;
+}
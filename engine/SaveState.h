@@ -0,0 +1,53 @@
+#ifndef XONIX_SAVE_STATE_H
+#define XONIX_SAVE_STATE_H
+
+#include "Game.h"
+#include <cstddef>
+
+const int saveStateVersion = 5;    // 2 added the hunters' motion group, 3 the game stats, 4 the pending events, 5 made them 16 bytes
+const int saveStateAlignment = 64;    // Every array starts on a 64 byte boundary
+const int saveStateHeaderSize = 128;
+
+/**
+ * The whole state of a game mid-session in one flat block: the board
+ * planes, the enemies with their pattern timers, the region labels and
+ * trail, the pending timed events and the random generator. Arrays are
+ * stored as they are in memory, so capturing and restoring a game is a
+ * handful of memcpy()s, and a saved file can be mapped and restored from
+ * without reading it first.
+ *
+ * Layout: a 128 byte header ("XSAV", u16 version, u8 difficulty, u8 flags,
+ * u32 byte order mark, u16 rows, u16 cols, u32 enemy count, i32 player x,
+ * y, move x, y and move counter, f32 player timer and elapsed time, u32
+ * event count, f32 speed multiplier, u32 random state, i32 next label,
+ * u32 trail length, u32 total size, i32 enemy group starts, i32 captures,
+ * captured cells, near misses, longest trail and filled cells at the
+ * start, u32 next event order, i32 freezes running), then each aligned to
+ * 64 bytes: filled and trail planes (u64 words), the eight float arrays of
+ * the enemies, their motion, the region labels, the trail cells and the
+ * event heap as ScheduledEvent structs. The hunters' distance field is
+ * worked out again from the trail when there are hunters. Files are only
+ * read back on a machine with the same byte order.
+ */
+struct SaveState
+{
+    const unsigned char *data;    // The snapshot, in buffer or in a mapped file
+    size_t size;
+    unsigned char *buffer;        // Where captureSaveState() writes, kept between captures
+    size_t capacity;
+    bool mapped;                  // data is a file opened by openSaveState()
+
+    SaveState();
+    ~SaveState();
+
+    SaveState(const SaveState &) = delete;
+    SaveState &operator=(const SaveState &) = delete;
+};
+
+void captureSaveState(SaveState &state, const Game &game);
+bool restoreSaveState(Game &game, const SaveState &state);
+bool writeSaveState(const SaveState &state, const char *path);
+bool openSaveState(SaveState &state, const char *path);
+void closeSaveState(SaveState &state);
+
+#endif
@@ -0,0 +1,371 @@
+#include "Scoreboard.h"
+#include "ByteOrder.h"
+#include "MappedFile.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define XONIX_HAS_FSYNC
+#endif
+
+static const char scoreboardMagic[4] = {'X', 'S', 'C', 'B'};
+const int scoreboardHeaderSize = 16;
+const int scoreRecordSize = 32;
+
+// FNV-1a, enough to tell a torn or scribbled record from a real one
+static unsigned int checksumOf(const unsigned char *data, int length)
+{
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static void encodeRecord(unsigned char *out, const ScoreRecord &record)
+{
+    unsigned char *body = out + 4;
+    unsigned char *p = body;
+    unsigned int elapsedBits;
+    memcpy(&elapsedBits, &record.elapsedTime, sizeof(elapsedBits));
+    putBytes(p, (unsigned int)record.score, 4);
+    putBytes(p, (unsigned int)record.moves, 4);
+    putBytes(p, elapsedBits, 4);
+    putBytes(p, (unsigned int)record.difficultyLevel, 1);
+    putBytes(p, 0, 3);
+    putBytes(p, record.seed, 4);
+    putBytes(p, (unsigned long long)record.timestamp, 8);
+
+    unsigned char *checksum = out;
+    putBytes(checksum, checksumOf(body, scoreRecordSize - 4), 4);
+}
+
+// Returns false if the record is damaged
+static bool decodeRecord(const unsigned char *in, ScoreRecord &record)
+{
+    const unsigned char *body = in + 4;
+    if ((unsigned int)getBytes(in, 4) != checksumOf(body, scoreRecordSize - 4))
+        return false;
+
+    record.score = int(getBytes(in, 4));
+    record.moves = int(getBytes(in, 4));
+    unsigned int elapsedBits = (unsigned int)getBytes(in, 4);
+    memcpy(&record.elapsedTime, &elapsedBits, sizeof(elapsedBits));
+    record.difficultyLevel = int(getBytes(in, 1));
+    in += 3;
+    record.seed = (unsigned int)getBytes(in, 4);
+    record.timestamp = (long long)getBytes(in, 8);
+    return record.difficultyLevel >= 1 && record.difficultyLevel <= numOfDifficulties;
+}
+
+/**
+ * More cells captured is better, then the faster game, then the one that
+ * was played first so an equal score doesn't push an older one out.
+ */
+bool isBetterScore(const ScoreRecord &a, const ScoreRecord &b)
+{
+    if (a.score != b.score)
+        return a.score > b.score;
+    if (a.elapsedTime != b.elapsedTime)
+        return a.elapsedTime < b.elapsedTime;
+    return a.timestamp < b.timestamp;
+}
+
+// The heap keeps the worst score at index 0
+static void siftUp(ScoreRecord *heap, int index)
+{
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (!isBetterScore(heap[parent], heap[index]))
+            return;
+        ScoreRecord swap = heap[parent];
+        heap[parent] = heap[index];
+        heap[index] = swap;
+        index = parent;
+    }
+}
+
+static void siftDown(ScoreRecord *heap, int count, int index)
+{
+    for (;;)
+    {
+        int worst = index;
+        int left = index * 2 + 1, right = left + 1;
+        if (left < count && isBetterScore(heap[worst], heap[left]))
+            worst = left;
+        if (right < count && isBetterScore(heap[worst], heap[right]))
+            worst = right;
+        if (worst == index)
+            return;
+        ScoreRecord swap = heap[worst];
+        heap[worst] = heap[index];
+        heap[index] = swap;
+        index = worst;
+    }
+}
+
+// Returns whether the record made it into the best scores of its difficulty
+static bool insertTopScore(Scoreboard &board, const ScoreRecord &record)
+{
+    ScoreRecord *heap = board.top[record.difficultyLevel - 1];
+    int &count = board.topCount[record.difficultyLevel - 1];
+    if (count < topScoreCount) {
+        heap[count] = record;
+        siftUp(heap, count++);
+        return true;
+    }
+    if (!isBetterScore(record, heap[0]))
+        return false;
+    heap[0] = record;
+    siftDown(heap, count, 0);
+    return true;
+}
+
+Scoreboard::Scoreboard()
+{
+    path[0] = '\0';
+    memset(topCount, 0, sizeof(topCount));
+    recordCount = 0;
+    corruptRecords = 0;
+    movedBadFile = false;
+    loadMilliseconds = 0;
+    pendingStart = pendingCount = 0;
+    writing = 0;
+    stopping = false;
+    writeFailed = false;
+    fileSize = 0;
+    file = 0;
+}
+
+Scoreboard::~Scoreboard()
+{
+    closeScoreboard(*this);
+}
+
+// Writes whatever is queued, a batch at a time, until the scoreboard closes
+static void writerMain(Scoreboard *board)
+{
+    unsigned char batch[maxPendingScores * scoreRecordSize];
+    std::unique_lock<std::mutex> guard(board->lock);
+    for (;;)
+    {
+        board->wake.wait(guard, [board]() { return board->stopping || board->pendingCount > 0; });
+        if (board->pendingCount == 0)
+            return;    // Stopping with nothing left to write
+
+        int count = board->pendingCount;
+        for (int i = 0; i < count; i++)
+            encodeRecord(batch + i * scoreRecordSize, board->pending[(board->pendingStart + i) % maxPendingScores]);
+        board->pendingStart = (board->pendingStart + count) % maxPendingScores;
+        board->pendingCount = 0;
+        board->writing = count;
+
+        // The disk is only touched with the lock released, so addScore() never waits on it.
+        // After a failure the batches are dropped, appending past a partial record would misalign the rest
+        bool failedBefore = board->writeFailed;
+        guard.unlock();
+        bool ok = false;
+        if (!failedBefore) {
+            ok = fwrite(batch, scoreRecordSize, count, board->file) == size_t(count) && fflush(board->file) == 0;
+#ifdef XONIX_HAS_FSYNC
+            ok = ok && fsync(fileno(board->file)) == 0;
+#endif
+        }
+        guard.lock();
+
+        if (ok)
+            board->fileSize += (long long)count * scoreRecordSize;
+        else
+            board->writeFailed = true;
+        board->writing = 0;
+        board->written.notify_all();
+    }
+}
+
+// Reads every record in the file into the best scores, returns the size up to the last whole record
+static size_t loadRecords(Scoreboard &board, const unsigned char *data, size_t size)
+{
+    size_t recordsEnd = scoreboardHeaderSize + (size - scoreboardHeaderSize) / scoreRecordSize * scoreRecordSize;
+    for (size_t offset = scoreboardHeaderSize; offset < recordsEnd; offset += scoreRecordSize)
+    {
+        ScoreRecord record;
+        if (!decodeRecord(data + offset, record)) {
+            board.corruptRecords++;
+            continue;
+        }
+        insertTopScore(board, record);
+        board.recordCount++;
+    }
+    return recordsEnd;
+}
+
+/**
+ * Loads the scores in path, creating the file if there isn't one, and
+ * starts the writer thread. A file that isn't a scoreboard is moved aside
+ * first. Returns false if the file can't be opened for appending.
+ */
+bool openScoreboard(Scoreboard &board, const char *path)
+{
+    closeScoreboard(board);
+    auto startTime = std::chrono::steady_clock::now();
+    if (strlen(path) > size_t(maxScoreboardPath))
+        return false;
+    strcpy(board.path, path);
+    memset(board.topCount, 0, sizeof(board.topCount));
+    board.recordCount = 0;
+    board.corruptRecords = 0;
+    board.movedBadFile = false;
+
+    // An empty file is left by a crash before the header was written, it is started again
+    std::error_code error;
+    bool exists = std::filesystem::file_size(path, error) > 0 && !error;
+
+    // Mapping the file keeps a load of millions of records to one pass over memory
+    const unsigned char *data = 0;
+    size_t size = 0;
+    bool mapped = false;
+    size_t keepSize = 0;
+    if (exists)
+    {
+        if (!mapFile(path, data, size, mapped))
+            return false;
+        const unsigned char *in = data + 4;
+        bool valid = size >= size_t(scoreboardHeaderSize) && memcmp(data, scoreboardMagic, 4) == 0 &&
+                     getBytes(in, 2) == scoreboardVersion && getBytes(in, 2) == scoreRecordSize;
+        if (valid)
+            keepSize = loadRecords(board, data, size);
+        unmapFile(data, size, mapped);
+
+        // A header torn by a crash or a file of something else would keep failing, it is kept for a look and replaced
+        if (!valid) {
+            char badPath[maxScoreboardPath + 5];
+            snprintf(badPath, sizeof(badPath), "%s.bad", path);
+            std::filesystem::rename(path, badPath, error);
+            if (error)
+                return false;
+            exists = false;
+            board.movedBadFile = true;
+        }
+    }
+
+    // A record torn by a crash would shift every record after it, so it goes before appending
+    if (exists && keepSize != size) {
+        std::filesystem::resize_file(path, keepSize, error);
+        if (error)
+            return false;
+    }
+
+    board.file = fopen(path, exists ? "ab" : "wb");
+    if (!board.file)
+        return false;
+    if (!exists)
+    {
+        unsigned char header[scoreboardHeaderSize] = {0};
+        unsigned char *out = header;
+        memcpy(out, scoreboardMagic, 4);
+        out += 4;
+        putBytes(out, scoreboardVersion, 2);
+        putBytes(out, scoreRecordSize, 2);
+        bool ok = fwrite(header, sizeof(header), 1, board.file) == 1 && fflush(board.file) == 0;
+#ifdef XONIX_HAS_FSYNC
+        ok = ok && fsync(fileno(board.file)) == 0;
+#endif
+        if (!ok) {
+            fclose(board.file);
+            board.file = 0;
+            return false;
+        }
+    }
+
+    board.pendingStart = board.pendingCount = 0;
+    board.writing = 0;
+    board.stopping = false;
+    board.writeFailed = false;
+    board.fileSize = exists ? (long long)keepSize : scoreboardHeaderSize;
+    board.writer = std::thread(writerMain, &board);
+    board.loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+// Writes out every queued score and stops the writer thread, cutting off what a failed write left behind
+void closeScoreboard(Scoreboard &board)
+{
+    if (!board.file)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(board.lock);
+        board.stopping = true;
+    }
+    board.wake.notify_one();
+    board.writer.join();
+    fclose(board.file);
+    board.file = 0;
+
+    // Whatever stdio still held of the failed batch has gone out with fclose(), so the file is only cut now
+    if (board.writeFailed) {
+        std::error_code error;
+        std::filesystem::resize_file(board.path, (uintmax_t)board.fileSize, error);
+    }
+}
+
+/**
+ * Records a finished game. The record goes into the best scores straight
+ * away and is queued for the writer thread; this only waits if
+ * maxPendingScores games are already waiting to be written. Returns its
+ * place among the best scores of its difficulty (0 is the best), or -1 if
+ * it didn't make them.
+ */
+int addScore(Scoreboard &board, const ScoreRecord &record)
+{
+    if (!board.file || record.difficultyLevel < 1 || record.difficultyLevel > numOfDifficulties)
+        return -1;
+
+    {
+        std::unique_lock<std::mutex> guard(board.lock);
+        board.written.wait(guard, [&board]() { return board.pendingCount < maxPendingScores; });
+        board.pending[(board.pendingStart + board.pendingCount) % maxPendingScores] = record;
+        board.pendingCount++;
+    }
+    board.wake.notify_one();
+    board.recordCount++;
+
+    if (!insertTopScore(board, record))
+        return -1;
+    int place = 0;
+    const ScoreRecord *heap = board.top[record.difficultyLevel - 1];
+    for (int i = 0; i < board.topCount[record.difficultyLevel - 1]; i++)
+        if (isBetterScore(heap[i], record))
+            place++;
+    return place;
+}
+
+// Waits until every score added so far is on disk
+void flushScoreboard(Scoreboard &board)
+{
+    if (!board.file)
+        return;
+    std::unique_lock<std::mutex> guard(board.lock);
+    board.written.wait(guard, [&board]() { return board.pendingCount == 0 && board.writing == 0; });
+}
+
+// Copies the best scores of a difficulty into out, best first, and returns how many there are
+int topScores(const Scoreboard &board, int difficultyLevel, ScoreRecord *out)
+{
+    if (difficultyLevel < 1 || difficultyLevel > numOfDifficulties)
+        return 0;
+
+    int count = board.topCount[difficultyLevel - 1];
+    const ScoreRecord *heap = board.top[difficultyLevel - 1];
+    for (int i = 0; i < count; i++)
+    {
+        int j = i;
+        for (; j > 0 && isBetterScore(heap[i], out[j - 1]); j--)
+            out[j] = out[j - 1];
+        out[j] = heap[i];
+    }
+    return count;
+}
@@ -0,0 +1,83 @@
+#ifndef XONIX_SCOREBOARD_H
+#define XONIX_SCOREBOARD_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+const int scoreboardVersion = 1;
+const int topScoreCount = 10;          // Scores kept in memory per difficulty
+const int numOfDifficulties = 3;
+const int maxPendingScores = 256;      // Scores waiting for the writer thread
+const int maxScoreboardPath = 255;
+
+// One finished game
+struct ScoreRecord
+{
+    int score;                // Cells captured
+    int moves;
+    float elapsedTime;        // Seconds
+    int difficultyLevel;      // 1 to 3
+    unsigned int seed;
+    long long timestamp;      // Seconds since the epoch when the game ended
+};
+
+/**
+ * Every score ever recorded, as an append-only file of fixed size records,
+ * and the best topScoreCount of each difficulty in memory. The best scores
+ * of a difficulty are a min-heap with the worst of them on top, so a new
+ * score is compared against one record and an insert costs O(log n).
+ *
+ * Writes happen on a thread of their own: addScore() only queues the
+ * record, so ending a game never waits for the disk. Every record carries
+ * a checksum. Loading skips records that fail it, and a record cut short
+ * by a crash is trimmed off before anything more is appended. A file whose
+ * header is torn or isn't a scoreboard at all is renamed to path.bad and
+ * a new one is started, so one bad file can't turn scores off for good.
+ * Once a write fails nothing more is appended that session, and closing
+ * cuts the file back to its last whole record, so a partial batch never
+ * shifts the records after it.
+ *
+ * File layout, little-endian: "XSCB", u16 version, u16 record size,
+ * u32 unused, u32 unused, then 32 bytes per record (u32 checksum of the
+ * other 28 bytes, i32 score, i32 moves, f32 elapsed time, u8 difficulty,
+ * 3 bytes unused, u32 seed, i64 timestamp).
+ */
+struct Scoreboard
+{
+    char path[maxScoreboardPath + 1];
+    ScoreRecord top[numOfDifficulties][topScoreCount];
+    int topCount[numOfDifficulties];
+    long long recordCount;       // Valid records in the file, loaded and added
+    long long corruptRecords;    // Records skipped on load because their checksum didn't match
+    bool movedBadFile;           // The file at path wasn't a scoreboard and was renamed to path.bad
+    double loadMilliseconds;
+
+    // The writer thread and the records it hasn't written yet
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable wake, written;
+    ScoreRecord pending[maxPendingScores];
+    int pendingStart, pendingCount;
+    int writing;                 // Records the writer has taken off the queue but not yet written
+    bool stopping;
+    bool writeFailed;            // Nothing more is written this session
+    long long fileSize;          // Bytes of the header and whole records written, the file is cut back to it after a failure
+    FILE *file;
+
+    Scoreboard();
+    ~Scoreboard();
+
+    Scoreboard(const Scoreboard &) = delete;
+    Scoreboard &operator=(const Scoreboard &) = delete;
+};
+
+bool openScoreboard(Scoreboard &board, const char *path);
+void closeScoreboard(Scoreboard &board);
+int addScore(Scoreboard &board, const ScoreRecord &record);
+void flushScoreboard(Scoreboard &board);
+int topScores(const Scoreboard &board, int difficultyLevel, ScoreRecord *out);
+bool isBetterScore(const ScoreRecord &a, const ScoreRecord &b);
+
+#endif
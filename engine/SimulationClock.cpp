@@ -0,0 +1,27 @@
+#include "SimulationClock.h"
+
+void resetSimulationClock(SimulationClock &clock, float tickRate, int maxTicksPerFrame)
+{
+    clock.tickRate = tickRate;
+    clock.tickSeconds = 1.0f / tickRate;
+    clock.accumulator = 0.0f;
+    clock.maxTicksPerFrame = maxTicksPerFrame;
+}
+
+/**
+ * Adds a frame's worth of real time and returns how many ticks should be
+ * simulated now. Time beyond maxTicksPerFrame ticks is dropped.
+ */
+int advanceSimulationClock(SimulationClock &clock, float frameSeconds)
+{
+    clock.accumulator += frameSeconds;
+
+    int ticks = int(clock.accumulator / clock.tickSeconds);
+    if (ticks > clock.maxTicksPerFrame) {
+        ticks = clock.maxTicksPerFrame;
+        clock.accumulator = ticks * clock.tickSeconds;
+    }
+
+    clock.accumulator -= ticks * clock.tickSeconds;
+    return ticks;
+}
@@ -0,0 +1,23 @@
+#ifndef XONIX_SIMULATION_CLOCK_H
+#define XONIX_SIMULATION_CLOCK_H
+
+const float defaultTickRate = 60.0f;
+const int defaultMaxTicksPerFrame = 8;    // After a long stall the game slows down instead of freezing to catch up
+
+/**
+ * Turns variable frame times into a whole number of fixed simulation ticks,
+ * so gameplay runs at the same speed whatever the frame rate. The time left
+ * over after the last tick is carried into the next frame.
+ */
+struct SimulationClock
+{
+    float tickRate;
+    float tickSeconds;
+    float accumulator;      // Real time not simulated yet
+    int maxTicksPerFrame;
+};
+
+void resetSimulationClock(SimulationClock &clock, float tickRate, int maxTicksPerFrame = defaultMaxTicksPerFrame);
+int advanceSimulationClock(SimulationClock &clock, float frameSeconds);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef XONIX_SWEEP_H
+#define XONIX_SWEEP_H
+
+#include "Board.h"
+
+// What a moving enemy ran into on its way from one point to another
+struct SweepHit
+{
+    bool hit;             // A filled cell (or the edge of the board) blocks the path
+    int cellY, cellX;     // The blocking cell
+    float t;              // How far along the path it was reached, from 0 to 1
+    bool crossedTrail;    // The path went through trail before any blocking cell
+};
+
+SweepHit sweepPath(const Board &board, float x0, float y0, float x1, float y1);
+
+#endif
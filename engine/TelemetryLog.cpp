@@ -0,0 +1,154 @@
+#include "TelemetryLog.h"
+#include <cstring>
+
+TelemetryLog::TelemetryLog()
+{
+    file = 0;
+    pending = writing = 0;
+    pendingLength = 0;
+    blocking = false;
+    stopping = false;
+    writeFailed = false;
+    linesLogged = linesDropped = 0;
+}
+
+TelemetryLog::~TelemetryLog()
+{
+    closeTelemetryLog(*this);
+}
+
+// Writes whatever has been logged, a buffer at a time, until the log closes
+static void writerMain(TelemetryLog *log)
+{
+    std::unique_lock<std::mutex> guard(log->lock);
+    for (;;)
+    {
+        log->wake.wait(guard, [log]() { return log->stopping || log->pendingLength > 0; });
+        if (log->pendingLength == 0)
+            return;    // Stopping with nothing left to write
+
+        char *lines = log->pending;
+        int length = log->pendingLength;
+        log->pending = log->writing;
+        log->pendingLength = 0;
+        log->writing = lines;
+        log->space.notify_all();
+
+        // The disk is only touched with the lock released, so logTelemetry() never waits on it
+        guard.unlock();
+        bool ok = fwrite(lines, 1, length, log->file) == size_t(length) && fflush(log->file) == 0;
+        guard.lock();
+        if (!ok)
+            log->writeFailed = true;
+    }
+}
+
+/**
+ * Opens path for appending, so the lines of every session end up in one
+ * file, and starts the writer thread. A blocking log never drops a line.
+ */
+bool openTelemetryLog(TelemetryLog &log, const char *path, bool blocking)
+{
+    closeTelemetryLog(log);
+    log.file = fopen(path, "ab");
+    if (!log.file)
+        return false;
+
+    log.pending = new char[telemetryBufferSize];
+    log.writing = new char[telemetryBufferSize];
+    log.pendingLength = 0;
+    log.blocking = blocking;
+    log.stopping = false;
+    log.writeFailed = false;
+    log.linesLogged = log.linesDropped = 0;
+    log.writer = std::thread(writerMain, &log);
+    return true;
+}
+
+// Writes out every line logged so far and stops the writer thread
+void closeTelemetryLog(TelemetryLog &log)
+{
+    if (!log.file)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(log.lock);
+        log.stopping = true;
+    }
+    log.wake.notify_one();
+    log.writer.join();
+    fclose(log.file);
+    log.file = 0;
+    delete[] log.pending;
+    delete[] log.writing;
+    log.pending = log.writing = 0;
+}
+
+/**
+ * Queues one line, which has to end in a newline. Returns false if it was
+ * dropped, which a blocking log only does for a line bigger than its buffer.
+ */
+bool logTelemetry(TelemetryLog &log, const char *line, int length)
+{
+    if (!log.file)
+        return false;
+
+    {
+        std::unique_lock<std::mutex> guard(log.lock);
+        if (log.blocking && length <= telemetryBufferSize)
+            log.space.wait(guard, [&log, length]() { return log.pendingLength + length <= telemetryBufferSize; });
+        if (log.pendingLength + length > telemetryBufferSize) {
+            log.linesDropped++;
+            return false;
+        }
+        memcpy(log.pending + log.pendingLength, line, length);
+        log.pendingLength += length;
+        log.linesLogged++;
+    }
+    log.wake.notify_one();
+    return true;
+}
+
+// One JSON line of the game's stats, returns its length like snprintf()
+int formatGameEvent(char *text, int size, const char *event, long long session, int gameNumber, const Game &game)
+{
+    const GameStats &stats = game.stats;
+    return snprintf(text, size,
+                    "{\"session\":%lld,\"game\":%d,\"event\":\"%s\",\"time\":%.3f,\"difficulty\":%d,"
+                    "\"rows\":%d,\"cols\":%d,\"enemies\":%d,\"capturedPercent\":%.2f,\"filledCells\":%d,"
+                    "\"trailLength\":%d,\"longestTrail\":%d,\"captures\":%d,\"capturedCells\":%d,"
+                    "\"capturesPerMinute\":%.2f,\"nearMisses\":%d,\"moves\":%d,\"speed\":%.2f}\n",
+                    session, gameNumber, event, game.elapsedTime, game.difficultyLevel,
+                    game.board.rows, game.board.cols, game.enemies.count, capturedPercent(stats), stats.filledCells,
+                    stats.trailLength, stats.longestTrail, stats.captures, stats.capturedCells,
+                    capturesPerMinute(stats, game.elapsedTime), stats.nearMisses, game.moveCounter,
+                    game.speedMultiplier);
+}
+
+void logGameEvent(TelemetryLog &log, const char *event, long long session, int gameNumber, const Game &game)
+{
+    if (!log.file)
+        return;
+    char line[maxTelemetryLine];
+    int length = formatGameEvent(line, sizeof(line), event, session, gameNumber, game);
+    if (length > 0 && length < int(sizeof(line)))
+        logTelemetry(log, line, length);
+}
+
+/**
+ * Logs what one tick of updateGame() did: a capture, the game ending, and a
+ * sample once the game clock passes nextSampleTime, which is moved on.
+ */
+void logTickEvents(TelemetryLog &log, long long session, int gameNumber, const Game &game,
+                   const TickResult &result, float &nextSampleTime)
+{
+    if (result.captured)
+        logGameEvent(log, "capture", session, gameNumber, game);
+    if (game.elapsedTime >= nextSampleTime) {
+        logGameEvent(log, "sample", session, gameNumber, game);
+        while (nextSampleTime <= game.elapsedTime)
+            nextSampleTime += telemetrySampleInterval;
+    }
+    if (result.gameOver)
+        logGameEvent(log, "end", session, gameNumber, game);
+}
@@ -0,0 +1,56 @@
+#ifndef XONIX_TELEMETRY_LOG_H
+#define XONIX_TELEMETRY_LOG_H
+
+#include "Game.h"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+const int telemetryBufferSize = 64 * 1024;    // Bytes of lines waiting for the writer thread
+const int maxTelemetryLine = 512;
+const float telemetrySampleInterval = 1.0f;    // Seconds of game time between "sample" lines
+
+/**
+ * Game stats streamed to a file as JSON lines, one object per event:
+ * a game starting, a capture, a sample every telemetrySampleInterval of
+ * game time and the game ending. Lines are written on a thread of their
+ * own. Logging one only copies it into a buffer, under a lock the writer
+ * holds just long enough to swap buffers, so a tick never waits on the
+ * disk. If the writer falls so far behind that the buffer fills up, new
+ * lines are dropped and counted rather than waited for. A blocking log,
+ * for headless runs where every line matters more than the tick rate,
+ * waits for the writer to make room instead.
+ */
+struct TelemetryLog
+{
+    FILE *file;
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable space;    // Signalled when the writer has taken the pending lines
+    bool blocking;            // Wait for room rather than drop lines
+    char *pending;            // Lines waiting for the writer
+    int pendingLength;
+    char *writing;            // The writer's buffer, swapped with pending
+    bool stopping;
+    bool writeFailed;
+    long long linesLogged;
+    long long linesDropped;
+
+    TelemetryLog();
+    ~TelemetryLog();
+
+    TelemetryLog(const TelemetryLog &) = delete;
+    TelemetryLog &operator=(const TelemetryLog &) = delete;
+};
+
+bool openTelemetryLog(TelemetryLog &log, const char *path, bool blocking = false);
+void closeTelemetryLog(TelemetryLog &log);
+bool logTelemetry(TelemetryLog &log, const char *line, int length);
+int formatGameEvent(char *text, int size, const char *event, long long session, int gameNumber, const Game &game);
+void logGameEvent(TelemetryLog &log, const char *event, long long session, int gameNumber, const Game &game);
+void logTickEvents(TelemetryLog &log, long long session, int gameNumber, const Game &game,
+                   const TickResult &result, float &nextSampleTime);
+
+#endif
@@ -0,0 +1,128 @@
+#include "TrailDistance.h"
+#include <climits>
+#include <cstring>
+
+TrailDistanceField::TrailDistanceField()
+{
+    cellCount = 0;
+    stamp = 0;
+    distance = 0;
+    heading = 0;
+    queue = 0;
+    generation = 1;
+}
+
+TrailDistanceField::~TrailDistanceField()
+{
+    delete[] stamp;
+    delete[] distance;
+    delete[] heading;
+    delete[] queue;
+}
+
+static void allocateField(TrailDistanceField &field, int cellCount)
+{
+    if (field.cellCount == cellCount)
+        return;
+    delete[] field.stamp;
+    delete[] field.distance;
+    delete[] field.heading;
+    delete[] field.queue;
+    field.stamp = new int[cellCount];
+    field.distance = new unsigned char[cellCount];
+    field.heading = new unsigned char[cellCount];
+    field.queue = new int[cellCount];
+    field.cellCount = cellCount;
+}
+
+// Sizes the field for the board with nothing in it
+void resetTrailDistances(TrailDistanceField &field, const Board &board)
+{
+    allocateField(field, board.rows * board.cols);
+    memset(field.stamp, 0, sizeof(int) * field.cellCount);
+    field.generation = 1;
+}
+
+// Forgets every distance, called when the trail is committed or lost
+void clearTrailDistances(TrailDistanceField &field)
+{
+    field.generation++;
+    if (field.generation == INT_MAX) {
+        memset(field.stamp, 0, sizeof(int) * field.cellCount);
+        field.generation = 1;
+    }
+}
+
+/**
+ * Spreads out from the cells already in the queue, [0, count), to every
+ * open cell within maxHuntDistance that they bring closer to the trail.
+ * Filled cells are walls, so the distances follow the way an enemy has to
+ * go. A cell is only queued when its distance drops, so nothing the new
+ * trail cells don't improve is visited.
+ */
+static void spreadDistances(TrailDistanceField &field, const Board &board, int count)
+{
+    const int cols = board.cols;
+    const int generation = field.generation;
+    int *queue = field.queue;
+
+    for (int head = 0; head < count; head++)
+    {
+        int cell = queue[head];
+        int next = field.distance[cell] + 1;
+        if (next > maxHuntDistance)
+            continue;
+
+        int x = cell % cols;
+        int neighbours[4] = {x > 0 ? cell - 1 : -1, x < cols - 1 ? cell + 1 : -1,
+                             cell >= cols ? cell - cols : -1, cell + cols < field.cellCount ? cell + cols : -1};
+        // Stepping back from each neighbour leads to this cell
+        const unsigned char backTo[4] = {HEADING_RIGHT, HEADING_LEFT, HEADING_DOWN, HEADING_UP};
+
+        for (int n = 0; n < 4; n++)
+        {
+            int neighbour = neighbours[n];
+            if (neighbour < 0 || (board.filled[neighbour / bitsPerWord] & Board::bitOf(neighbour)) != 0)
+                continue;
+            if (field.stamp[neighbour] == generation && field.distance[neighbour] <= next)
+                continue;
+
+            field.stamp[neighbour] = generation;
+            field.distance[neighbour] = (unsigned char)next;
+            field.heading[neighbour] = backTo[n];
+            queue[count++] = neighbour;
+        }
+    }
+}
+
+// Called for every cell the player turns into trail, after it was set on the board
+void addTrailSource(TrailDistanceField &field, const Board &board, int index)
+{
+    field.stamp[index] = field.generation;
+    field.distance[index] = 0;
+    field.heading[index] = HEADING_NONE;
+    field.queue[0] = index;
+    spreadDistances(field, board, 1);
+}
+
+/**
+ * Works the field out again from the whole trail, after a game was restored
+ * without it. The cells are added one at a time in the order they were
+ * laid, so where two ways to the trail are as short the hunters keep the one
+ * they had before the game was saved.
+ */
+void rebuildTrailDistances(TrailDistanceField &field, const Board &board, const int *trailCells, int trailCount)
+{
+    resetTrailDistances(field, board);
+    for (int i = 0; i < trailCount; i++)
+        addTrailSource(field, board, trailCells[i]);
+}
+
+void copyTrailDistances(TrailDistanceField &to, const TrailDistanceField &from)
+{
+    allocateField(to, from.cellCount);
+    memcpy(to.stamp, from.stamp, sizeof(int) * from.cellCount);
+    memcpy(to.distance, from.distance, from.cellCount);
+    memcpy(to.heading, from.heading, from.cellCount);
+    to.generation = from.generation;
+}
@@ -0,0 +1,47 @@
+#ifndef XONIX_TRAIL_DISTANCE_H
+#define XONIX_TRAIL_DISTANCE_H
+
+#include "Board.h"
+
+const int maxHuntDistance = 16;    // Cells further than this from the trail aren't tracked
+
+// Which way to step from a cell to get closer to the trail
+enum TrailHeading { HEADING_NONE, HEADING_LEFT, HEADING_RIGHT, HEADING_UP, HEADING_DOWN };
+
+/**
+ * How far every cell is from the nearest cell of the trail the player is
+ * building, walking through cells that aren't filled, and which neighbour
+ * is one step closer. Each trail cell the player lays only spreads out as
+ * far as the cells it brings closer, and clearing the field when a capture
+ * commits just moves to the next generation: a cell only counts if its
+ * stamp is the current generation.
+ */
+struct TrailDistanceField
+{
+    int cellCount;
+    int *stamp;                   // Generation the cell was last reached in
+    unsigned char *distance;      // Steps to the trail, valid when stamp matches
+    unsigned char *heading;       // TrailHeading towards the trail
+    int *queue;                   // Scratch for spreading a new trail cell
+    int generation;
+
+    TrailDistanceField();
+    ~TrailDistanceField();
+
+    TrailDistanceField(const TrailDistanceField &) = delete;
+    TrailDistanceField &operator=(const TrailDistanceField &) = delete;
+};
+
+void resetTrailDistances(TrailDistanceField &field, const Board &board);
+void clearTrailDistances(TrailDistanceField &field);
+void addTrailSource(TrailDistanceField &field, const Board &board, int index);
+void rebuildTrailDistances(TrailDistanceField &field, const Board &board, const int *trailCells, int trailCount);
+void copyTrailDistances(TrailDistanceField &to, const TrailDistanceField &from);
+
+// The way to the trail from a cell, HEADING_NONE on the trail or out of range
+inline int trailHeadingAt(const TrailDistanceField &field, int index)
+{
+    return field.stamp[index] == field.generation ? int(field.heading[index]) : int(HEADING_NONE);
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include "VecEnv.h"
+#include <cstring>
+
+// Environments per chunk of work, enough to make a pool hand-off worth it on small boards
+const int envsPerChunk = 4;
+
+VecEnv::VecEnv()
+{
+    games = 0;
+    episodes = episodeSteps = 0;
+    done = 0;
+    actions = 0;
+    observations = 0;
+    layout = ObservationLayout();
+}
+
+VecEnv::~VecEnv()
+{
+    delete[] games;
+    delete[] episodes;
+    delete[] episodeSteps;
+    delete[] done;
+}
+
+static int alignUp(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Eight cells of a bitplane byte spread to one byte per cell, so a whole
+ * grid row can be written eight cells at a time. Bit k goes to byte k.
+ */
+struct CellByteTable
+{
+    uint64_t spread[256];
+
+    CellByteTable()
+    {
+        for (int bits = 0; bits < 256; bits++) {
+            spread[bits] = 0;
+            for (int k = 0; k < 8; k++)
+                if (bits & (1 << k))
+                    spread[bits] |= uint64_t(1) << (8 * k);
+        }
+    }
+};
+
+static const CellByteTable cellBytes;
+
+// One byte per cell from the filled and trail planes, filled wins like Board::get()
+static void writeGrid(const Board &board, unsigned char *grid)
+{
+    int cellCount = board.rows * board.cols;
+    const unsigned char *filled = (const unsigned char *)board.filled;
+    const unsigned char *trail = (const unsigned char *)board.trail;
+
+    int byte = 0;
+    for (; (byte + 1) * 8 <= cellCount; byte++)
+    {
+        uint64_t cells = cellBytes.spread[filled[byte]] * CELL_FILLED |
+                         cellBytes.spread[trail[byte] & ~filled[byte]] * CELL_TRAIL;
+        memcpy(grid + byte * 8, &cells, sizeof(cells));
+    }
+    for (int index = byte * 8; index < cellCount; index++)
+    {
+        int y = index / board.cols;
+        int cell = board.get(y, index - y * board.cols);
+        grid[index] = (unsigned char)(cell == CELL_FILLED || cell == CELL_TRAIL ? cell : CELL_EMPTY);
+    }
+}
+
+static void writeObservation(VecEnv &env, int i, int reward)
+{
+    const Game &game = env.games[i];
+    unsigned char *observation = env.observations + (size_t)i * env.layout.size;
+
+    int32_t header[observationHeaderInts];
+    header[OBS_PLAYER_X] = game.playerX;
+    header[OBS_PLAYER_Y] = game.playerY;
+    header[OBS_REWARD] = reward;
+    header[OBS_DONE] = env.done[i] ? 1 : 0;
+    header[OBS_EPISODE_STEP] = env.episodeSteps[i];
+    header[OBS_ENEMY_COUNT] = game.enemies.count;
+    memcpy(observation, header, sizeof(header));
+
+    float *enemies = (float *)(observation + env.layout.enemiesOffset);
+    for (int e = 0; e < game.enemies.count; e++) {
+        enemies[2 * e] = game.enemies.x[e];
+        enemies[2 * e + 1] = game.enemies.y[e];
+    }
+
+    int gridEnd = env.layout.gridOffset + game.board.rows * game.board.cols;
+    writeGrid(game.board, observation + env.layout.gridOffset);
+    memset(observation + gridEnd, 0, env.layout.size - gridEnd);    // Alignment padding, so the buffer never holds stale bytes
+}
+
+static void startEpisode(VecEnv &env, int i)
+{
+    const VecEnvConfig &config = env.config;
+    unsigned int seed = config.seed + unsigned(i) + unsigned(env.episodes[i]) * unsigned(config.envCount);
+    startGame(env.games[i], config.difficultyLevel, seed, config.rows, config.cols, config.enemyCount);
+    env.episodes[i]++;
+    env.episodeSteps[i] = 0;
+    env.done[i] = false;
+}
+
+/**
+ * Sets up config.envCount games and the worker pool. Returns false if the
+ * config can't be played (see isValidBoardSize()).
+ */
+bool createVecEnv(VecEnv &env, const VecEnvConfig &config)
+{
+    if (config.envCount <= 0 || config.ticksPerStep <= 0 || !(config.tickRate > 0) || config.enemyCount < 0 ||
+        !isValidBoardSize(config.rows, config.cols))
+        return false;
+
+    delete[] env.games;
+    delete[] env.episodes;
+    delete[] env.episodeSteps;
+    delete[] env.done;
+
+    env.config = config;
+    env.games = new Game[config.envCount];
+    env.episodes = new int[config.envCount];
+    env.episodeSteps = new int[config.envCount];
+    env.done = new bool[config.envCount];
+    for (int i = 0; i < config.envCount; i++) {
+        env.episodes[i] = 0;
+        startEpisode(env, i);
+    }
+
+    int enemyCount = env.games[0].enemies.count;
+    env.layout.enemyCount = enemyCount;
+    env.layout.enemiesOffset = int(sizeof(int32_t)) * observationHeaderInts;
+    env.layout.gridOffset = env.layout.enemiesOffset + int(sizeof(float)) * 2 * enemyCount;
+    env.layout.size = alignUp(env.layout.gridOffset + config.rows * config.cols, observationAlignment);
+
+    startWorkerPool(env.pool, config.threads);
+    return true;
+}
+
+static void resetRange(void *context, int first, int end)
+{
+    VecEnv &env = *(VecEnv *)context;
+    for (int i = first; i < end; i++) {
+        startEpisode(env, i);
+        writeObservation(env, i, 0);
+    }
+}
+
+// Starts a new episode in every environment and writes the first observations (layout.size bytes each)
+void resetVecEnv(VecEnv &env, unsigned char *observations)
+{
+    env.observations = observations;
+    runParallel(env.pool, env.config.envCount, envsPerChunk, resetRange, &env);
+}
+
+static void stepRange(void *context, int first, int end)
+{
+    VecEnv &env = *(VecEnv *)context;
+    float dt = 1.0f / env.config.tickRate;
+
+    for (int i = first; i < end; i++)
+    {
+        if (env.done[i]) {
+            startEpisode(env, i);
+            writeObservation(env, i, 0);
+            continue;
+        }
+
+        int action = env.actions[i];
+        Direction input = action >= DIR_NONE && action <= DIR_DOWN ? Direction(action) : DIR_NONE;
+        int reward = 0;
+        for (int t = 0; t < env.config.ticksPerStep; t++)
+        {
+            TickResult result = updateGame(env.games[i], dt, input);
+            reward += result.capturedCells;
+            if (result.gameOver) {
+                env.done[i] = true;
+                break;
+            }
+        }
+        env.episodeSteps[i]++;
+        writeObservation(env, i, reward);
+    }
+}
+
+/**
+ * Steps every environment with its action (a Direction value per
+ * environment) and writes the observations after the step
+ */
+void stepVecEnv(VecEnv &env, const int *actions, unsigned char *observations)
+{
+    env.actions = actions;
+    env.observations = observations;
+    runParallel(env.pool, env.config.envCount, envsPerChunk, stepRange, &env);
+}
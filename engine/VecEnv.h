@@ -0,0 +1,82 @@
+#ifndef XONIX_VEC_ENV_H
+#define XONIX_VEC_ENV_H
+
+#include "Game.h"
+#include "SimulationClock.h"
+#include "WorkerPool.h"
+#include <cstdint>
+
+const int defaultTicksPerStep = 5;    // One player step at 60 ticks per second
+const int observationAlignment = 64;  // Each environment's observation starts on its own cache line
+
+struct VecEnvConfig
+{
+    int envCount = 16;
+    int difficultyLevel = 1;
+    int rows = defaultRows;
+    int cols = defaultCols;
+    int enemyCount = 0;                     // 0 uses the difficulty's enemy count
+    float tickRate = defaultTickRate;
+    int ticksPerStep = defaultTicksPerStep; // Game ticks run with the same action per step
+    unsigned int seed = 1;                  // Episode e of environment i uses seed + i + e * envCount
+    int threads = 0;                        // 0 picks one thread per core
+};
+
+// The int32 values at the start of every observation
+enum ObservationField {
+    OBS_PLAYER_X,
+    OBS_PLAYER_Y,
+    OBS_REWARD,           // Cells captured during the last step
+    OBS_DONE,             // 1 when the game ended during the last step
+    OBS_EPISODE_STEP,     // Steps since the episode started
+    OBS_ENEMY_COUNT,
+    observationHeaderInts
+};
+
+/**
+ * Where things are in one environment's observation, all offsets in bytes.
+ * Environment i's observation starts at i * size in the caller's buffer:
+ *   int32 header[observationHeaderInts]
+ *   float enemies[enemyCount][2]     x and y in pixels
+ *   uint8 grid[rows * cols]          CELL_EMPTY, CELL_FILLED or CELL_TRAIL, row by row
+ */
+struct ObservationLayout
+{
+    int size;
+    int enemyCount;
+    int enemiesOffset;
+    int gridOffset;
+};
+
+/**
+ * envCount independent games stepped together. Steps run on a worker pool
+ * and write straight into one buffer the caller owns, with no copy of the
+ * game state in between. A game that ends reports OBS_DONE and starts its
+ * next episode on the following step (that step's action is ignored).
+ */
+struct VecEnv
+{
+    VecEnvConfig config;
+    ObservationLayout layout;
+    Game *games;
+    int *episodes;          // Episodes started per environment, for the seeds
+    int *episodeSteps;
+    bool *done;
+    WorkerPool pool;
+
+    // The step in flight, read by the workers
+    const int *actions;
+    unsigned char *observations;
+
+    VecEnv();
+    ~VecEnv();
+
+    VecEnv(const VecEnv &) = delete;
+    VecEnv &operator=(const VecEnv &) = delete;
+};
+
+bool createVecEnv(VecEnv &env, const VecEnvConfig &config);
+void resetVecEnv(VecEnv &env, unsigned char *observations);
+void stepVecEnv(VecEnv &env, const int *actions, unsigned char *observations);
+
+#endif
@@ -0,0 +1,121 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool()
+{
+    threadCount = 1;
+    threads = 0;
+    task = 0;
+    context = 0;
+    itemCount = chunkSize = 0;
+    nextItem = 0;
+    generation = 0;
+    busyWorkers = 0;
+    stopping = false;
+}
+
+WorkerPool::~WorkerPool()
+{
+    stopWorkerPool(*this);
+}
+
+// Takes chunks of the current loop until none are left
+static void workOnLoop(WorkerPool &pool)
+{
+    for (;;)
+    {
+        int first = pool.nextItem.fetch_add(pool.chunkSize);
+        if (first >= pool.itemCount)
+            return;
+        int end = first + pool.chunkSize < pool.itemCount ? first + pool.chunkSize : pool.itemCount;
+        pool.task(pool.context, first, end);
+    }
+}
+
+static void workerMain(WorkerPool *pool)
+{
+    int seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(pool->lock);
+            pool->wake.wait(guard, [pool, seenGeneration]() { return pool->stopping || pool->generation != seenGeneration; });
+            if (pool->stopping)
+                return;
+            seenGeneration = pool->generation;
+        }
+
+        workOnLoop(*pool);
+
+        std::lock_guard<std::mutex> guard(pool->lock);
+        if (--pool->busyWorkers == 0)
+            pool->finished.notify_one();
+    }
+}
+
+/**
+ * Starts threadCount - 1 worker threads (0 picks one thread per core),
+ * stopping any the pool already had
+ */
+void startWorkerPool(WorkerPool &pool, int threadCount)
+{
+    stopWorkerPool(pool);
+
+    if (threadCount <= 0)
+        threadCount = int(std::thread::hardware_concurrency());
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    pool.threadCount = threadCount;
+    pool.stopping = false;
+    pool.generation = 0;
+    pool.threads = new std::thread[threadCount - 1];
+    for (int t = 0; t < threadCount - 1; t++)
+        pool.threads[t] = std::thread(workerMain, &pool);
+}
+
+void stopWorkerPool(WorkerPool &pool)
+{
+    if (pool.threads == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        pool.stopping = true;
+    }
+    pool.wake.notify_all();
+    for (int t = 0; t < pool.threadCount - 1; t++)
+        pool.threads[t].join();
+
+    delete[] pool.threads;
+    pool.threads = 0;
+    pool.threadCount = 1;
+}
+
+/**
+ * Calls task on chunks of chunkSize items until all itemCount are done,
+ * spread over the pool, and returns once every chunk has finished
+ */
+void runParallel(WorkerPool &pool, int itemCount, int chunkSize, ParallelTask task, void *context)
+{
+    if (pool.threadCount <= 1 || itemCount <= chunkSize) {
+        task(context, 0, itemCount);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        pool.task = task;
+        pool.context = context;
+        pool.itemCount = itemCount;
+        pool.chunkSize = chunkSize;
+        pool.nextItem = 0;
+        pool.busyWorkers = pool.threadCount - 1;
+        pool.generation++;
+    }
+    pool.wake.notify_all();
+
+    workOnLoop(pool);
+
+    std::unique_lock<std::mutex> guard(pool.lock);
+    pool.finished.wait(guard, [&pool]() { return pool.busyWorkers == 0; });
+}
@@ -0,0 +1,44 @@
+#ifndef XONIX_WORKER_POOL_H
+#define XONIX_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Work handed to the pool, called with ranges [first, end) of the items
+typedef void (*ParallelTask)(void *context, int first, int end);
+
+/**
+ * A fixed set of threads that split a loop between them. The thread that
+ * calls runParallel() works on the loop too, so a pool of one thread just
+ * runs it inline.
+ */
+struct WorkerPool
+{
+    int threadCount;          // Including the calling thread
+    std::thread *threads;     // threadCount - 1 workers
+    std::mutex lock;
+    std::condition_variable wake, finished;
+
+    // The loop in flight
+    ParallelTask task;
+    void *context;
+    int itemCount, chunkSize;
+    std::atomic<int> nextItem;
+    int generation;           // Bumped for every loop so sleeping workers know there is new work
+    int busyWorkers;
+    bool stopping;
+
+    WorkerPool();
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+};
+
+void startWorkerPool(WorkerPool &pool, int threadCount);
+void stopWorkerPool(WorkerPool &pool);
+void runParallel(WorkerPool &pool, int itemCount, int chunkSize, ParallelTask task, void *context);
+
+#endif
@@ -1,410 +1,754 @@
 #include <SFML/Graphics.hpp>
 #include <time.h>
 #include <iostream>
-#include <string>
+#include <cstdio>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "engine/BigMap.h"
+#include "engine/FrameHandoff.h"
+#include "engine/FrameProfiler.h"
+#include "engine/Game.h"
+#include "engine/NetMatch.h"
+#include "engine/Replay.h"
+#include "engine/SaveState.h"
+#include "engine/Scoreboard.h"
+#include "engine/SimulationClock.h"
+#include "engine/TelemetryLog.h"
+#include "render/Assets.h"
+#include "render/Hud.h"
+#include "render/TileRenderer.h"
 using namespace sf;
 using namespace std;
 
-const int M = 25;
-const int N = 40;
-const int ts = 18; // tile size
-
-// Grid representation
-int grid[M][N] = {0};
-
-// Game states
+// Game states, only the window thread changes them
 enum GameState { MENU, DIFFICULTY_SELECT, PLAYING, GAME_OVER };
 GameState gameState = MENU;
 
-struct MotionPattern {
-    // This is a function pointer that calculates offsets of x and y based on when the time since the last pattern switch
-    void (*calculateMotion)(float time, float speedInitial, float &dx, float &dy);
-    const char *patternName; // Name of current pattern for display or to debug
-};
-
-// Enemy related function prototypes
-void zigzagMotion(float time, float speedInitial, float &dx, float &dy);
-void circularMotion(float time, float speedInitial, float &dx, float &dy);
-
-// This array stores the types of enemy motion patterns
-const MotionPattern patterns[] = {{zigzagMotion, "Zig-zag"}, {circularMotion, "Circular"}};
-
-const int numOfPatterns = sizeof(patterns) / sizeof(patterns[0]);   // Determine number of different patterns for later use
-
-struct Enemy
+// Things the menus ask of the simulation thread, run before its next batch of ticks
+enum SimCommandType { SIM_START_GAME, SIM_LEAVE_GAME, SIM_SAVE_STATE, SIM_LOAD_STATE };
+struct SimCommand
 {
-    float x, y, dx, dy;       // Int was changed to float to enable smoother movement during speed adjustments
-    float speedInitial;
-    int patternType;              // Decides which pattern to use
-    float timeOfPattern;    // Tracks how long it has been since the last patetrn change
-    bool patternActive;   // A flag that determines whether the enemy should switch to a pattern
-    const MotionPattern* pattern;    // This is a pointer that points to the pattern function
-
-    Enemy()
-    {
-        x = y = 300;
-        dx = 4 - rand() % 8;
-        dy = 4 - rand() % 8;
-        
-        // We need to store the initial speed's magnitude
-        speedInitial = sqrt(dx * dx + dy * dy);
-        
-        // We adjust the speed of the enemy if they are 'stationary'
-        if (dx == 0 && dy == 0) {
-          dx = 1;
-          speedInitial = 1;
-        }
-        
-        // Variables controlling the pattern of enemy movement need to be initialised here
-        patternActive = false;
-        patternType = rand() % numOfPatterns;    // This initialises the active pattern to a random one
-        timeOfPattern = 0.0f;
-        pattern = &patterns[patternType];
-    }
-
-    void move(float speedMultiplier)
-    {
-        float currentdx, currentdy;
-        
-        if(patternActive) {
-        // Apply movement of pattern
-          timeOfPattern += 0.016f;    // This approximates to 60 fps (?)
-          pattern->calculateMotion(timeOfPattern, speedInitial, currentdx, currentdy);
-        
-          // The current speed multiplier has to be applied to enemy movement
-          currentdx *= speedMultiplier;
-          currentdy *= speedMultiplier;
-        }
-        else {
-          // If the flag isnt active, use regular linear movement
-          currentdx = speedMultiplier * dx;
-          currentdy = speedMultiplier * dy;
-        }
-        
-        // Apply change on the x-axis and check for collisions
-        x += currentdx;
-        if (grid[int(y / ts)][int(x / ts)] == 1) {
-          currentdx = -currentdx;
-          dx = -dx;
-          x += currentdx;
-          
-          if(patternActive) {   // If a pattern is in use, bounce off the walls without changing pattern
-            timeOfPattern+= 0.25f;    // Small step in pattern time to avoid getting stuck
-          }
-        }
-        
-        y += currentdy;
-        if (grid[int(y / ts)][int(x / ts)] == 1) {
-          currentdy = -currentdy;
-          dy = -dy;
-          y += currentdy;
-          
-          if(patternActive) {   // If a pattern is in use, bounce off the walls without changing pattern
-            timeOfPattern += 0.25f;    // Small step in pattern time to avoid getting stuck
-          }
-        }
-    }
+    SimCommandType type;
+    int difficulty;
+    int number;    // Game number the started or loaded game gets
 };
 
 // Function prototypes
-void drop(int y, int x);
-void initializeGrid();
-string formatTime(float timeInSeconds);
-void resetElapsedTimer();
-void updateElapsedTimer();
-void switchEnemyPattern(Enemy enemies[], int enemyCount, float presentTime);
+void formatTime(char *buffer, int size, float timeInSeconds);
+int formatProfileRow(char *text, int size, FrameProfiler &profiler, int phase);
+void updateHudText(const FrameSnapshot &frame);
+void updateProfileText(FrameProfiler &profiler, const FrameSnapshot &frame);
+void updateTickProfileText();
+void formatNetText(char *text, int size, NetClient &client, float seconds);
+void startNewGame(int difficulty);
+void logTelemetryEvent(const char *event);
+void saveRecording();
+void recordScore();
+void requestNewGame();
+void sendSimCommand(SimCommandType type, int difficulty = 0, int number = 0);
+bool runSimCommands();
+void runTicks(int ticks, Direction input);
+void publishSimulationFrame();
+void simulationMain();
+bool parseCommandLine(int argc, char **argv);
 
 // Global variables
 int difficultyLevel = 1; // Default to easy
-int enemyCount = 2; // Default to easy (2 enemies)
-float elapsedTime = 0.0f;     // Default starting time is set to 0
-Clock gameClock;    // A clock object is made to track elapsed game time
-bool timerActive = false;  // We need a flag that indicates whether the timer is running or not
-// Speed increase variables
-const float speedFactor = 0.5f;    // Enemy speed will increase every 20s by a factor of 0.5
-const float speedIncreaseInterval = 20.0f;
-float timeSinceLastIncrease = 0.0f;
-float speedMultiplier = 1.0f;
-const float maxSpeedMultiplier = 4.0f;
-// Variables for enemy pattern switching
-const float patternSwitchInterval = 30.0f;    // The threshold time interval to switch the pattern
-bool switchedPattern = false;    // This flag tracks whether the enemy's movement pattern has changed
-
-// Global text declarations
-Text timerText;
-Text speedText;
-
-/**
- * Recursive flood fill algorithm to mark cells
- */
-void drop(int y, int x)
-{
-    if (grid[y][x] == 0)
-        grid[y][x] = -1;
-    if (grid[y - 1][x] == 0)
-        drop(y - 1, x);
-    if (grid[y + 1][x] == 0)
-        drop(y + 1, x);
-    if (grid[y][x - 1] == 0)
-        drop(y, x - 1);
-    if (grid[y][x + 1] == 0)
-        drop(y, x + 1);
-}
+int boardRows = defaultRows;    // Board size can be changed with --rows and --cols
+int boardCols = defaultCols;
+float tickRate = defaultTickRate;    // Simulation ticks per second (--tick-rate), independent of the frame rate
+int frameRateLimit = 60;    // --fps, 0 draws as fast as possible
+int stressEnemies = 0;    // --enemies, replaces the difficulty's enemy count when set
+int hunterEnemies = 0;    // --hunters, how many of the enemies chase the player's trail
+const char *profileCsvPath = 0;    // --profile-csv, where the frame timings go on exit (the game phases to FILE.ticks.csv)
+FrameProfiler profiler;    // Times every phase of the last few hundred frames
+atomic<bool> showProfile(false);    // F3 toggles the timings overlay
+const char *recordPath = 0;    // --record, every game played is saved here as a replay (the last one wins)
+const char *replayPath = 0;    // --replay, plays a recorded game instead of reading the keyboard
+const char *assetsPath = defaultAssetBundlePath;    // --assets, the bundle built by xonix_pack
+const char *saveStatePath = "xonix.xsav";    // --save-state, F5 saves the game there and F9 loads it back
+const char *scoresPath = "scores.xsb";    // --scores, every finished game is added to it
+const char *connectHost = 0;    // --connect, joins a match on xonix_server instead of playing alone
+int connectPort = defaultNetPort;    // --port
+const char *telemetryPath = 0;    // --telemetry, the stats of every game are appended there as JSON lines
+const char *bigMapPath = 0;    // --big-map, plays on a map made by xonix_mapgen with the view following the player
+const int bigMapViewRows = 30;    // Tiles of a big map the window shows at once
+const int bigMapViewCols = 48;
+bool playingOnline = false;
 
-/**
- * Initialize the game grid with borders
- */
-void initializeGrid()
-{
-    // Clear grid
-    for (int i = 0; i < M; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            grid[i][j] = 0;
-            // Set borders
-            if (i == 0 || j == 0 || i == M - 1 || j == N - 1)
-                grid[i][j] = 1;
-        }
-    }
-}
+// The game runs on a thread of its own so a slow capture doesn't hold up drawing and a stalled
+// display() doesn't hold up the game. Once that thread has started, everything from here to
+// tickProfileText belongs to it, the window only sees the frames it publishes
+Replay replay;    // The game being recorded, or the one being played back
+ReplayCursor replayCursor;
+bool playingReplay = false;
+bool recordingGame = false;    // A game resumed from a save state can't be replayed from its seed, so it isn't recorded
+SaveState saveState;
+Scoreboard scoreboard;
+bool scoresOpen = false;
+bool showScores = false;    // The best scores are listed on the game over screen of a game that was scored
+NetClient netClient;    // The online match, its predicted game is the one shown
+BigMap bigMap;    // Open with --big-map, the game is played on the sector of it around the player
+TelemetryLog telemetry;    // Open with --telemetry, replays and online matches aren't logged
+long long telemetrySession = 0;    // When the game was launched, so sessions can be told apart in the file
+float nextSampleTime = 0;
+Game game;    // All of the game rules and state live in the engine
+bool simRunning = false;    // Ticks only run while a game is being played
+int gameNumber = 0;    // Game being simulated, see FrameSnapshot::gameNumber
+FrameProfiler tickProfiler;    // Times the game phases of every batch of ticks
+char scoresText[maxFrameTextLength + 1];    // Best scores after the last game over
+char tickProfileText[maxFrameTextLength + 1];    // Rows of the timings overlay for the game phases
+
+// Shared by the two threads
+FrameHandoff frames;    // The newest frame the simulation published, handed over without a lock
+atomic<bool> stopSimulation(false);
+atomic<int> heldInput(DIR_NONE);    // Arrow key held down, the simulation reads it every tick
+
+const int maxSimCommands = 16;
+mutex commandLock;    // Only held to queue or take commands, never while a tick runs
+SimCommand simCommands[maxSimCommands];
+int simCommandCount = 0;
+int requestedGame = 0;    // Last game number the window handed out
+int awaitedGame = 0;    // Frames of games before this one are stale, the window has moved on
+
+// Colour and spin of enemies on each pattern, in MotionPatterns order (zig-zag, circular, spiral, Lissajous)
+const Color patternColors[] = {Color::Magenta, Color::Cyan, Color::Yellow, Color::Green, Color::Red};    // The last is the hunters'
+const float patternSpin[] = {10, 15, 20, 25, 40};
+static_assert(sizeof(patternColors) / sizeof(patternColors[0]) == MOTION_HUNTER + 1, "every pattern needs a colour");
+static_assert(maxFrameTextLength <= maxHudFieldLength, "frame text has to fit a HUD field");
+Random seedSource;    // Hands out a fresh seed for every game started from the menu
+
+// HUD text, formatted into fixed buffers and drawn in one batch
+Hud hud;
+int movesField, timerField, speedField, mapField, profileField, netField, scoresField;
 
 // Functions controlling elapsed time and display
-string formatTime(float timeInSeconds) {
+void formatTime(char *buffer, int size, float timeInSeconds) {
   int mins = int(timeInSeconds) / 60;
   int seconds = int (timeInSeconds) % 60;
   int millisecs = int((timeInSeconds - int(timeInSeconds)) * 10);
   
   // Formatting time elapsed in MM:SS.millisecs form
-  string formattedTime = (mins < 10 ? "0" : "") +to_string(mins) + ":" + (seconds < 10 ? "0" : "") + 
-                        to_string(seconds) + "." + to_string(millisecs);
-                          
-  return formattedTime;
+  snprintf(buffer, size, "%02d:%02d.%d", mins, seconds, millisecs);
 }
 
-void resetElapsedTimer() {
-  elapsedTime = 0.0f;
-  gameClock.restart();    // The restart() method resets the game clock to zero and keeps it running
-  timerActive = true;
-  
-  // Reset speed adjustment variables as well
-  timeSinceLastIncrease = 0.0f;
-  speedMultiplier = 1.0f;
-  
-  // Reset the flag that tracks pattern change of enemies
-  switchedPattern = false;
+// Called every frame, the HUD only lays a field out again when its text comes out different
+void updateHudText(const FrameSnapshot &frame) {
+  char text[32];
+  snprintf(text, sizeof(text), "Moves = %d", frame.moveCounter);
+  setHudField(hud, movesField, text);
+
+  // This displays the updated elapsed time on the display
+  char time[16];
+  formatTime(time, sizeof(time), frame.elapsedTime);
+  snprintf(text, sizeof(text), "Time: %s", time);
+  setHudField(hud, timerField, text);
   
+  // Shows the current multiplier that controls enemy speed, cut to 4 characters like "1.25" or "10.5"
+  char speed[5];
+  snprintf(speed, sizeof(speed), "%.2f", int(frame.speedMultiplier * 100) / 100.0);
+  snprintf(text, sizeof(text), "Speed: x%s", speed);
+  setHudField(hud, speedField, text);
+
+  // Where the player is on a big map, in cells from its top left corner
+  if (bigMapPath) {
+    snprintf(text, sizeof(text), "Map: %d, %d", frame.mapCol + frame.playerX, frame.mapRow + frame.playerY);
+    setHudField(hud, mapField, text);
+  }
 }
 
-void updateElapsedTimer() {
-  if (timerActive) {
-    // This updates the elapsed timer since the last frame
-    float timeFromLastFrame = gameClock.restart().asSeconds();
-    
-    elapsedTime += timeFromLastFrame;
-    
-    // Also update the time since the last increase of speed
-    timeSinceLastIncrease += timeFromLastFrame;
-    
-    // If the time since last speed increase reaches 20, then we have to update enemy speed
-    if (timeSinceLastIncrease >= speedIncreaseInterval) {
-      timeSinceLastIncrease -= speedIncreaseInterval; // This resets the speed timer
-      speedMultiplier += speedFactor;   // This increases the multiplier by which enemy speed increases
+// p50 and p99 of one phase over the frames the profiler still holds
+int formatProfileRow(char *text, int size, FrameProfiler &profiler, int phase) {
+  return snprintf(text, size, "%-11s%.2f   %.2f\n", phaseNames[phase],
+                  phasePercentile(profiler, phase, 50), phasePercentile(profiler, phase, 99));
+}
+
+// Lists every phase, the game phases as the simulation thread last formatted them, then the frame handoff
+void updateProfileText(FrameProfiler &profiler, const FrameSnapshot &frame) {
+  char text[maxHudFieldLength + 1];
+  int length = snprintf(text, sizeof(text), "phase      p50ms  p99ms\n");
+  for (int p = 0; p <= PHASE_COUNT && length < int(sizeof(text)); p++) {
+    if (p == PHASE_TIMERS)
+      length += snprintf(text + length, sizeof(text) - length, "%s", frame.tickProfileText);
+    else if (p < PHASE_TIMERS || p > PHASE_COLLISIONS)
+      length += formatProfileRow(text + length, sizeof(text) - length, profiler, p);
+  }
+  if (length < int(sizeof(text)))
+    snprintf(text + length, sizeof(text) - length, "dropped %lld, repeated %lld", frames.dropped.load(), frames.repeated);
+  setHudField(hud, profileField, text);
+}
+
+// The rows of the game phases, timed per batch of ticks on the simulation thread
+void updateTickProfileText() {
+  int length = 0;
+  for (int p = PHASE_TIMERS; p <= PHASE_COLLISIONS && length < int(sizeof(tickProfileText)); p++)
+    length += formatProfileRow(tickProfileText + length, sizeof(tickProfileText) - length, tickProfiler, p);
+}
+
+// Round trip of the newest input, bandwidth both ways and everyone's score in an online match
+void formatNetText(char *text, int size, NetClient &client, float seconds) {
+  float ping = client.latencyCount > 0 ? client.networkMs[(client.latencyCount - 1) % maxLatencySamples] : 0;
+  float kilobytes = seconds > 0 ? seconds * 1024 : 1;
+  int length = snprintf(text, size, "Ping %.1f ms, down %.1f KB/s, up %.1f KB/s\nScore", ping,
+                        client.connection.bytesReceived / kilobytes, client.connection.bytesSent / kilobytes);
+  for (int p = 0; p < client.config.playerCount && length < size; p++)
+    length += snprintf(text + length, size - length, p == client.playerIndex ? " [%d]" : " %d",
+                       client.state == NET_FINISHED ? client.scores[p] : client.remotes[p].score);
+}
+
+// Starts a game with a fresh seed and begins recording its input
+void startNewGame(int difficulty) {
+  saveRecording();    // A game left through the menu is kept too
+  playingReplay = false;
+  recordingGame = true;
+  showScores = false;
+
+  unsigned int seed = seedSource.next();
+
+  // A big map keeps what was captured on it instead of a replay, the last game's sector is written back first
+  if (bigMap.data) {
+    if (bigMap.sectorLoaded)
+      storeSector(game, bigMap);
+    recordingGame = false;
+    startBigMapGame(game, bigMap, difficulty, seed, stressEnemies, hunterEnemies);
+    return;
+  }
+  startGame(game, difficulty, seed, boardRows, boardCols, stressEnemies, hunterEnemies);
+  beginReplay(replay, seed, difficulty, boardRows, boardCols, game.enemies.count, tickRate, hunterCount(game.enemies));
+}
+
+// Logs the game's stats as they are now, for a game played here
+void logTelemetryEvent(const char *event) {
+  if (playingReplay || playingOnline)
+    return;
+  logGameEvent(telemetry, event, telemetrySession, gameNumber, game);
+  nextSampleTime = game.elapsedTime + telemetrySampleInterval;
+}
+
+// Writes the game recorded so far to the --record file, if there is one and anything was played
+void saveRecording() {
+  if (!recordPath || !recordingGame || replay.tickCount == 0)
+    return;
+  if (!saveReplay(replay, recordPath))
+    cout << "Error: Unable to write the replay to " << recordPath << endl;
+}
+
+// Adds the game that just ended to the scoreboard and lists the best scores of its difficulty
+void recordScore() {
+  if (!scoresOpen || playingReplay || bigMap.data)    // Scores on a big map can't be compared with a board's
+    return;
+
+  ScoreRecord record;
+  record.score = capturedCellCount(game.board);
+  record.moves = game.moveCounter;
+  record.elapsedTime = game.elapsedTime;
+  record.difficultyLevel = game.difficultyLevel;
+  record.seed = replay.seed;
+  record.timestamp = (long long)time(0);
+  int place = addScore(scoreboard, record);
+
+  ScoreRecord best[topScoreCount];
+  int count = topScores(scoreboard, record.difficultyLevel, best);
+  const char *difficultyNames[] = {"EASY", "MEDIUM", "HARD"};
+  char *text = scoresText;
+  int size = sizeof(scoresText);
+  int length = snprintf(text, size, "BEST SCORES - %s\n", difficultyNames[record.difficultyLevel - 1]);
+  for (int i = 0; i < count && length < size; i++) {
+    char elapsed[16];
+    formatTime(elapsed, sizeof(elapsed), best[i].elapsedTime);
+    length += snprintf(text + length, size - length, "%c%2d. %5d  %s\n", i == place ? '>' : ' ',
+                       i + 1, best[i].score, elapsed);
+  }
+  if (place < 0 && length < size)
+    snprintf(text + length, size - length, " You: %d", record.score);
+  showScores = true;
+}
+
+// Menus: starts a game from the menu settings, the window shows it once its first frame comes
+void requestNewGame() {
+  awaitedGame = ++requestedGame;
+  sendSimCommand(SIM_START_GAME, difficultyLevel, awaitedGame);
+}
+
+// Menus: queues a command for the simulation thread, a full queue drops it like a missed key press
+void sendSimCommand(SimCommandType type, int difficulty, int number) {
+  lock_guard<mutex> guard(commandLock);
+  if (simCommandCount == maxSimCommands)
+    return;
+  SimCommand command = {type, difficulty, number};
+  simCommands[simCommandCount++] = command;
+}
+
+// Simulation: runs what the menus asked for, returns whether there was anything
+bool runSimCommands() {
+  SimCommand commands[maxSimCommands];
+  int count;
+  {
+    lock_guard<mutex> guard(commandLock);
+    count = simCommandCount;
+    memcpy(commands, simCommands, sizeof(SimCommand) * count);
+    simCommandCount = 0;
+  }
+
+  for (int c = 0; c < count; c++) {
+    const SimCommand &command = commands[c];
+    if (command.type == SIM_START_GAME) {
+      if (simRunning)
+        logTelemetryEvent("leave");
+      startNewGame(command.difficulty);
+      gameNumber = command.number;
+      simRunning = true;
+      logTelemetryEvent("start");
     }
-    
-    // Keeping an upper limit so that speed does not increase infinitely (?) - is this necessary
-    if (speedMultiplier > maxSpeedMultiplier) {
-      speedMultiplier = maxSpeedMultiplier;
+    else if (command.type == SIM_LEAVE_GAME) {
+      if (simRunning)
+        logTelemetryEvent("leave");
+      simRunning = false;
+    }
+
+    // F5 suspends the game to the save state file
+    else if (command.type == SIM_SAVE_STATE && simRunning) {
+      ProfileClock::time_point saveStart = ProfileClock::now();
+      captureSaveState(saveState, game);
+      double captureUs = chrono::duration<double, micro>(ProfileClock::now() - saveStart).count();
+      if (writeSaveState(saveState, saveStatePath))
+        cout << "Saved to " << saveStatePath << " (" << saveState.size << " bytes, captured in " << captureUs << " us)" << endl;
+      else
+        cout << "Error: Unable to write the save state to " << saveStatePath << endl;
+    }
+
+    // F9 resumes it from there, a state saved on another board size brings its own size
+    else if (command.type == SIM_LOAD_STATE) {
+      ProfileClock::time_point loadStart = ProfileClock::now();
+      if (openSaveState(saveState, saveStatePath) && restoreSaveState(game, saveState)) {
+        double restoreUs = chrono::duration<double, micro>(ProfileClock::now() - loadStart).count();
+        cout << "Resumed from " << saveStatePath << " in " << restoreUs << " us" << endl;
+        saveRecording();
+        recordingGame = false;
+        playingReplay = false;
+        showScores = false;
+        boardRows = game.board.rows;
+        boardCols = game.board.cols;
+        gameNumber = command.number;
+        simRunning = true;
+        logTelemetryEvent("resume");
+      }
+      else
+        cout << "Error: " << saveStatePath << " is not a valid save state" << endl;
+      closeSaveState(saveState);
     }
-    
-    // This displays the updated elapsed time on the display
-    timerText.setString("Time: " + formatTime(elapsedTime));
-    
-    // Shows the current multiplier that controls enemy speed
-    speedText.setString("Speed: x" + to_string(int(speedMultiplier * 100) / 100.0).substr(0,4));
   }
+  return count > 0;
 }
 
-// Functions that control enemy movement patterns
-void zigzagMotion(float time, float speedInitial, float &dx, float &dy) {
-  int phase = int((time * 2)) % 2;    // Direction is changed every 0.5s (?)
-  
-  // The basis of this zigzag pattern is that the y direction of the enemy sprite alternates
-  // while x direction is kept the same
-  if (phase == 0) {
-    dx = speedInitial;
-    dy = speedInitial * 0.5f;
+// Simulation: runs up to ticks fixed ticks with the arrow key held down now
+void runTicks(int ticks, Direction input) {
+  // Online, every tick is predicted here and sent to the server, which decides what happened
+  if (playingOnline) {
+    if (!pollNetClient(netClient))
+      simRunning = false;
+    ticks = adjustClientTicks(netClient, ticks);
+    for (int tick = 0; tick < ticks && simRunning; tick++)
+      stepNetClient(netClient, input);
+    return;
   }
-  else {
-    dx = speedInitial;
-    dy = -speedInitial * 0.5f;
+
+  for (int tick = 0; tick < ticks && simRunning; tick++)
+  {
+    // A replay supplies its own input, anything else is recorded as it is played
+    Direction tickInput = input;
+    if (playingReplay) {
+      if (replayFinished(replay, replayCursor)) {
+        simRunning = false;
+        break;
+      }
+      tickInput = nextReplayInput(replay, replayCursor);
+    }
+    else if (recordingGame)
+      recordReplayTick(replay, tickInput);
+
+    TickResult result = updateGame(game, 1.0f / tickRate, tickInput, &tickProfiler);
+    if (result.patternSwitched)
+      cout << "Switched" << endl;  // For debugging in console
+    if (bigMap.data)
+      followPlayer(game, bigMap);
+    if (!playingReplay)
+      logTickEvents(telemetry, telemetrySession, gameNumber, game, result, nextSampleTime);
+
+    if (result.gameOver) {
+      simRunning = false;
+      saveRecording();
+      recordScore();
+    }
   }
 }
 
-void circularMotion(float time, float speedInitial, float &dx, float &dy) {
-  // We define arrays that with already calculated values around the circumference of a circle
-  // These values are approximate values of sin/cos values from 8 different points on the circle's circumference (?)
-  const float circumferenceX[8] = {1.0f, 0.7f, 0.0f, -0.7f, -1.0f, -0.7f, 0.0f, 0.7f};
-  const float circumferenceY[8] = {0.0f, 0.7f, 1.0f, 0.7f, 0.0f, -0.7f, -1.0f, -0.7f};
-  
-  // The position around the circle will change at 4 points per second (every 2 seconds)
-  int i = int(time * 4) % 8;
-  
-  // The movement of the enemy is adjusted based on the direction around the circular pattern
-  dx = circumferenceX[i] * speedInitial;
-  dy = circumferenceY[i] * speedInitial;
+// Simulation: copies what the window draws into the back frame and hands it over
+void publishSimulationFrame() {
+  FrameSnapshot &frame = backFrame(frames);
+  captureFrame(frame, playingOnline ? netClient.predicted : game);
+  frame.gameNumber = gameNumber;
+  frame.running = simRunning;
+  frame.tickSeconds = 1.0f / tickRate;
+  frame.mapRow = bigMap.originRow * mapChunkSize;
+  frame.mapCol = bigMap.originCol * mapChunkSize;
+
+  // Online, the first opponent's board goes in a small view in the corner
+  frame.hasOpponent = playingOnline && netClient.config.playerCount > 1;
+  if (frame.hasOpponent) {
+    const RemotePlayer &opponent = netClient.remotes[netClient.playerIndex == 0 ? 1 : 0];
+    copyBoard(frame.opponent, opponent.board);
+    frame.opponentX = opponent.playerX;
+    frame.opponentY = opponent.playerY;
+  }
+  if (playingOnline)
+    formatNetText(frame.netText, sizeof(frame.netText), netClient,
+                  chrono::duration<float>(ProfileClock::now() - netClient.startTime).count());
+
+  frame.showScores = showScores;
+  strcpy(frame.scoresText, scoresText);
+  strcpy(frame.tickProfileText, tickProfileText);
+  frame.publishedAt = ProfileClock::now();
+  publishFrame(frames);
 }
 
-// This function switches the motion pattern of half the enemy sprites
-void switchEnemyPattern(Enemy enemies[], int enemyCount, float presentTime) {
-  // The switch must occur every 30s and if the switch hasnt occurred already
-  if (presentTime >= patternSwitchInterval && !switchedPattern) {
-    // Calculate half the enemy count to switch
-    int halfOfEnemies = enemyCount / 2;
-    
-    // Switch the movement of the calculated half
-    for (int i = 0; i < halfOfEnemies; i++) {
-      enemies[i].patternActive = true;
-      
-      // The pattern assigned to each enemy will alternate
-      enemies[i].patternType = i % numOfPatterns;
-      enemies[i].pattern = &patterns[enemies[i].patternType];
-      
-      // After switching, reset the timer
-      enemies[i].timeOfPattern= 0;
+// Runs the game at tickRate until the window closes, sleeping between ticks
+void simulationMain() {
+  SimulationClock simClock;
+  resetSimulationClock(simClock, tickRate);
+  ProfileClock::time_point lastTime = ProfileClock::now();
+  float profileRefreshTimer = 0;    // The overlay is only worked out a few times a second
+  publishSimulationFrame();
+
+  while (!stopSimulation.load())
+  {
+    bool changed = runSimCommands();
+
+    ProfileClock::time_point now = ProfileClock::now();
+    float elapsed = chrono::duration<float>(now - lastTime).count();
+    lastTime = now;
+    int ticks = advanceSimulationClock(simClock, elapsed);
+
+    // Online, the connection is polled every time round, ticks or not
+    if (simRunning && (ticks > 0 || playingOnline)) {
+      beginProfiledFrame(tickProfiler);
+      runTicks(ticks, Direction(heldInput.load()));
+      endProfiledFrame(tickProfiler);
+      changed = true;
     }
-    
-    switchedPattern = true;
-    
-    cout << "Switched" << endl;  // For debugging in console
+
+    profileRefreshTimer += elapsed;
+    if (showProfile.load() && profileRefreshTimer >= 0.25f) {
+      profileRefreshTimer = 0;
+      updateTickProfileText();
+      changed = true;
+    }
+
+    // A frame is only published when something in it changed, or the ping of a match
+    if (changed || playingOnline)
+      publishSimulationFrame();
+
+    // Until the next tick is due
+    this_thread::sleep_for(chrono::duration<float>(simClock.tickSeconds - simClock.accumulator));
+  }
+}
+
+// Reads the optional --rows R --cols C --tick-rate HZ --fps N --enemies N --hunters N --profile-csv FILE
+// --record FILE --replay FILE --assets FILE --connect HOST --port N --save-state FILE --scores FILE
+// --big-map FILE --telemetry FILE from the command line
+bool parseCommandLine(int argc, char **argv) {
+  if (argc % 2 == 0)
+    return false;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--rows") == 0)
+      boardRows = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--cols") == 0)
+      boardCols = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--tick-rate") == 0)
+      tickRate = float(atof(argv[i + 1]));
+    else if (strcmp(argv[i], "--fps") == 0)
+      frameRateLimit = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--enemies") == 0)
+      stressEnemies = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--hunters") == 0)
+      hunterEnemies = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--profile-csv") == 0)
+      profileCsvPath = argv[i + 1];
+    else if (strcmp(argv[i], "--record") == 0)
+      recordPath = argv[i + 1];
+    else if (strcmp(argv[i], "--replay") == 0)
+      replayPath = argv[i + 1];
+    else if (strcmp(argv[i], "--assets") == 0)
+      assetsPath = argv[i + 1];
+    else if (strcmp(argv[i], "--connect") == 0)
+      connectHost = argv[i + 1];
+    else if (strcmp(argv[i], "--port") == 0)
+      connectPort = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--save-state") == 0)
+      saveStatePath = argv[i + 1];
+    else if (strcmp(argv[i], "--scores") == 0)
+      scoresPath = argv[i + 1];
+    else if (strcmp(argv[i], "--big-map") == 0)
+      bigMapPath = argv[i + 1];
+    else if (strcmp(argv[i], "--telemetry") == 0)
+      telemetryPath = argv[i + 1];
+    else
+      return false;
   }
+  return isValidBoardSize(boardRows, boardCols) && tickRate > 0 && frameRateLimit >= 0 && stressEnemies >= 0
+      && stressEnemies <= maxEnemyCount
+      && hunterEnemies >= 0 && hunterEnemies <= maxReplayHunters
+      && connectPort > 0 && connectPort < 65536 && !(bigMapPath && (replayPath || connectHost));
 }
 
-int main()
+int main(int argc, char **argv)
 {
-    srand(time(0));
+    ProfileClock::time_point launchTime = ProfileClock::now();    // Time to first frame is measured from here
+
+    if (!parseCommandLine(argc, argv)) {
+        cout << "Usage: xonix [--rows " << minBoardRows << "-" << maxBoardRows
+             << "] [--cols " << minBoardCols << "-" << maxBoardCols << "] [--tick-rate HZ] [--fps N] [--enemies N] [--hunters N] [--profile-csv FILE]"
+             << " [--record FILE] [--replay FILE] [--assets FILE] [--connect HOST] [--port N] [--save-state FILE] [--scores FILE] [--big-map FILE] [--telemetry FILE]" << endl;
+        return -1;
+    }
+
+    // A replay brings its own board size and tick rate, the window is sized for it
+    if (replayPath) {
+        if (!loadReplay(replay, replayPath)) {
+            cout << "Error: " << replayPath << " is not a valid replay" << endl;
+            return -1;
+        }
+        boardRows = replay.rows;
+        boardCols = replay.cols;
+        tickRate = replay.tickRate;
+    }
+
+    // An online match is set up by the server, wait for the other players before opening the window
+    if (connectHost) {
+        if (!connectNetClient(netClient, connectHost, connectPort)) {
+            cout << "Error: Unable to connect to " << connectHost << ":" << connectPort << endl;
+            return -1;
+        }
+        cout << "Waiting for the match to start" << endl;
+        while (pollNetClient(netClient) && netClient.state == NET_WAITING)
+            sleep(milliseconds(1));
+        if (netClient.state != NET_PLAYING) {
+            cout << "Error: The server closed the connection before the match started" << endl;
+            return -1;
+        }
+        boardRows = netClient.config.rows;
+        boardCols = netClient.config.cols;
+        tickRate = netClient.config.tickRate;
+        playingOnline = true;
+    }
+
+    // A big map is played a sector at a time, the board is the size of a sector whatever the map's size
+    if (bigMapPath) {
+        if (!openBigMap(bigMap, bigMapPath)) {
+            cout << "Error: " << bigMapPath << " is not a valid big map" << endl;
+            return -1;
+        }
+        cout << "Opened " << bigMapPath << ", " << bigMap.chunkRows * mapChunkSize << "x"
+             << bigMap.chunkCols * mapChunkSize << " cells" << endl;
+        boardRows = boardCols = sectorCells;
+    }
+
+    seedSource.seed(time(0));
+    telemetrySession = (long long)time(0);
+    if (telemetryPath && !openTelemetryLog(telemetry, telemetryPath))
+        cout << "Error: Unable to open " << telemetryPath << ", no telemetry will be written" << endl;
+
+    // Scores are loaded before the window opens, the file can hold every game the cabinet ever played
+    scoresOpen = openScoreboard(scoreboard, scoresPath);
+    if (scoresOpen)
+        cout << "Loaded " << scoreboard.recordCount << " scores in " << scoreboard.loadMilliseconds << " ms"
+             << (scoreboard.corruptRecords > 0 ? " (skipped damaged records)" : "")
+             << (scoreboard.movedBadFile ? " (the old file was damaged, it was renamed to .bad)" : "") << endl;
+    else
+        cout << "Error: Unable to open the scoreboard " << scoresPath << ", scores won't be kept" << endl;
+
+    // Boards bigger than the screen are scaled down to fit, menus and HUD stay at their normal size.
+    // On a big map the window shows part of the sector and the view follows the player instead
+    float boardWidth = boardCols * ts;
+    float boardHeight = boardRows * ts;
+    float viewWidth = bigMapPath ? bigMapViewCols * ts : boardWidth;
+    float viewHeight = bigMapPath ? bigMapViewRows * ts : boardHeight;
+    float windowScale = 1.0f;
+    VideoMode desktop = VideoMode::getDesktopMode();
+    if (viewWidth * windowScale > desktop.width * 0.9f)
+        windowScale = desktop.width * 0.9f / viewWidth;
+    if (viewHeight * windowScale > desktop.height * 0.9f)
+        windowScale = desktop.height * 0.9f / viewHeight;
+    int windowWidth = int(viewWidth * windowScale);
+    int windowHeight = int(viewHeight * windowScale);
 
     // Initialize game window
-    RenderWindow window(VideoMode(N * ts, M * ts), "Xonix Game!");
-    window.setFramerateLimit(60);
+    RenderWindow window(VideoMode(windowWidth, windowHeight), "Xonix Game!");
+    window.setFramerateLimit(frameRateLimit);
+    View boardView(FloatRect(0, 0, viewWidth, viewHeight));
 
-    // Load font
-    Font gameFont;
-    if (!gameFont.loadFromFile("fonts/PressStart2P.ttf")) {
-        cout << "Error: Unable to load font from fonts/PressStart2P.ttf" << endl;
+    // Load the atlas and font, from the bundle if there is one
+    GameAssets assets;
+    if (!loadGameAssets(assets, assetsPath)) {
+        cout << "Error: Unable to load the images and " << gameFontPath << " (or " << assetsPath << ")" << endl;
         return -1;
     }
+    Font &gameFont = assets.font;
+    const IntRect &tilesRect = assets.rects[ATLAS_TILES];
 
-    // Load textures
-    Texture t1, t2, t3;
-    t1.loadFromFile("images/tiles.png");
-    t2.loadFromFile("images/gameover.png");
-    t3.loadFromFile("images/enemy.png");
-
-    // Create sprites
-    Sprite sTile(t1), sGameover(t2), sEnemy(t3);
+    // Create sprites, all of them cut from the atlas
+    Sprite sTile(assets.atlas), sGameover(assets.atlas, assets.rects[ATLAS_GAMEOVER]), sEnemy(assets.atlas, assets.rects[ATLAS_ENEMY]);
     sGameover.setPosition(100, 100);
     sEnemy.setOrigin(20, 20);
 
-    // Initialize enemies
-    Enemy enemies[10];
-    for (int i = 0; i < 10; i++) {
-        enemies[i] = Enemy();
-    }
-
     // Game variables
-    bool gameRunning = false; // Start in menu mode
-    int playerX = 10, playerY = 0;
-    int moveX = 0, moveY = 0;
-    float timer = 0, delay = 0.07;
-    int moveCounter = 0;
     Clock clock;
 
-    // Initialize game grid
-    initializeGrid();
+    // Initialize game so the board can be drawn behind the first game over screen
+    if (replayPath) {
+        startReplayGame(game, replay, replayCursor);
+        playingReplay = true;
+        simRunning = true;
+        gameState = PLAYING;
+    }
+    else if (playingOnline) {
+        simRunning = true;
+        gameState = PLAYING;
+    }
+    else
+        startNewGame(difficultyLevel);
+    gameNumber = requestedGame = awaitedGame = 1;
+
+    // From here on the game belongs to the simulation thread, it publishes the first frame straight away
+    thread simThread(simulationMain);
+    while (!takeLatestFrame(frames))
+        sleep(milliseconds(1));
+    const FrameSnapshot &firstFrame = frontFrame(frames);
+
+    // The board is drawn from vertex arrays that only change where the grid did. The window keeps its
+    // own copy of the board, and loading a frame into it marks the cells that changed
+    Board shownBoard;
+    loadBoardCells(shownBoard, firstFrame.board.rows, firstFrame.board.cols, firstFrame.board.filled, firstFrame.board.trail);
+    TileRenderer boardRenderer;
+    resetTileRenderer(boardRenderer, shownBoard, assets.atlas, Vector2i(tilesRect.left, tilesRect.top));
+
+    // Online, the first opponent's board goes in a small view in the corner
+    bool showOpponent = firstFrame.hasOpponent;
+    Board opponentBoard;
+    TileRenderer opponentRenderer;
+    View opponentView(FloatRect(0, 0, boardWidth, boardHeight));
+    opponentView.setViewport(FloatRect(0.74f, 0.74f, 0.24f, 0.24f));
+    if (showOpponent) {
+        const Board &opponent = firstFrame.opponent;
+        loadBoardCells(opponentBoard, opponent.rows, opponent.cols, opponent.filled, opponent.trail);
+        resetTileRenderer(opponentRenderer, opponentBoard, assets.atlas, Vector2i(tilesRect.left, tilesRect.top));
+    }
 
     // Main menu text elements
     Text titleText("XONIX", gameFont, 40);
     titleText.setFillColor(Color::White);
-    titleText.setPosition(N * ts / 2 - 80, 60);
+    titleText.setPosition(windowWidth / 2 - 80, 60);
 
     Text startGameText("1. START GAME", gameFont, 16);
     startGameText.setFillColor(Color::White);
-    startGameText.setPosition(N * ts / 2 - 90, 170);
+    startGameText.setPosition(windowWidth / 2 - 90, 170);
 
     Text difficultyText("2. SELECT DIFFICULTY", gameFont, 16);
     difficultyText.setFillColor(Color::White);
-    difficultyText.setPosition(N * ts / 2 - 90, 210);
+    difficultyText.setPosition(windowWidth / 2 - 90, 210);
 
     Text exitText("3. EXIT GAME", gameFont, 16);
     exitText.setFillColor(Color::White);
-    exitText.setPosition(N * ts / 2 - 90, 250);
+    exitText.setPosition(windowWidth / 2 - 90, 250);
 
     // Difficulty menu text elements
     Text difficultyTitleText("SELECT DIFFICULTY:", gameFont, 20);
     difficultyTitleText.setFillColor(Color::Yellow);
-    difficultyTitleText.setPosition(N * ts / 2 - 120, 120);
+    difficultyTitleText.setPosition(windowWidth / 2 - 120, 120);
 
     Text easyText("1. EASY (2 ENEMIES)", gameFont, 16);
     easyText.setFillColor(Color::White);
-    easyText.setPosition(N * ts / 2 - 90, 170);
+    easyText.setPosition(windowWidth / 2 - 90, 170);
 
     Text mediumText("2. MEDIUM (4 ENEMIES)", gameFont, 16);
     mediumText.setFillColor(Color::White);
-    mediumText.setPosition(N * ts / 2 - 90, 210);
+    mediumText.setPosition(windowWidth / 2 - 90, 210);
 
     Text hardText("3. HARD (6 ENEMIES)", gameFont, 16);
     hardText.setFillColor(Color::White);
-    hardText.setPosition(N * ts / 2 - 90, 250);
+    hardText.setPosition(windowWidth / 2 - 90, 250);
 
     Text backText("4. BACK TO MAIN MENU", gameFont, 16);
     backText.setFillColor(Color::White);
-    backText.setPosition(N * ts / 2 - 90, 320);
+    backText.setPosition(windowWidth / 2 - 90, 320);
 
     // Game over text
     Text restartText("PRESS R TO RESTART", gameFont, 16);
     restartText.setFillColor(Color::White);
-    restartText.setPosition(N * ts / 2 - 120, M * ts / 2 + 50);
+    restartText.setPosition(windowWidth / 2 - 120, windowHeight / 2 + 50);
     
     Text menuText("PRESS ESC FOR MENU", gameFont, 16);
     menuText.setFillColor(Color::White);
-    menuText.setPosition(N * ts / 2 - 120, M * ts / 2 + 80);
-    
-    // Number of moves text
-    Text moves("Moves = " + to_string(moveCounter), gameFont, 10);
-    moves.setFillColor(Color::White);
-    moves.setPosition(10, 8);
+    menuText.setPosition(windowWidth / 2 - 120, windowHeight / 2 + 80);
     
-    // Game elapsed text
-    timerText.setString("Timer: " + to_string(elapsedTime));
-    timerText.setFont(gameFont);
-    timerText.setCharacterSize(10);
-    timerText.setFillColor(Color::White);
-    timerText.setPosition(10, 23);
-    
-    // Speed multiplier text
-    speedText.setString("Speed: x1.0");
-    speedText.setFont(gameFont);
-    speedText.setCharacterSize(10);
-    speedText.setFillColor(Color::White);
-    speedText.setPosition(10, 38);
+    // Number of moves, elapsed time and speed multiplier
+    resetHud(hud, gameFont, 10);
+    movesField = addHudField(hud, 10, 8, Color::White, 32);
+    timerField = addHudField(hud, 10, 23, Color::White, 32);
+    speedField = addHudField(hud, 10, 38, Color::White, 32);
+    mapField = addHudField(hud, 10, 53, Color::White, 32);
+    setHudFieldVisible(hud, mapField, bigMapPath != 0);
+    updateHudText(firstFrame);
+
+    // Ping, bandwidth and scores of an online match
+    netField = addHudField(hud, 10, 53, Color::Cyan, 128);
+    setHudFieldVisible(hud, netField, playingOnline);
+
+    // Frame timings overlay, F3 shows it
+    profileField = addHudField(hud, 10, playingOnline || bigMapPath ? 73 : 58, Color::Yellow, maxHudFieldLength);
+    setHudFieldVisible(hud, profileField, showProfile);
+    float profileRefreshTimer = 0;    // The overlay is only rebuilt a few times a second
+
+    // Best scores of the difficulty just played, shown on the game over screen
+    scoresField = addHudField(hud, windowWidth > 220 ? windowWidth - 210 : 10, 100, Color::White, maxHudFieldLength);
+    setHudFieldVisible(hud, scoresField, false);
+    bool firstFrameShown = false;
 
     // Main game loop
     while (window.isOpen())
     {
+        beginProfiledFrame(profiler);
+
         // Handle time
         float time = clock.getElapsedTime().asSeconds();
         clock.restart();
-        timer += time;
 
         // Process events
+        ProfileClock::time_point phaseStart = ProfileClock::now();
         Event e;
         while (window.pollEvent(e))
         {
             if (e.type == Event::Closed)
                 window.close();
                
+            if (e.type == Event::KeyPressed && e.key.code == Keyboard::F3) {
+                showProfile = !showProfile;
+                setHudFieldVisible(hud, profileField, showProfile);
+            }
+
+            // F5 suspends the game to the save state file, F9 resumes it from there (not in an online match,
+            // and not on a big map, which keeps what was captured on it already)
+            if (e.type == Event::KeyPressed && e.key.code == Keyboard::F5 && gameState == PLAYING && !playingOnline && !bigMapPath)
+                sendSimCommand(SIM_SAVE_STATE);
+            if (e.type == Event::KeyPressed && e.key.code == Keyboard::F9 && !playingOnline && !bigMapPath)
+                sendSimCommand(SIM_LOAD_STATE, 0, ++requestedGame);
+
             if (e.type == Event::KeyPressed)
             {
                 // Use nested switch statements for menu navigation
@@ -417,23 +761,8 @@ int main()
                             case Keyboard::Numpad1:
                                 // Start game with current difficulty
                                 gameState = PLAYING;
-                                gameRunning = true;
-                                playerX = 10;
-                                playerY = 0;
-                                moveX = moveY = 0;
-                                moveCounter = 0;
-                                resetElapsedTimer();
-                                
-                                // Reset enemies
-                                for (int i = 0; i < enemyCount; i++) {
-                                    enemies[i] = Enemy();
-                                }
-                                
-                                // Reset grid
-                                initializeGrid();
+                                requestNewGame();
                                 break;
-                                
-                                switchedPattern = false;
                             
                             case Keyboard::Num2:
                             case Keyboard::Numpad2:
@@ -454,79 +783,27 @@ int main()
                         {
                             case Keyboard::Num1:
                             case Keyboard::Numpad1:
-                                // Easy difficulty
+                                // Easy difficulty, start game immediately
                                 difficultyLevel = 1;
-                                enemyCount = 2;
-                                
-                                // Start game immediately
                                 gameState = PLAYING;
-                                gameRunning = true;
-                                playerX = 10;
-                                playerY = 0;
-                                moveX = moveY = 0;
-                                moveCounter = 0;
-                                resetElapsedTimer();
-                                
-                                // Reset enemies
-                                for (int i = 0; i < enemyCount; i++) {
-                                    enemies[i] = Enemy();
-                                }
-                                
-                                // Reset grid
-                                initializeGrid();
+                                requestNewGame();
                                 break;
-                                
-                                switchedPattern = false;
                             
                             case Keyboard::Num2:
                             case Keyboard::Numpad2:
-                                // Medium difficulty
+                                // Medium difficulty, start game immediately
                                 difficultyLevel = 2;
-                                enemyCount = 4;
-                                
-                                // Start game immediately
                                 gameState = PLAYING;
-                                gameRunning = true;
-                                playerX = 10;
-                                playerY = 0;
-                                moveX = moveY = 0;
-                                moveCounter = 0;
-                                resetElapsedTimer();
-                                
-                                // Reset enemies
-                                for (int i = 0; i < enemyCount; i++) {
-                                    enemies[i] = Enemy();
-                                }
-                                
-                                // Reset grid
-                                initializeGrid();
+                                requestNewGame();
                                 break;
                             
                             case Keyboard::Num3:
                             case Keyboard::Numpad3:
-                                // Hard difficulty
+                                // Hard difficulty, start game immediately
                                 difficultyLevel = 3;
-                                enemyCount = 6;
-                                
-                                // Start game immediately
                                 gameState = PLAYING;
-                                gameRunning = true;
-                                playerX = 10;
-                                playerY = 0;
-                                moveX = moveY = 0;
-                                moveCounter = 0;
-                                resetElapsedTimer();
-                                
-                                // Reset enemies
-                                for (int i = 0; i < enemyCount; i++) {
-                                    enemies[i] = Enemy();
-                                }
-                                
-                                // Reset grid
-                                initializeGrid();
+                                requestNewGame();
                                 break;
-                                
-                                switchedPattern = false;
                             
                             case Keyboard::Num4:
                             case Keyboard::Numpad4:
@@ -538,32 +815,28 @@ int main()
                         break;
                     
                     case PLAYING:
-                        if (e.key.code == Keyboard::Escape)
+                        if (e.key.code == Keyboard::Escape && playingOnline)
+                        {
+                            // There is no menu to go back to in a match, leaving it closes the game
+                            window.close();
+                        }
+                        else if (e.key.code == Keyboard::Escape)
                         {
                             gameState = MENU;
+                            sendSimCommand(SIM_LEAVE_GAME);
                         }
                         break;
                     
                     case GAME_OVER:
-                        moveCounter = 0;
-                        resetElapsedTimer();
-                        if (e.key.code == Keyboard::R)
+                        if (playingOnline)
+                        {
+                            if (e.key.code == Keyboard::Escape)
+                                window.close();
+                        }
+                        else if (e.key.code == Keyboard::R)
                         {
                             gameState = PLAYING;
-                            gameRunning = true;
-                            playerX = 10;
-                            playerY = 0;
-                            moveX = moveY = 0;
-                            
-                            
-                            initializeGrid();
-                            
-                            // Reset enemies
-                            for (int i = 0; i < enemyCount; i++) {
-                                enemies[i] = Enemy();
-                            }
-                            
-                            switchedPattern = false;
+                            requestNewGame();
                         }
                         else if (e.key.code == Keyboard::Escape)
                         {
@@ -573,98 +846,67 @@ int main()
                 }
             }
         }
+        addPhaseTime(profiler, PHASE_EVENTS, phaseStart);
 
-        // Game logic only runs in PLAYING state
+        // The simulation picks up the arrow key held down at its next tick
+        Direction input = DIR_NONE;
         if (gameState == PLAYING)
         {
-            moves.setString("Moves = " + to_string(moveCounter));
-            updateElapsedTimer();
-            
-            // Handle keyboard input for movement
-            if (Keyboard::isKeyPressed(Keyboard::Left))  { moveX = -1; moveY = 0; }
-            if (Keyboard::isKeyPressed(Keyboard::Right)) { moveX = 1; moveY = 0; }
-            if (Keyboard::isKeyPressed(Keyboard::Up))    { moveX = 0; moveY = -1; }
-            if (Keyboard::isKeyPressed(Keyboard::Down))  { moveX = 0; moveY = 1; }
-            
-            if (!gameRunning) 
-            {
-                timerActive = false;
-                gameState = GAME_OVER;
-                continue;
-            }
+            if (Keyboard::isKeyPressed(Keyboard::Left))  input = DIR_LEFT;
+            if (Keyboard::isKeyPressed(Keyboard::Right)) input = DIR_RIGHT;
+            if (Keyboard::isKeyPressed(Keyboard::Up))    input = DIR_UP;
+            if (Keyboard::isKeyPressed(Keyboard::Down))  input = DIR_DOWN;
+        }
+        heldInput.store(input);
 
-            // Update player position
-            if (timer > delay)
-            {
-                // We create variables that store the player's previous to ensure that it has actually moved to count moves
-                int previousX = playerX;
-                int previousY = playerY;
-                
-                // Moving the player
-                playerX += moveX;
-                playerY += moveY;
-                
-                // Handle boundaries
-                if (playerX < 0) playerX = 0;
-                if (playerX > N - 1) playerX = N - 1;
-                if (playerY < 0) playerY = 0;
-                if (playerY > M - 1) playerY = M - 1;
-                
-                // MOVEMENT TRACKING - Starts when player moves from border to unmarked space 
-                // Start by assuming player is on border - needs to be static variable because it shouldnt reset between frames
-                static bool prevOnBorder = true;
-                
-                // Check if player is currently on marked territory
-                bool nowOnBorder = (grid[playerY][playerX] == 1);
-                
-                // If the player was on a marked grid and now on unmarked one, this counts as a move)
-                bool moved = (previousX != playerX || previousY != playerY);
-                if (moved && prevOnBorder && grid[playerY][playerX] == 0) {
-                  moveCounter++;
-                  moves.setString("Moves = " + to_string(moveCounter));  // Displays updated number of moves
-                }
-                
-                // The variable that tracks whether a player is on a marked cell should be updated for the next frame
-                prevOnBorder = nowOnBorder;
-
-                // Check collisions
-                if (grid[playerY][playerX] == 2) 
-                    gameRunning = false;
-                if (grid[playerY][playerX] == 0) 
-                    grid[playerY][playerX] = 2;
-                
-                timer = 0;
+        // Take the newest frame the simulation published, without one the last frame is drawn again
+        bool freshFrame = takeLatestFrame(frames);
+        const FrameSnapshot &frame = frontFrame(frames);
+        if (gameState == PLAYING) {
+            frames.shown++;
+            if (!freshFrame)
+                frames.repeated++;
+        }
+        if (freshFrame)
+        {
+            // A game newer than the one asked for was restored with F9, frames of older games are stale
+            if (frame.gameNumber > awaitedGame) {
+                awaitedGame = frame.gameNumber;
+                if (frame.running)
+                    gameState = PLAYING;
             }
+            if (gameState == PLAYING && frame.gameNumber == awaitedGame && !frame.running)
+                gameState = GAME_OVER;
 
-            // Move enemies by the current speed multiplier
-            for (int i = 0; i < enemyCount; i++) 
-                enemies[i].move(speedMultiplier);
-
-            // Check if player completed a section
-            if (grid[playerY][playerX] == 1)
-            {
-                moveX = moveY = 0;
-
-                // Fill areas
-                for (int i = 0; i < enemyCount; i++)
-                    drop(enemies[i].y / ts, enemies[i].x / ts);
-
-                // Update grid
-                for (int i = 0; i < M; i++)
-                    for (int j = 0; j < N; j++)
-                        if (grid[i][j] == -1) 
-                            grid[i][j] = 0;
-                        else 
-                            grid[i][j] = 1;
+            // A state saved on another board size brings its own size
+            bool resized = frame.board.rows != shownBoard.rows || frame.board.cols != shownBoard.cols;
+            loadBoardCells(shownBoard, frame.board.rows, frame.board.cols, frame.board.filled, frame.board.trail);
+            if (resized) {
+                boardView.reset(FloatRect(0, 0, shownBoard.cols * ts, shownBoard.rows * ts));
+                resetTileRenderer(boardRenderer, shownBoard, assets.atlas, Vector2i(tilesRect.left, tilesRect.top));
             }
+            if (showOpponent)
+                loadBoardCells(opponentBoard, frame.opponent.rows, frame.opponent.cols, frame.opponent.filled, frame.opponent.trail);
+            setHudField(hud, scoresField, frame.scoresText);
+        }
 
-            // Check player-enemy collisions
-            for (int i = 0; i < enemyCount; i++)
-                if (grid[int(enemies[i].y / ts)][int(enemies[i].x / ts)] == 2) 
-                    gameRunning = false;
+        phaseStart = ProfileClock::now();
+        if (gameState == PLAYING)
+            updateHudText(frame);
+        if (playingOnline)
+            setHudField(hud, netField, frame.netText);
+
+        profileRefreshTimer += time;
+        if (showProfile && profileRefreshTimer >= 0.25f) {
+            profileRefreshTimer = 0;
+            updateProfileText(profiler, frame);
         }
+        setHudFieldVisible(hud, scoresField, frame.showScores && gameState == GAME_OVER);
+        updateHud(hud);
+        addPhaseTime(profiler, PHASE_HUD, phaseStart);
 
         // Draw everything
+        phaseStart = ProfileClock::now();
         window.clear(Color(0, 0, 50)); // Dark blue background
 
         switch (gameState)
@@ -691,51 +933,61 @@ int main()
                 
             case GAME_OVER:
                 
-                // Draw grid
-                for (int i = 0; i < M; i++)
-                {
-                    for (int j = 0; j < N; j++)
-                    {
-                        if (grid[i][j] == 0) continue;
-                        if (grid[i][j] == 1) sTile.setTextureRect(IntRect(0, 0, ts, ts));
-                        if (grid[i][j] == 2) sTile.setTextureRect(IntRect(54, 0, ts, ts));
-                        sTile.setPosition(j * ts, i * ts);
-                        window.draw(sTile);
-                    }
+                // On a big map the view is centred on the player, up to the edges of the sector
+                if (bigMapPath) {
+                    Vector2f half = boardView.getSize() / 2.0f;
+                    float centerX = min(max((frame.playerX + 0.5f) * ts, half.x), shownBoard.cols * ts - half.x);
+                    float centerY = min(max((frame.playerY + 0.5f) * ts, half.y), shownBoard.rows * ts - half.y);
+                    boardView.setCenter(centerX, centerY);
                 }
 
+                // Draw grid
+                window.setView(boardView);
+                updateTileRenderer(boardRenderer, shownBoard);
+                drawTileRenderer(window, boardRenderer);
+
                 // Draw player
-                sTile.setTextureRect(IntRect(36, 0, ts, ts));
-                sTile.setPosition(playerX * ts, playerY * ts);
+                sTile.setTextureRect(IntRect(tilesRect.left + 36, tilesRect.top, ts, ts));
+                sTile.setPosition(frame.playerX * ts, frame.playerY * ts);
                 window.draw(sTile);
-                window.draw(moves);
-                window.draw(timerText);
-                window.draw(speedText);
 
                 // Draw enemies
                 // Apply different colours to the trails of enemies on different patterns for better discernability
                 int rotationIndex;   // Apply different rotation speeds for each pattern
-                for (int i = 0; i < enemyCount; i++)
+                // Enemies are drawn between their last two ticks, by how long ago the frame was published
+                float sincePublished = chrono::duration<float>(ProfileClock::now() - frame.publishedAt).count();
+                float alpha = gameState == PLAYING ? min(1.0f, sincePublished / frame.tickSeconds) : 1.0f;
+                const EnemyPool &enemies = frame.enemies;
+                for (int i = 0; i < enemies.count; i++)
                 {
-                    sEnemy.setPosition(enemies[i].x, enemies[i].y);
+                    sEnemy.setPosition(enemies.previousX[i] + (enemies.x[i] - enemies.previousX[i]) * alpha,
+                                       enemies.previousY[i] + (enemies.y[i] - enemies.previousY[i]) * alpha);
                     
                     // Applying different rotation and colours to different patterns of movmement
-                    if (enemies[i].patternActive) {
-                      if (enemies[i].patternType == 0) {   // Pattern 0 refers to zigzag
-                        sEnemy.rotate(10);
-                        sEnemy.setColor(Color::Magenta);
-                      }
-                      else {// referring to circular pattern
-                        sEnemy.rotate(15);
-                        sEnemy.setColor(Color::Cyan);
-                      }
+                    if (enemies.motion[i] != MOTION_LINEAR) {
+                      sEnemy.rotate(patternSpin[enemies.motion[i]]);
+                      sEnemy.setColor(patternColors[enemies.motion[i]]);
                     }
                     else {
                       sEnemy.rotate(5);
+                      sEnemy.setColor(Color::White);    // The sprite is shared, don't keep the last pattern's colour
                     }
                     window.draw(sEnemy);
                 }
 
+                // The opponent's board and player, as of the last snapshot
+                if (showOpponent) {
+                    window.setView(opponentView);
+                    updateTileRenderer(opponentRenderer, opponentBoard);
+                    drawTileRenderer(window, opponentRenderer);
+                    sTile.setPosition(frame.opponentX * ts, frame.opponentY * ts);
+                    window.draw(sTile);
+                }
+
+                // HUD is drawn in window coordinates so it keeps its size on scaled boards
+                window.setView(window.getDefaultView());
+                drawHud(window, hud);
+
                 // Draw game over screen
                 if (gameState == GAME_OVER)
                 {
@@ -746,8 +998,51 @@ int main()
                 break;
         }
 
+        addPhaseTime(profiler, PHASE_RENDER, phaseStart);
+
         // Display the window
+        phaseStart = ProfileClock::now();
         window.display();
+        addPhaseTime(profiler, PHASE_PRESENT, phaseStart);
+        endProfiledFrame(profiler);
+
+        if (!firstFrameShown) {
+            firstFrameShown = true;
+            double firstFrameMs = chrono::duration<double, milli>(ProfileClock::now() - launchTime).count();
+            cout << "Assets loaded in " << assets.loadMilliseconds << " ms from "
+                 << (assets.fromBundle ? assetsPath : "loose files") << ", first frame after " << firstFrameMs << " ms" << endl;
+        }
+    }
+
+    // The game is the window's again once the simulation thread has stopped
+    stopSimulation = true;
+    simThread.join();
+    saveRecording();
+    if (simRunning)
+        logTelemetryEvent("leave");
+    closeTelemetryLog(telemetry);    // Waits for the last lines to reach the file
+    if (telemetry.writeFailed)
+        cout << "Error: Some telemetry could not be written to " << telemetryPath << endl;
+    if (bigMap.data) {
+        if (bigMap.sectorLoaded)
+            storeSector(game, bigMap);
+        cout << "Big map: " << bigMap.sectorMoves << " sector moves, " << bigMap.chunksWritten << " chunks written" << endl;
+        if (!closeBigMap(bigMap))
+            cout << "Error: Unable to write the big map back to " << bigMapPath << endl;
+    }
+    closeScoreboard(scoreboard);    // Waits for the last scores to reach the disk
+    if (scoreboard.writeFailed)
+        cout << "Error: Some scores could not be written to " << scoresPath << endl;
+    if (playingOnline)
+        writeNetClientReport(netClient, chrono::duration<double>(ProfileClock::now() - netClient.startTime).count(), cout);
+    writeFrameHandoffReport(frames, cout);
+
+    // The game phases were timed per batch of ticks, they go next to the frame timings
+    if (profileCsvPath) {
+        char tickCsvPath[1024];
+        snprintf(tickCsvPath, sizeof(tickCsvPath), "%s.ticks.csv", profileCsvPath);
+        if (!writeProfileCsv(profiler, profileCsvPath) || !writeProfileCsv(tickProfiler, tickCsvPath))
+            cout << "Error: Unable to write frame timings to " << profileCsvPath << endl;
     }
 
     return 0;
@@ -0,0 +1,147 @@
+#include "Assets.h"
+#include <chrono>
+#include <thread>
+using namespace sf;
+
+const char *const atlasImageNames[ATLAS_IMAGE_COUNT] = {"tiles", "gameover", "enemy"};
+const char *const atlasImagePaths[ATLAS_IMAGE_COUNT] = {"images/tiles.png", "images/gameover.png", "images/enemy.png"};
+const char *const gameFontPath = "fonts/arial.ttf";
+const char *const defaultAssetBundlePath = "assets.xpk";
+
+/**
+ * Packs the images into shelves as wide as the widest image, tallest
+ * first, and copies them into one atlas image. rects gets where each
+ * image ended up.
+ */
+void packAtlas(const Image *images, int count, Image &atlas, IntRect *rects)
+{
+    int *order = new int[count];
+    int width = 1;
+    for (int i = 0; i < count; i++)
+    {
+        // Insertion sort by height, there are only a handful of images
+        int j = i;
+        while (j > 0 && images[order[j - 1]].getSize().y < images[i].getSize().y) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+
+        if (int(images[i].getSize().x) > width)
+            width = images[i].getSize().x;
+    }
+
+    int x = 0, y = 0, shelfHeight = 0;
+    for (int k = 0; k < count; k++)
+    {
+        int i = order[k];
+        int w = images[i].getSize().x;
+        int h = images[i].getSize().y;
+        if (x > 0 && x + w > width) {
+            x = 0;
+            y += shelfHeight + atlasPadding;
+            shelfHeight = 0;
+        }
+        rects[i] = IntRect(x, y, w, h);
+        x += w + atlasPadding;
+        if (h > shelfHeight)
+            shelfHeight = h;
+    }
+    delete[] order;
+
+    atlas.create(width, y + shelfHeight, Color(0, 0, 0, 0));
+    for (int i = 0; i < count; i++)
+        atlas.copy(images[i], rects[i].left, rects[i].top);
+}
+
+static void loadImageFile(Image *image, const char *path, bool *loaded)
+{
+    *loaded = image->loadFromFile(path);
+}
+
+// Decodes every image of the atlas from images/, each on its own thread
+bool loadLooseImages(Image *images)
+{
+    bool loaded[ATLAS_IMAGE_COUNT];
+    std::thread threads[ATLAS_IMAGE_COUNT];
+    for (int i = 0; i < ATLAS_IMAGE_COUNT; i++)
+        threads[i] = std::thread(loadImageFile, &images[i], atlasImagePaths[i], &loaded[i]);
+
+    bool allLoaded = true;
+    for (int i = 0; i < ATLAS_IMAGE_COUNT; i++) {
+        threads[i].join();
+        allLoaded = allLoaded && loaded[i];
+    }
+    return allLoaded;
+}
+
+static void loadFontFile(Font *font, const char *path, bool *loaded)
+{
+    *loaded = font->loadFromFile(path);
+}
+
+static void loadFontMemory(Font *font, const unsigned char *data, unsigned int size, bool *loaded)
+{
+    *loaded = font->loadFromMemory(data, size);
+}
+
+// Checks the bundle has everything the game needs and fills in the rectangles of the images
+static bool findBundleAssets(GameAssets &assets, const AssetEntry *&atlas, const AssetEntry *&font)
+{
+    atlas = findAsset(assets.bundle, "atlas");
+    font = findAsset(assets.bundle, "font");
+    if (!atlas || atlas->type != ASSET_PIXELS || !font || font->type != ASSET_FILE)
+        return false;
+
+    for (int i = 0; i < ATLAS_IMAGE_COUNT; i++) {
+        const AssetEntry *region = findAsset(assets.bundle, atlasImageNames[i]);
+        if (!region || region->type != ASSET_REGION)
+            return false;
+        assets.rects[i] = IntRect(region->x, region->y, region->width, region->height);
+    }
+    return true;
+}
+
+/**
+ * Loads the atlas and the font, from the bundle when it can be opened and
+ * has everything in it, otherwise from the loose files. The font is parsed
+ * on a second thread while the atlas is decoded (loose images, one thread
+ * each) and uploaded. Must be called with a window open, since the
+ * texture is created here.
+ */
+bool loadGameAssets(GameAssets &assets, const char *bundlePath)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool fontLoaded = false;
+    bool atlasLoaded = false;
+
+    const AssetEntry *atlas = 0, *font = 0;
+    assets.fromBundle = openAssetBundle(assets.bundle, bundlePath) && findBundleAssets(assets, atlas, font);
+
+    if (assets.fromBundle)
+    {
+        std::thread fontThread(loadFontMemory, &assets.font, assetData(assets.bundle, *font), font->size, &fontLoaded);
+
+        // The pixels are stored decoded, so they go to the texture straight from the mapping
+        atlasLoaded = assets.atlas.create(atlas->width, atlas->height);
+        if (atlasLoaded)
+            assets.atlas.update(assetData(assets.bundle, *atlas), atlas->width, atlas->height, 0, 0);
+        fontThread.join();
+    }
+    else
+    {
+        closeAssetBundle(assets.bundle);
+        std::thread fontThread(loadFontFile, &assets.font, gameFontPath, &fontLoaded);
+
+        Image images[ATLAS_IMAGE_COUNT];
+        if (loadLooseImages(images)) {
+            Image packed;
+            packAtlas(images, ATLAS_IMAGE_COUNT, packed, assets.rects);
+            atlasLoaded = assets.atlas.loadFromImage(packed);
+        }
+        fontThread.join();
+    }
+
+    assets.loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return fontLoaded && atlasLoaded;
+}
@@ -0,0 +1,37 @@
+#ifndef XONIX_ASSETS_H
+#define XONIX_ASSETS_H
+
+#include <SFML/Graphics.hpp>
+#include "engine/AssetBundle.h"
+
+// The images packed into the atlas, in the order of the rectangles in GameAssets
+enum AtlasImage { ATLAS_TILES, ATLAS_GAMEOVER, ATLAS_ENEMY, ATLAS_IMAGE_COUNT };
+extern const char *const atlasImageNames[ATLAS_IMAGE_COUNT];
+extern const char *const atlasImagePaths[ATLAS_IMAGE_COUNT];
+
+extern const char *const gameFontPath;
+extern const char *const defaultAssetBundlePath;
+
+const int atlasPadding = 2;        // Transparent pixels between packed images
+
+/**
+ * Everything the game draws with: one texture holding every image and the
+ * font. They come from the bundle built by xonix_pack when there is one,
+ * otherwise from the loose files, which are then packed the same way at
+ * startup. Either way the independent parts load on separate threads.
+ */
+struct GameAssets
+{
+    AssetBundle bundle;    // Kept open, the font is read straight out of it
+    sf::Texture atlas;
+    sf::Font font;
+    sf::IntRect rects[ATLAS_IMAGE_COUNT];
+    bool fromBundle;
+    double loadMilliseconds;
+};
+
+void packAtlas(const sf::Image *images, int count, sf::Image &atlas, sf::IntRect *rects);
+bool loadLooseImages(sf::Image *images);
+bool loadGameAssets(GameAssets &assets, const char *bundlePath);
+
+#endif
@@ -0,0 +1,153 @@
+#include "Hud.h"
+#include <cstring>
+using namespace sf;
+
+// sf::Text grows every glyph quad by a pixel so smoothed edges aren't cut, the HUD does the same
+const float glyphPadding = 1.0f;
+
+Hud::Hud()
+{
+    font = 0;
+    characterSize = 0;
+    fieldCount = 0;
+}
+
+/**
+ * Forgets every field. Fields are added once at startup, after that only
+ * their text changes and the vertex array is never resized.
+ */
+void resetHud(Hud &hud, const Font &font, unsigned characterSize)
+{
+    hud.font = &font;
+    hud.characterSize = characterSize;
+    hud.fieldCount = 0;
+    hud.vertices.setPrimitiveType(Quads);
+    hud.vertices.clear();
+}
+
+/**
+ * Adds an empty field with its top left corner at x, y in window
+ * coordinates and room for capacity glyphs. Returns the field's index,
+ * or -1 when the HUD is full.
+ */
+int addHudField(Hud &hud, float x, float y, const Color &color, int capacity)
+{
+    if (hud.fieldCount == maxHudFields)
+        return -1;
+    if (capacity > maxHudFieldLength)
+        capacity = maxHudFieldLength;
+
+    HudField &field = hud.fields[hud.fieldCount];
+    field.text[0] = '\0';
+    field.x = x;
+    field.y = y;
+    field.color = color;
+    field.capacity = capacity;
+    field.firstVertex = int(hud.vertices.getVertexCount());
+    field.visible = true;
+    field.dirty = true;
+
+    // New quads start out empty, so nothing shows until the field gets text
+    hud.vertices.resize(field.firstVertex + capacity * 4);
+    return hud.fieldCount++;
+}
+
+/**
+ * Changes the text of a field. Setting the text it already shows does
+ * nothing, so callers can format their values every frame.
+ */
+void setHudField(Hud &hud, int field, const char *text)
+{
+    HudField &f = hud.fields[field];
+    if (strncmp(f.text, text, f.capacity) == 0)
+        return;
+
+    strncpy(f.text, text, f.capacity);
+    f.text[f.capacity] = '\0';
+    f.dirty = true;
+}
+
+void setHudFieldVisible(Hud &hud, int field, bool visible)
+{
+    HudField &f = hud.fields[field];
+    if (f.visible != visible) {
+        f.visible = visible;
+        f.dirty = true;
+    }
+}
+
+// Writes the quads of one field the way sf::Text lays out its glyphs, unused quads are collapsed
+static void layoutField(Hud &hud, HudField &field)
+{
+    Vertex *quad = &hud.vertices[field.firstVertex];
+    int used = 0;
+
+    if (field.visible)
+    {
+        const float lineSpacing = hud.font->getLineSpacing(hud.characterSize);
+        float penX = field.x;
+        float baseline = field.y + hud.characterSize;
+        Uint32 previous = 0;
+
+        for (const char *c = field.text; *c != '\0'; c++)
+        {
+            Uint32 code = (unsigned char)*c;
+            penX += hud.font->getKerning(previous, code, hud.characterSize);
+            previous = code;
+
+            if (code == '\n') {
+                penX = field.x;
+                baseline += lineSpacing;
+                continue;
+            }
+
+            const Glyph &glyph = hud.font->getGlyph(code, hud.characterSize, false);
+            float left = penX + glyph.bounds.left - glyphPadding;
+            float top = baseline + glyph.bounds.top - glyphPadding;
+            float right = penX + glyph.bounds.left + glyph.bounds.width + glyphPadding;
+            float bottom = baseline + glyph.bounds.top + glyph.bounds.height + glyphPadding;
+
+            float u1 = glyph.textureRect.left - glyphPadding;
+            float v1 = glyph.textureRect.top - glyphPadding;
+            float u2 = glyph.textureRect.left + glyph.textureRect.width + glyphPadding;
+            float v2 = glyph.textureRect.top + glyph.textureRect.height + glyphPadding;
+
+            Vertex *q = quad + used * 4;
+            q[0] = Vertex(Vector2f(left, top), field.color, Vector2f(u1, v1));
+            q[1] = Vertex(Vector2f(right, top), field.color, Vector2f(u2, v1));
+            q[2] = Vertex(Vector2f(right, bottom), field.color, Vector2f(u2, v2));
+            q[3] = Vertex(Vector2f(left, bottom), field.color, Vector2f(u1, v2));
+            used++;
+
+            penX += glyph.advance;
+        }
+    }
+
+    for (int k = used * 4; k < field.capacity * 4; k++)
+        quad[k].position = Vector2f(0, 0);
+}
+
+/**
+ * Lays out the fields whose text changed since the last call. Returns how
+ * many fields were laid out, 0 on a frame where the HUD shows the same
+ * values as before.
+ */
+int updateHud(Hud &hud)
+{
+    int laidOut = 0;
+    for (int i = 0; i < hud.fieldCount; i++) {
+        if (hud.fields[i].dirty) {
+            layoutField(hud, hud.fields[i]);
+            hud.fields[i].dirty = false;
+            laidOut++;
+        }
+    }
+    return laidOut;
+}
+
+void drawHud(RenderTarget &target, const Hud &hud)
+{
+    // Glyphs are added to the atlas while laying out, which can move it, so it's looked up at draw time
+    RenderStates states(&hud.font->getTexture(hud.characterSize));
+    target.draw(hud.vertices, states);
+}
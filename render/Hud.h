@@ -0,0 +1,47 @@
+#ifndef XONIX_HUD_H
+#define XONIX_HUD_H
+
+#include <SFML/Graphics.hpp>
+
+const int maxHudFields = 8;
+const int maxHudFieldLength = 384;    // Longest text one field can hold, the profile overlay is the longest
+
+// One line (or block of lines) of HUD text with a fixed range of quads in the HUD's vertex array
+struct HudField
+{
+    char text[maxHudFieldLength + 1];
+    float x, y;
+    sf::Color color;
+    int capacity;       // Glyphs the field has quads for, longer text is cut off
+    int firstVertex;
+    bool visible;
+    bool dirty;         // The text or visibility changed since the quads were last written
+};
+
+/**
+ * HUD text drawn from the font's glyph atlas with a single vertex array.
+ * sf::Text rebuilds its geometry on every setString(), so the HUD used to
+ * lay out three texts and allocate a handful of strings every frame. Here
+ * the fields are formatted into fixed buffers, a field whose text did not
+ * change is left alone, and every field shares one draw call. All fields
+ * use the same character size so they come from one atlas page.
+ */
+struct Hud
+{
+    const sf::Font *font;
+    unsigned characterSize;
+    HudField fields[maxHudFields];
+    int fieldCount;
+    sf::VertexArray vertices;
+
+    Hud();
+};
+
+void resetHud(Hud &hud, const sf::Font &font, unsigned characterSize);
+int addHudField(Hud &hud, float x, float y, const sf::Color &color, int capacity);
+void setHudField(Hud &hud, int field, const char *text);
+void setHudFieldVisible(Hud &hud, int field, bool visible);
+int updateHud(Hud &hud);
+void drawHud(sf::RenderTarget &target, const Hud &hud);
+
+#endif
@@ -0,0 +1,203 @@
+#include "TileRenderer.h"
+#include <algorithm>
+#include <cmath>
+using namespace sf;
+
+// Where each cell state is found in tiles.png
+const int filledTileX = 0;
+const int trailTileX = 54;
+
+TileRenderer::TileRenderer()
+{
+    rows = cols = 0;
+    chunkRows = chunkCols = 0;
+    chunks = 0;
+    caches = 0;
+    tiles = 0;
+    frame = 0;
+    evictCursor = 0;
+    chunksDrawn = chunksRendered = 0;
+}
+
+static void freeCaches(TileRenderer &renderer)
+{
+    for (int i = 0; i < renderer.chunkRows * renderer.chunkCols; i++)
+        delete renderer.caches[i].texture;
+    delete[] renderer.caches;
+    renderer.caches = 0;
+}
+
+TileRenderer::~TileRenderer()
+{
+    freeCaches(*this);
+    delete[] chunks;
+}
+
+// Rewrites the quad of one cell, empty cells get a quad with no area so nothing is drawn
+static void writeQuad(TileRenderer &renderer, const Board &board, int y, int x)
+{
+    int chunkIndex = (y / tileChunkSize) * renderer.chunkCols + x / tileChunkSize;
+    VertexArray &chunk = renderer.chunks[chunkIndex];
+    renderer.caches[chunkIndex].stale = true;
+    Vertex *quad = &chunk[((y % tileChunkSize) * tileChunkSize + x % tileChunkSize) * 4];
+
+    int cell = board.get(y, x);
+    float left = float(x * ts);
+    float top = float(y * ts);
+
+    if (cell != CELL_FILLED && cell != CELL_TRAIL) {
+        for (int k = 0; k < 4; k++)
+            quad[k].position = Vector2f(left, top);
+        return;
+    }
+
+    float tileX = float(renderer.tilesOrigin.x + (cell == CELL_FILLED ? filledTileX : trailTileX));
+    float tileY = float(renderer.tilesOrigin.y);
+    quad[0].position = Vector2f(left, top);
+    quad[1].position = Vector2f(left + ts, top);
+    quad[2].position = Vector2f(left + ts, top + ts);
+    quad[3].position = Vector2f(left, top + ts);
+    quad[0].texCoords = Vector2f(tileX, tileY);
+    quad[1].texCoords = Vector2f(tileX + ts, tileY);
+    quad[2].texCoords = Vector2f(tileX + ts, tileY + ts);
+    quad[3].texCoords = Vector2f(tileX, tileY + ts);
+}
+
+/**
+ * Sizes the vertex arrays for the board. The board's dirty plane decides
+ * what gets written, so after initializeGrid() the next update draws everything.
+ */
+void resetTileRenderer(TileRenderer &renderer, const Board &board, const Texture &tiles, Vector2i tilesOrigin)
+{
+    renderer.rows = board.rows;
+    renderer.cols = board.cols;
+    renderer.chunkRows = (board.rows + tileChunkSize - 1) / tileChunkSize;
+    renderer.chunkCols = (board.cols + tileChunkSize - 1) / tileChunkSize;
+    renderer.tiles = &tiles;
+    renderer.tilesOrigin = tilesOrigin;
+
+    freeCaches(renderer);
+    delete[] renderer.chunks;
+    renderer.chunks = new VertexArray[renderer.chunkRows * renderer.chunkCols];
+    renderer.caches = new TileChunkCache[renderer.chunkRows * renderer.chunkCols];
+    for (int i = 0; i < renderer.chunkRows * renderer.chunkCols; i++) {
+        renderer.chunks[i].setPrimitiveType(Quads);
+        renderer.chunks[i].resize(tileChunkSize * tileChunkSize * 4);
+        renderer.caches[i].texture = 0;
+        renderer.caches[i].stale = true;
+        renderer.caches[i].lastDrawn = 0;
+    }
+    renderer.evictCursor = 0;
+}
+
+/**
+ * Rewrites the quads of the cells that changed since the last call and
+ * clears the dirty plane. Returns how many quads were rewritten.
+ */
+int updateTileRenderer(TileRenderer &renderer, Board &board)
+{
+    const int cellCount = board.rows * board.cols;
+    int updatedCells = 0;
+
+    for (int w = 0; w < board.wordCount; w++)
+    {
+        uint64_t changed = board.dirty[w];
+        board.dirty[w] = 0;
+
+        while (changed != 0) {
+            int index = w * bitsPerWord + lowestBit(changed);
+            changed &= changed - 1;
+            if (index >= cellCount)
+                break;
+
+            writeQuad(renderer, board, index / board.cols, index % board.cols);
+            updatedCells++;
+        }
+    }
+    return updatedCells;
+}
+
+/**
+ * Draws a chunk's quads into its cache, making the cache first if the chunk
+ * has none or the size it takes up on screen changed. Returns false if no
+ * render texture could be made, the chunk is then drawn straight.
+ */
+static bool renderChunkCache(TileRenderer &renderer, int chunkIndex, FloatRect area, unsigned int pixels)
+{
+    TileChunkCache &cache = renderer.caches[chunkIndex];
+    if (cache.texture && cache.texture->getSize().x != pixels) {
+        delete cache.texture;
+        cache.texture = 0;
+    }
+    if (!cache.texture) {
+        cache.texture = new RenderTexture;
+        if (!cache.texture->create(pixels, pixels)) {
+            delete cache.texture;
+            cache.texture = 0;
+            return false;
+        }
+        cache.stale = true;
+    }
+    if (cache.stale) {
+        cache.texture->setView(View(area));
+        cache.texture->clear(Color::Transparent);
+        cache.texture->draw(renderer.chunks[chunkIndex], RenderStates(renderer.tiles));
+        cache.texture->display();
+        cache.stale = false;
+        renderer.chunksRendered++;
+    }
+    return true;
+}
+
+/**
+ * Blits the chunks the target's view can see from their caches, drawing
+ * again only the caches that went stale, so a view scrolling over a big
+ * board costs the same as a small board. Caches are kept at the size the
+ * chunk takes up on screen, and one chunk a frame is checked for a cache
+ * that has been out of view long enough to free.
+ */
+void drawTileRenderer(RenderTarget &target, TileRenderer &renderer)
+{
+    const View &view = target.getView();
+    const float chunkPixels = float(tileChunkSize * ts);
+    Vector2f topLeft = view.getCenter() - view.getSize() / 2.0f;
+    Vector2f bottomRight = view.getCenter() + view.getSize() / 2.0f;
+    int firstRow = std::max(0, int(std::floor(topLeft.y / chunkPixels)));
+    int firstCol = std::max(0, int(std::floor(topLeft.x / chunkPixels)));
+    int lastRow = std::min(renderer.chunkRows - 1, int(std::floor(bottomRight.y / chunkPixels)));
+    int lastCol = std::min(renderer.chunkCols - 1, int(std::floor(bottomRight.x / chunkPixels)));
+
+    // Screen pixels per board pixel, so a scaled down board isn't cached at full size
+    float scale = target.getSize().x * view.getViewport().width / view.getSize().x;
+    unsigned int cachePixels = (unsigned int)std::max(1.0f, std::ceil(chunkPixels * scale));
+
+    renderer.frame++;
+    renderer.chunksDrawn = renderer.chunksRendered = 0;
+    RenderStates states(renderer.tiles);
+    Sprite blit;
+    for (int cy = firstRow; cy <= lastRow; cy++)
+        for (int cx = firstCol; cx <= lastCol; cx++) {
+            int chunkIndex = cy * renderer.chunkCols + cx;
+            FloatRect area(cx * chunkPixels, cy * chunkPixels, chunkPixels, chunkPixels);
+            renderer.caches[chunkIndex].lastDrawn = renderer.frame;
+            renderer.chunksDrawn++;
+            if (!renderChunkCache(renderer, chunkIndex, area, cachePixels)) {
+                target.draw(renderer.chunks[chunkIndex], states);
+                continue;
+            }
+            blit.setTexture(renderer.caches[chunkIndex].texture->getTexture(), true);
+            blit.setPosition(area.left, area.top);
+            blit.setScale(chunkPixels / cachePixels, chunkPixels / cachePixels);
+            target.draw(blit);
+        }
+
+    int chunkCount = renderer.chunkRows * renderer.chunkCols;
+    if (chunkCount > 0) {
+        TileChunkCache &oldest = renderer.caches[renderer.evictCursor];
+        if (oldest.texture && renderer.frame - oldest.lastDrawn > tileCacheKeepFrames) {
+            delete oldest.texture;
+            oldest.texture = 0;
+        }
+        renderer.evictCursor = (renderer.evictCursor + 1) % chunkCount;
+    }
+}
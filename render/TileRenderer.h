@@ -0,0 +1,54 @@
+#ifndef XONIX_TILE_RENDERER_H
+#define XONIX_TILE_RENDERER_H
+
+#include <SFML/Graphics.hpp>
+#include "engine/Board.h"
+
+const int tileChunkSize = 64;    // Cells per side of the block of the board kept in one vertex array
+const int tileCacheKeepFrames = 600;    // A chunk's cached image is freed once it hasn't been drawn for this many frames
+
+// The image of one chunk as it was last drawn, at the size it takes up on screen
+struct TileChunkCache
+{
+    sf::RenderTexture *texture;    // Made the first time the chunk is in view
+    bool stale;                    // A quad of the chunk was rewritten since the texture was drawn
+    long long lastDrawn;           // Frame the chunk was last in view
+};
+
+/**
+ * Draws the board from tiles.png with one vertex array per 64x64 block of
+ * cells. Every cell has a fixed quad and only the quads of cells in the
+ * board's dirty plane are rewritten each frame. Each chunk in view is drawn
+ * into a render texture of its own once and blitted from there, until a
+ * trail or a capture rewrites one of its quads, so a board that isn't
+ * changing costs one textured quad per visible chunk however big it is or
+ * however much of it is filled.
+ */
+struct TileRenderer
+{
+    int rows, cols;
+    int chunkRows, chunkCols;
+    sf::VertexArray *chunks;
+    TileChunkCache *caches;       // One per chunk, in the same order
+    const sf::Texture *tiles;
+    sf::Vector2i tilesOrigin;    // Where tiles.png starts in the texture, which can be an atlas
+    long long frame;              // drawTileRenderer() calls so far
+    int evictCursor;              // Next chunk checked for a cache to free
+
+    // What the last drawTileRenderer() call did, for the timings overlay and benchmarks
+    int chunksDrawn;
+    int chunksRendered;           // Chunks whose cache had to be drawn again
+
+    TileRenderer();
+    ~TileRenderer();
+
+    TileRenderer(const TileRenderer &) = delete;
+    TileRenderer &operator=(const TileRenderer &) = delete;
+};
+
+void resetTileRenderer(TileRenderer &renderer, const Board &board, const sf::Texture &tiles,
+                       sf::Vector2i tilesOrigin = sf::Vector2i(0, 0));
+int updateTileRenderer(TileRenderer &renderer, Board &board);
+void drawTileRenderer(sf::RenderTarget &target, TileRenderer &renderer);
+
+#endif
@@ -0,0 +1,28 @@
+# Records a few games with xonix_sim and plays each back with xonix_replay,
+# the replay has to run as many ticks and make the same captures.
+# Run by ctest with SIM, REPLAY and REPLAY_FILE set.
+foreach(SEED 2 4 11)
+  execute_process(COMMAND "${SIM}" --games 1 --threads 1 --seed ${SEED} --rows 60 --cols 90 --enemies 12
+                          --hunters 2 --max-ticks 20000 --record "${REPLAY_FILE}"
+                  OUTPUT_VARIABLE SIM_OUTPUT RESULT_VARIABLE SIM_RESULT)
+  execute_process(COMMAND "${REPLAY}" "${REPLAY_FILE}" --slowest 0
+                  OUTPUT_VARIABLE REPLAY_OUTPUT RESULT_VARIABLE REPLAY_RESULT)
+  if(NOT SIM_RESULT EQUAL 0 OR NOT REPLAY_RESULT EQUAL 0)
+    message(FATAL_ERROR "seed ${SEED}: xonix_sim or xonix_replay failed\n${SIM_OUTPUT}\n${REPLAY_OUTPUT}")
+  endif()
+
+  string(REGEX MATCH "ticks: +([0-9]+)" _ "${SIM_OUTPUT}")
+  set(SIM_TICKS ${CMAKE_MATCH_1})
+  string(REGEX MATCH "captures: +([0-9]+ \\([0-9]+ cells)" _ "${SIM_OUTPUT}")
+  set(SIM_CAPTURES ${CMAKE_MATCH_1})
+  string(REGEX MATCH "ticks: +([0-9]+) of" _ "${REPLAY_OUTPUT}")
+  set(REPLAY_TICKS ${CMAKE_MATCH_1})
+  string(REGEX MATCH "captures: +([0-9]+ \\([0-9]+ cells)" _ "${REPLAY_OUTPUT}")
+  set(REPLAY_CAPTURES ${CMAKE_MATCH_1})
+
+  if(SIM_TICKS STREQUAL "" OR NOT SIM_TICKS STREQUAL REPLAY_TICKS OR NOT SIM_CAPTURES STREQUAL REPLAY_CAPTURES)
+    message(FATAL_ERROR "seed ${SEED}: recorded ${SIM_TICKS} ticks and ${SIM_CAPTURES}), "
+                        "played back ${REPLAY_TICKS} ticks and ${REPLAY_CAPTURES})")
+  endif()
+endforeach()
+file(REMOVE "${REPLAY_FILE}")
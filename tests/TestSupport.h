@@ -0,0 +1,35 @@
+#ifndef XONIX_TEST_SUPPORT_H
+#define XONIX_TEST_SUPPORT_H
+
+// What the test programs share: checks that report and carry on, and a bot to play games with
+#include "engine/Game.h"
+#include "engine/SimulationClock.h"
+#include <iostream>
+
+inline int testFailures = 0;
+
+#define CHECK(condition)                                                                     \
+    do {                                                                                     \
+        if (!(condition)) {                                                                  \
+            std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #condition << std::endl; \
+            testFailures++;                                                                  \
+        }                                                                                    \
+    } while (0)
+
+// What main() returns, 0 when every check passed
+inline int testResult()
+{
+    if (testFailures > 0)
+        std::cout << testFailures << " checks failed" << std::endl;
+    return testFailures > 0 ? 1 : 0;
+}
+
+// Turns now and then and otherwise keeps going, like the bot in xonix_sim
+inline Direction testBotInput(Random &rng)
+{
+    if (rng.nextInt(20) != 0)
+        return DIR_NONE;
+    return Direction(DIR_LEFT + rng.nextInt(4));
+}
+
+#endif
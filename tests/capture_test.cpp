@@ -0,0 +1,91 @@
+// Captures on the bitplanes: the default capture that only explores the
+// pockets next to the trail has to fill the same cells as flood filling
+// the whole board from every enemy, and no open cell may be left that no
+// enemy can reach.
+#include "TestSupport.h"
+#include "engine/FloodFill.h"
+#include <cstring>
+
+// Open cells that none of the enemies can get to, there are none right after a capture
+static int unreachableCells(const Game &game, FloodFillWorkspace &work)
+{
+    Board board;
+    copyBoard(board, game.board);
+    memset(board.marked, 0, sizeof(uint64_t) * board.wordCount);
+    for (int i = 0; i < game.enemies.count; i++) {
+        int y = int(game.enemies.y[i] / ts);
+        int x = int(game.enemies.x[i] / ts);
+        if (board.get(y, x) == CELL_EMPTY)
+            floodFill(board, y, x, work);
+    }
+
+    int cells = 0;
+    for (int i = 0; i < board.rows; i++)
+        for (int j = 0; j < board.cols; j++)
+            if (board.get(i, j) == CELL_EMPTY)
+                cells++;
+    return cells;
+}
+
+// Plays the same game with both capture modes and compares the boards after every tick
+static int checkCaptureModesAgree(unsigned int seed, FloodFillWorkspace &work)
+{
+    Game regions, fullBoard;
+    startGame(regions, 2, seed, 40, 60, 6);
+    startGame(fullBoard, 2, seed, 40, 60, 6);
+    fullBoard.captureMode = CAPTURE_FULL_BOARD;
+
+    Random botRng;
+    botRng.seed(seed);
+    int captures = 0;
+    for (int tick = 0; tick < 6000 && regions.running; tick++)
+    {
+        Direction input = testBotInput(botRng);
+        TickResult a = updateGame(regions, 1.0f / defaultTickRate, input);
+        TickResult b = updateGame(fullBoard, 1.0f / defaultTickRate, input);
+        CHECK(a.captured == b.captured && a.capturedCells == b.capturedCells);
+        if (memcmp(regions.board.filled, fullBoard.board.filled, sizeof(uint64_t) * regions.board.wordCount) != 0) {
+            CHECK(!"capture modes filled different cells");
+            break;
+        }
+        if (a.captured) {
+            captures++;
+            CHECK(unreachableCells(regions, work) == 0);
+            CHECK(regions.stats.filledCells == countFilledCells(regions.board));
+        }
+    }
+    return captures;
+}
+
+// A line straight down the middle splits the board, the half without the enemy is filled
+static void testSplitFillsEmptyHalf()
+{
+    Game game;
+    startGame(game, 1, 3, 25, 40, 1);
+    game.enemies.x[0] = game.enemies.previousX[0] = 5.5f * ts;
+    game.enemies.y[0] = game.enemies.previousY[0] = 12.5f * ts;
+    game.enemies.dx[0] = game.enemies.dy[0] = 0;
+    game.playerX = 20;
+    game.playerY = 0;
+
+    int captured = 0;
+    for (int tick = 0; tick < 2000 && game.running && captured == 0; tick++)
+        captured = updateGame(game, 1.0f / defaultTickRate, game.playerY == 0 ? DIR_DOWN : DIR_NONE).capturedCells;
+
+    // The trail (23 cells) and the right half (23 rows of 18 cells) are filled
+    CHECK(game.running);
+    CHECK(captured == 23 + 23 * 18);
+    CHECK(game.board.get(12, 5) == CELL_EMPTY);
+    CHECK(game.board.get(12, 30) == CELL_FILLED);
+}
+
+int main()
+{
+    FloodFillWorkspace work;
+    int captures = 0;
+    for (unsigned int seed = 1; seed <= 30; seed++)
+        captures += checkCaptureModesAgree(seed, work);
+    CHECK(captures > 0);
+    testSplitFillsEmptyHalf();
+    return testResult();
+}
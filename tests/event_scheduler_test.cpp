@@ -0,0 +1,98 @@
+// Timed events have to come out in the order they are due, events due at
+// the same time in the order they were scheduled, and recurring ones again
+// every interval. The game's own events have to fire on the game clock.
+#include "TestSupport.h"
+#include "engine/EventScheduler.h"
+
+static void testDueOrder()
+{
+    EventScheduler events;
+    for (int i = 0; i < 10000; i++)
+        scheduleEvent(events, (i * 7919) % 10007 * 0.01f, i % EVENT_TYPE_COUNT);
+
+    ScheduledEvent event;
+    CHECK(!popDueEvent(events, -1.0f, event));
+    float last = -1.0f;
+    int popped = 0;
+    while (popDueEvent(events, 1e9f, event)) {
+        CHECK(event.time >= last);
+        last = event.time;
+        popped++;
+    }
+    CHECK(popped == 10000 && events.count == 0);
+}
+
+// Ties go to whichever was scheduled first, however the heap happens to be laid out
+static void testTiesKeepScheduleOrder()
+{
+    EventScheduler events;
+    for (int i = 0; i < 100; i++)
+        scheduleEvent(events, i % 2 ? 5.0f : 0.5f + i, EVENT_FREEZE_END);
+    for (int i = 0; i < 50; i++)
+        scheduleEvent(events, 5.0f, EVENT_SPEED_INCREASE);
+
+    ScheduledEvent event;
+    unsigned int lastOrder = 0;
+    int atFive = 0;
+    while (popDueEvent(events, 5.0f, event))
+        if (event.time == 5.0f) {
+            CHECK(atFive == 0 || event.order > lastOrder);
+            CHECK(event.type == (atFive < 50 ? EVENT_FREEZE_END : EVENT_SPEED_INCREASE));
+            lastOrder = event.order;
+            atFive++;
+        }
+    CHECK(atFive == 100);
+}
+
+// A recurring event comes back every interval, and catches up straight away when it fell behind
+static void testRecurringEvents()
+{
+    EventScheduler events;
+    scheduleEvent(events, 2.0f, EVENT_SPEED_INCREASE, 2.0f);
+    scheduleEvent(events, 3.0f, EVENT_FREEZE_END);
+
+    ScheduledEvent event;
+    int fired = 0;
+    while (popDueEvent(events, 9.0f, event))
+        fired += event.type == EVENT_SPEED_INCREASE;
+    CHECK(fired == 4 && events.count == 1 && events.heap[0].time == 10.0f);
+
+    EventScheduler copy;
+    copyEvents(copy, events);
+    clearEvents(events);
+    CHECK(!popDueEvent(events, 100.0f, event));
+    CHECK(popDueEvent(copy, 10.0f, event) && event.type == EVENT_SPEED_INCREASE);
+}
+
+// In a game the pattern switch fires once at 30 seconds and a freeze holds the enemies until it ends
+static void testGameEvents()
+{
+    Game game;
+    startGame(game, 3, 11, 40, 60, 20);
+    int switches = 0;
+    float switchedAt = 0;
+    for (int tick = 0; tick < 40 * 60 && game.running; tick++)
+    {
+        if (tick == 5 * 60)
+            freezeEnemies(game, 1.5f);
+        float x = game.enemies.x[0];
+        TickResult result = updateGame(game, 1.0f / defaultTickRate, DIR_NONE);
+        if (tick > 5 * 60 && tick < 6 * 60)
+            CHECK(game.enemies.x[0] == x && game.freezeEffects == 1);
+        if (result.patternSwitched) {
+            switches++;
+            switchedAt = game.elapsedTime;
+        }
+    }
+    CHECK(game.running && game.freezeEffects == 0);
+    CHECK(switches == 1 && switchedAt >= 30.0f && switchedAt < 30.0f + 1.5f / defaultTickRate);
+}
+
+int main()
+{
+    testDueOrder();
+    testTiesKeepScheduleOrder();
+    testRecurringEvents();
+    testGameEvents();
+    return testResult();
+}
@@ -0,0 +1,85 @@
+// The scanline floodFill() has to mark exactly the cells the recursive
+// drop() it replaced did, on the benchmark shapes and on random boards.
+#include "TestSupport.h"
+#include "bench/BoardShapes.h"
+#include "engine/FloodFill.h"
+
+// The recursive fill as it used to be in the game, see bench/flood_fill_bench.cpp
+static void dropRecursive(int *cells, int cols, int y, int x)
+{
+    if (cells[y * cols + x] == CELL_EMPTY)
+        cells[y * cols + x] = CELL_MARKED;
+    if (cells[(y - 1) * cols + x] == CELL_EMPTY)
+        dropRecursive(cells, cols, y - 1, x);
+    if (cells[(y + 1) * cols + x] == CELL_EMPTY)
+        dropRecursive(cells, cols, y + 1, x);
+    if (cells[y * cols + x - 1] == CELL_EMPTY)
+        dropRecursive(cells, cols, y, x - 1);
+    if (cells[y * cols + x + 1] == CELL_EMPTY)
+        dropRecursive(cells, cols, y, x + 1);
+}
+
+// Open board with the border filled and about a third of the inside filled or trail
+static void makeRandomBoard(int *cells, int rows, int cols, Random &rng)
+{
+    makeOpenBoard(cells, rows, cols);
+    for (int i = 1; i < rows - 1; i++)
+        for (int j = 1; j < cols - 1; j++) {
+            int roll = rng.nextInt(6);
+            if (roll == 0)
+                cells[i * cols + j] = CELL_FILLED;
+            else if (roll == 1)
+                cells[i * cols + j] = CELL_TRAIL;
+        }
+}
+
+// Fills from (y, x) both ways and compares every cell
+static void checkSameFill(const int *original, int rows, int cols, int y, int x, FloodFillWorkspace &work)
+{
+    int *cells = new int[rows * cols];
+    for (int i = 0; i < rows * cols; i++)
+        cells[i] = original[i];
+    Board board;
+    loadBoard(board, original, rows, cols);
+
+    int recursiveMarked = 0;
+    if (cells[y * cols + x] == CELL_EMPTY)
+        dropRecursive(cells, cols, y, x);
+    for (int i = 0; i < rows * cols; i++)
+        if (cells[i] == CELL_MARKED)
+            recursiveMarked++;
+
+    int scanlineMarked = floodFill(board, y, x, work);
+    CHECK(scanlineMarked == recursiveMarked);
+    int differentCells = 0;
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            if ((board.get(i, j) == CELL_MARKED) != (cells[i * cols + j] == CELL_MARKED))
+                differentCells++;
+    CHECK(differentCells == 0);
+    delete[] cells;
+}
+
+int main()
+{
+    FloodFillWorkspace work;
+    const int sizes[][2] = {{25, 40}, {64, 64}, {33, 130}, {128, 96}};
+    int *cells = new int[128 * 130];
+
+    for (const auto &size : sizes)
+        for (int s = 0; s < numOfBoardShapes; s++) {
+            boardShapes[s].build(cells, size[0], size[1]);
+            checkSameFill(cells, size[0], size[1], 1, 1, work);
+            checkSameFill(cells, size[0], size[1], size[0] / 2, size[1] / 2, work);
+        }
+
+    Random rng;
+    for (int round = 0; round < 200; round++) {
+        const auto &size = sizes[round % 4];
+        makeRandomBoard(cells, size[0], size[1], rng);
+        checkSameFill(cells, size[0], size[1], 1 + rng.nextInt(size[0] - 2), 1 + rng.nextInt(size[1] - 2), work);
+    }
+
+    delete[] cells;
+    return testResult();
+}
@@ -0,0 +1,135 @@
+// What the server writes into messages has to read back the same: varints,
+// board deltas as runs of cells, and enemies as corrections to where they
+// were heading. Messages cut short have to fail instead of reading junk.
+#include "TestSupport.h"
+#include "engine/NetProtocol.h"
+#include <cmath>
+#include <cstring>
+
+static void startReadingWriter(MessageReader &reader, const MessageWriter &writer, int length)
+{
+    NetMessage message;
+    message.type = MSG_SNAPSHOT;
+    message.body = writer.data;
+    message.length = length;
+    startReading(reader, message);
+}
+
+static void testVarints()
+{
+    const unsigned int values[] = {0, 1, 127, 128, 300, 16383, 16384, 1u << 31, 0xffffffffu};
+    MessageWriter writer;
+    for (unsigned int value : values)
+        writeVarint(writer, value);
+    CHECK(writer.length == 1 + 1 + 1 + 2 + 2 + 2 + 3 + 5 + 5);
+
+    MessageReader reader;
+    startReadingWriter(reader, writer, writer.length);
+    for (unsigned int value : values)
+        CHECK(readVarint(reader) == value);
+    CHECK(!reader.failed && reader.position == reader.length);
+    CHECK(readVarint(reader) == 0 && reader.failed);
+
+    // More than five bytes can't be a 32 bit value
+    clearMessage(writer);
+    const unsigned char tooLong[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+    writeData(writer, tooLong, sizeof(tooLong));
+    startReadingWriter(reader, writer, writer.length);
+    readVarint(reader);
+    CHECK(reader.failed);
+}
+
+// Random changes on one board have to land on a copy of it through the delta, and only them
+static void testBoardDeltas()
+{
+    Board sent, received;
+    sent.resize(50, 70);
+    initializeGrid(sent);
+    copyBoard(received, sent);
+    memset(sent.dirty, 0, sizeof(uint64_t) * sent.wordCount);
+
+    Random rng;
+    MessageWriter writer;
+    for (int round = 0; round < 50; round++)
+    {
+        // A block like a capture, and a few lone cells like a trail
+        int top = 1 + rng.nextInt(40), left = 1 + rng.nextInt(60);
+        for (int y = top; y < top + 8; y++)
+            for (int x = left; x < left + 8; x++)
+                sent.set(y, x, CELL_FILLED);
+        for (int i = 0; i < 5; i++)
+            sent.set(1 + rng.nextInt(48), 1 + rng.nextInt(68), rng.nextInt(2) ? CELL_TRAIL : CELL_EMPTY);
+
+        clearMessage(writer);
+        writeBoardDelta(writer, sent);
+        for (int w = 0; w < sent.wordCount; w++)
+            CHECK(sent.dirty[w] == 0);
+
+        MessageReader reader;
+        startReadingWriter(reader, writer, writer.length - 1);
+        Board scratch;
+        copyBoard(scratch, received);
+        CHECK(readBoardDelta(reader, scratch) < 0);
+
+        startReadingWriter(reader, writer, writer.length);
+        CHECK(readBoardDelta(reader, received) >= 0 && reader.position == reader.length);
+        CHECK(memcmp(sent.filled, received.filled, sizeof(uint64_t) * sent.wordCount) == 0);
+        CHECK(memcmp(sent.trail, received.trail, sizeof(uint64_t) * sent.wordCount) == 0);
+    }
+}
+
+// Enemies sent every tick of a game have to come out where they are, to an eighth of a pixel
+static void testEnemyDeltas()
+{
+    Game game;
+    startGame(game, 2, 7, 60, 90, 300, 20);
+    EnemyTrack sent, received;
+    EnemyPool enemies;
+    copyEnemies(enemies, game.enemies);
+    startEnemyTrack(sent, game.enemies);
+    startEnemyTrack(received, game.enemies);
+
+    MessageWriter writer;
+    int misplaced = 0, bytes = 0;
+    for (int tick = 0; tick < 2400; tick++)
+    {
+        updateGame(game, 1.0f / defaultTickRate, DIR_NONE);
+        clearMessage(writer);
+        writeEnemyDelta(writer, sent, game.enemies);
+        bytes += writer.length;
+
+        MessageReader reader;
+        startReadingWriter(reader, writer, writer.length);
+        if (!readEnemyDelta(reader, received, &enemies) || reader.position != reader.length) {
+            CHECK(!"enemy delta didn't read back");
+            return;
+        }
+        for (int i = 0; i < game.enemies.count; i++)
+            if (lroundf(game.enemies.x[i] * enemyPositionScale) != lroundf(enemies.x[i] * enemyPositionScale) ||
+                lroundf(game.enemies.y[i] * enemyPositionScale) != lroundf(enemies.y[i] * enemyPositionScale) ||
+                game.enemies.motion[i] != enemies.motion[i])
+                misplaced++;
+    }
+    CHECK(misplaced == 0);
+    CHECK(bytes < 2400 * 9 * game.enemies.count / 4);    // Most enemies go where they were heading
+
+    // A delta for a different number of enemies is refused
+    clearMessage(writer);
+    writeEnemyDelta(writer, sent, game.enemies);
+    EnemyTrack other;
+    EnemyPool fewer;
+    startGame(game, 2, 7, 60, 90, 10);
+    startEnemyTrack(other, game.enemies);
+    copyEnemies(fewer, game.enemies);
+    MessageReader reader;
+    startReadingWriter(reader, writer, writer.length);
+    CHECK(!readEnemyDelta(reader, other, &fewer));
+}
+
+int main()
+{
+    testVarints();
+    testBoardDeltas();
+    testEnemyDeltas();
+    return testResult();
+}
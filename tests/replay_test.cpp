@@ -0,0 +1,98 @@
+// Records games, saves and loads the replays and plays them back: the
+// game played back has to end exactly as the one recorded, down to every
+// byte of its save state.
+#include "TestSupport.h"
+#include "engine/Replay.h"
+#include "engine/SaveState.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+const char *replayPath = "replay_test.xrp";
+
+// Plays a game with the bot and records it, returns how many ticks it ran
+static int recordGame(Game &game, Replay &replay, unsigned int seed, int hunters)
+{
+    startGame(game, 1 + seed % 3, seed, 60, 90, 12, hunters);
+    beginReplay(replay, seed, 1 + seed % 3, 60, 90, game.enemies.count, defaultTickRate, hunters);
+
+    Random botRng;
+    botRng.seed(seed);
+    int tick = 0;
+    for (; tick < 4000 && game.running; tick++) {
+        Direction input = testBotInput(botRng);
+        recordReplayTick(replay, input);
+        updateGame(game, 1.0f / defaultTickRate, input);
+    }
+    return tick;
+}
+
+static bool sameState(const Game &a, const Game &b)
+{
+    SaveState stateA, stateB;
+    captureSaveState(stateA, a);
+    captureSaveState(stateB, b);
+    return stateA.size == stateB.size && memcmp(stateA.data, stateB.data, stateA.size) == 0;
+}
+
+static void testPlaybackMatches(unsigned int seed, int hunters)
+{
+    Game played;
+    Replay recorded;
+    int ticks = recordGame(played, recorded, seed, hunters);
+    CHECK(recorded.tickCount == ticks);
+    CHECK(saveReplay(recorded, replayPath));
+
+    Replay loaded;
+    CHECK(loadReplay(loaded, replayPath));
+    CHECK(loaded.seed == seed && loaded.hunterCount == hunters && loaded.tickCount == ticks);
+    CHECK(loaded.runCount == recorded.runCount && memcmp(loaded.runs, recorded.runs, recorded.runCount) == 0);
+
+    Game replayed;
+    ReplayCursor cursor;
+    startReplayGame(replayed, loaded, cursor);
+    while (!replayFinished(loaded, cursor))
+        updateGame(replayed, 1.0f / loaded.tickRate, nextReplayInput(loaded, cursor));
+    CHECK(cursor.tick == ticks);
+    CHECK(sameState(played, replayed));
+}
+
+// Headers that can't be right are refused before anything is allocated for them
+static void testBadHeadersRejected()
+{
+    Replay recorded;
+    beginReplay(recorded, 7, 2, 25, 40, 4, defaultTickRate);
+    for (int i = 0; i < 500; i++)
+        recordReplayTick(recorded, Direction(i / 40 % 5));
+    CHECK(saveReplay(recorded, replayPath));
+
+    std::ifstream in(replayPath, std::ios::binary);
+    char original[64];
+    int length = int(in.read(original, sizeof(original)).gcount());
+    in.close();
+
+    // Offset and bytes to write there: difficulty, enemy count, run count
+    const struct { int offset; unsigned char bytes[4]; int count; } damage[] = {
+        {6, {9}, 1}, {16, {0xff, 0xff, 0xff, 0x7f}, 4}, {28, {0xff, 0xff, 0xff, 0x7f}, 4}};
+    for (const auto &d : damage) {
+        char bytes[64];
+        memcpy(bytes, original, length);
+        memcpy(bytes + d.offset, d.bytes, d.count);
+        std::ofstream(replayPath, std::ios::binary | std::ios::trunc).write(bytes, length);
+        Replay loaded;
+        CHECK(!loadReplay(loaded, replayPath));
+    }
+
+    std::ofstream(replayPath, std::ios::binary | std::ios::trunc).write(original, 20);
+    Replay truncated;
+    CHECK(!loadReplay(truncated, replayPath));
+}
+
+int main()
+{
+    for (unsigned int seed = 1; seed <= 12; seed++)
+        testPlaybackMatches(seed, seed % 4);
+    testBadHeadersRejected();
+    remove(replayPath);
+    return testResult();
+}
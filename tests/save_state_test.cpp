@@ -0,0 +1,110 @@
+// A game restored from a save state, in memory or from a file, has to go
+// on exactly as the original does, and files that are cut short, damaged
+// or hold impossible enemies have to be refused.
+#include "TestSupport.h"
+#include "engine/SaveState.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+const char *statePath = "save_state_test.xsav";
+
+static bool sameState(const Game &a, const Game &b)
+{
+    SaveState stateA, stateB;
+    captureSaveState(stateA, a);
+    captureSaveState(stateB, b);
+    return stateA.size == stateB.size && memcmp(stateA.data, stateB.data, stateA.size) == 0;
+}
+
+// Saves mid-game, with a freeze running, and plays the original, a copy and both restores on together
+static void testRestoredGameCarriesOn(unsigned int seed)
+{
+    Game game;
+    startGame(game, 1 + seed % 3, seed, 40, 60, 10, seed % 3);
+    Random botRng;
+    botRng.seed(seed);
+    for (int tick = 0; tick < 1000 && game.running; tick++) {
+        if (tick == 900)
+            freezeEnemies(game, 2.0f);
+        updateGame(game, 1.0f / defaultTickRate, testBotInput(botRng));
+    }
+
+    SaveState state;
+    captureSaveState(state, game);
+    CHECK(writeSaveState(state, statePath));
+
+    Game copy, restored, loaded;
+    copyGame(copy, game);
+    startGame(restored, 3, seed + 100);    // Restoring has to replace everything a different game left
+    CHECK(restoreSaveState(restored, state));
+    SaveState opened;
+    CHECK(openSaveState(opened, statePath));
+    CHECK(restoreSaveState(loaded, opened));
+    closeSaveState(opened);
+
+    for (int tick = 0; tick < 2000 && game.running; tick++)
+    {
+        Direction input = testBotInput(botRng);
+        updateGame(game, 1.0f / defaultTickRate, input);
+        updateGame(copy, 1.0f / defaultTickRate, input);
+        updateGame(restored, 1.0f / defaultTickRate, input);
+        updateGame(loaded, 1.0f / defaultTickRate, input);
+        if (tick % 50 == 0 && !(sameState(game, copy) && sameState(game, restored) && sameState(game, loaded))) {
+            CHECK(!"restored game went its own way");
+            return;
+        }
+    }
+    CHECK(sameState(game, copy) && sameState(game, restored) && sameState(game, loaded));
+}
+
+static bool opensFile(const char *bytes, size_t length)
+{
+    std::ofstream(statePath, std::ios::binary | std::ios::trunc).write(bytes, length);
+    SaveState state;
+    return openSaveState(state, statePath);
+}
+
+static void testDamagedFilesRefused()
+{
+    Game game;
+    startGame(game, 2, 5);
+    for (int tick = 0; tick < 100; tick++)
+        updateGame(game, 1.0f / defaultTickRate, DIR_DOWN);
+
+    SaveState state;
+    captureSaveState(state, game);
+    char *bytes = new char[state.size];
+    memcpy(bytes, state.data, state.size);
+    CHECK(opensFile(bytes, state.size));
+
+    CHECK(!opensFile(bytes, state.size - 1));
+    CHECK(!opensFile(bytes, saveStateHeaderSize / 2));
+    bytes[0] = 'Y';
+    CHECK(!opensFile(bytes, state.size));
+    bytes[0] = state.data[0];
+    bytes[4] = char(saveStateVersion + 1);
+    CHECK(!opensFile(bytes, state.size));
+    bytes[4] = state.data[4];
+
+    // Enemies nowhere on the board
+    const float badPositions[] = {NAN, -5.0f, 1e7f};
+    for (float x : badPositions) {
+        float saved = game.enemies.x[0];
+        game.enemies.x[0] = x;
+        captureSaveState(state, game);
+        CHECK(!opensFile((const char *)state.data, state.size));
+        game.enemies.x[0] = saved;
+    }
+    delete[] bytes;
+}
+
+int main()
+{
+    for (unsigned int seed = 1; seed <= 10; seed++)
+        testRestoredGameCarriesOn(seed);
+    testDamagedFilesRefused();
+    remove(statePath);
+    return testResult();
+}
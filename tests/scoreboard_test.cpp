@@ -0,0 +1,104 @@
+// Scores have to survive closing and opening the board again, and every
+// way a crash can leave the file (a torn header, a torn record, a record
+// with a bad checksum) has to be recovered from without losing the rest.
+#include "TestSupport.h"
+#include "engine/Scoreboard.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+const char *scoreboardPath = "scoreboard_test.xsb";
+const char *badScoreboardPath = "scoreboard_test.xsb.bad";
+const int headerSize = 16;
+const int recordSize = 32;
+
+static ScoreRecord scoreOf(int score, int difficultyLevel)
+{
+    ScoreRecord record = {score, 10, 30.0f + score, difficultyLevel, 7, 1700000000 + score};
+    return record;
+}
+
+static void writeBytes(const char *bytes, int length, std::ios::openmode mode)
+{
+    std::ofstream(scoreboardPath, std::ios::binary | mode).write(bytes, length);
+}
+
+// Twelve games on difficulty 1 and one on 2, the best ten of the first are kept in order
+static void testScoresReload()
+{
+    {
+        Scoreboard board;
+        CHECK(openScoreboard(board, scoreboardPath));
+        CHECK(board.recordCount == 0 && !board.movedBadFile);
+        for (int i = 0; i < 12; i++)
+            addScore(board, scoreOf(100 + (i * 7) % 12, 1));
+        CHECK(addScore(board, scoreOf(5, 2)) == 0);
+    }
+
+    Scoreboard board;
+    CHECK(openScoreboard(board, scoreboardPath));
+    CHECK(board.recordCount == 13 && board.corruptRecords == 0);
+    ScoreRecord top[topScoreCount];
+    CHECK(topScores(board, 1, top) == topScoreCount);
+    for (int i = 0; i < topScoreCount; i++)
+        CHECK(top[i].score == 111 - i);
+    CHECK(topScores(board, 2, top) == 1 && top[0].score == 5);
+    CHECK(addScore(board, scoreOf(1, 1)) == -1);
+}
+
+// A record with a bad checksum is skipped, one cut short is trimmed before anything is appended
+static void testDamagedRecordsSkipped()
+{
+    std::fstream file(scoreboardPath, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(headerSize + 2 * recordSize + 5);
+    file.put('\x7f');
+    file.close();
+    writeBytes("torn", 4, std::ios::app);
+
+    {
+        Scoreboard board;
+        CHECK(openScoreboard(board, scoreboardPath));
+        CHECK(board.recordCount == 13 && board.corruptRecords == 1);
+        CHECK(std::filesystem::file_size(scoreboardPath) == size_t(headerSize + 14 * recordSize));
+        addScore(board, scoreOf(200, 3));
+    }
+
+    Scoreboard board;
+    CHECK(openScoreboard(board, scoreboardPath));
+    CHECK(board.recordCount == 14 && board.corruptRecords == 1);
+    ScoreRecord top[topScoreCount];
+    CHECK(topScores(board, 3, top) == 1 && top[0].score == 200);
+}
+
+// A file whose header is torn or isn't a scoreboard is moved aside once and a new one started
+static void testBadFilesMovedAside()
+{
+    const char *damaged[] = {"XSCB\1\0", "NOPE\1\0\40\0\0\0\0\0\0\0\0\0"};
+    const int lengths[] = {6, 16};
+    for (int d = 0; d < 2; d++)
+    {
+        remove(badScoreboardPath);
+        writeBytes(damaged[d], lengths[d], std::ios::trunc);
+        {
+            Scoreboard board;
+            CHECK(openScoreboard(board, scoreboardPath));
+            CHECK(board.movedBadFile && board.recordCount == 0);
+            CHECK(std::filesystem::file_size(badScoreboardPath) == size_t(lengths[d]));
+            addScore(board, scoreOf(42, 1));
+        }
+        Scoreboard board;
+        CHECK(openScoreboard(board, scoreboardPath));
+        CHECK(!board.movedBadFile && board.recordCount == 1);
+    }
+}
+
+int main()
+{
+    remove(scoreboardPath);
+    testScoresReload();
+    testDamagedRecordsSkipped();
+    testBadFilesMovedAside();
+    remove(scoreboardPath);
+    remove(badScoreboardPath);
+    return testResult();
+}
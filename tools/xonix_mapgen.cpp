@@ -0,0 +1,110 @@
+// Writes a big map for xonix --big-map: the edge of the world plus blocks
+// of filled cells scattered over it, chunk by chunk, so even a map far
+// bigger than memory is made in one pass over the file.
+#include "engine/BigMap.h"
+#include "engine/Random.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+struct MapgenOptions
+{
+    const char *path = 0;
+    int rows = 4096;            // In cells, rounded up to whole chunks
+    int cols = 4096;
+    unsigned int seed = 1;
+    int density = 20;           // Percent of chunks that get a block
+};
+
+static void printUsage()
+{
+    cout << "Usage: xonix_mapgen FILE [--rows N] [--cols N] [--seed S] [--density 0-100]" << endl;
+}
+
+static bool parseOptions(int argc, char **argv, MapgenOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (arg[0] != '-' && !options.path) {
+            options.path = arg;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || i + 1 >= argc)
+            return false;
+
+        const char *value = argv[++i];
+        if (strcmp(arg, "--rows") == 0) options.rows = atoi(value);
+        else if (strcmp(arg, "--cols") == 0) options.cols = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) options.seed = strtoul(value, 0, 10);
+        else if (strcmp(arg, "--density") == 0) options.density = atoi(value);
+        else return false;
+    }
+    return options.path && options.rows > 0 && options.cols > 0 &&
+           options.density >= 0 && options.density <= 100;
+}
+
+// Fills a rectangle of 4 to 24 cells a side somewhere inside the chunk
+static void addBlock(uint64_t *chunk, Random &rng)
+{
+    int height = 4 + rng.nextInt(21);
+    int width = 4 + rng.nextInt(21);
+    int top = 1 + rng.nextInt(mapChunkSize - 1 - height);
+    int left = 1 + rng.nextInt(mapChunkSize - 1 - width);
+    uint64_t row = ((uint64_t(1) << width) - 1) << left;
+    for (int r = top; r < top + height; r++)
+        chunk[r] |= row;
+}
+
+int main(int argc, char **argv)
+{
+    MapgenOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    int chunkRows = (options.rows + mapChunkSize - 1) / mapChunkSize;
+    int chunkCols = (options.cols + mapChunkSize - 1) / mapChunkSize;
+    if (chunkRows < sectorChunks) chunkRows = sectorChunks;
+    if (chunkCols < sectorChunks) chunkCols = sectorChunks;
+    if (chunkRows > maxMapChunks || chunkCols > maxMapChunks) {
+        cout << "Error: A map can be at most " << maxMapChunks * mapChunkSize << " cells a side" << endl;
+        return 1;
+    }
+
+    auto startTime = chrono::steady_clock::now();
+    BigMap map;
+    if (!createBigMap(options.path, chunkRows, chunkCols) || !openBigMap(map, options.path)) {
+        cout << "Error: Unable to write " << options.path << endl;
+        return 1;
+    }
+
+    // The first chunk is left open so the player always has somewhere to start
+    Random rng;
+    rng.seed(options.seed);
+    long long blocks = 0;
+    for (int cy = 0; cy < chunkRows; cy++)
+        for (int cx = 0; cx < chunkCols; cx++) {
+            if (rng.nextInt(100) >= options.density || (cy == 0 && cx == 0))
+                continue;
+            addBlock(mapChunk(map, cy, cx), rng);
+            blocks++;
+        }
+
+    size_t size = map.size;
+    if (!closeBigMap(map)) {
+        cout << "Error: Unable to write " << options.path << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    cout << "map:        " << chunkRows * mapChunkSize << "x" << chunkCols * mapChunkSize << " cells ("
+         << chunkRows << "x" << chunkCols << " chunks)" << endl;
+    cout << "blocks:     " << blocks << endl;
+    cout << "file size:  " << size / (1024.0 * 1024.0) << " MiB" << endl;
+    cout << "wall time:  " << seconds << " s" << endl;
+    return 0;
+}
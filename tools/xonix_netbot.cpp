@@ -0,0 +1,101 @@
+// Headless network player: joins a match on xonix_server, plays it with the
+// random bot from xonix_sim through client-side prediction and reports
+// latency, rollbacks and bandwidth. Run one per seat of a local server to
+// test a match over loopback.
+#include "engine/NetMatch.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+using namespace std;
+
+struct BotOptions
+{
+    const char *host = "127.0.0.1";
+    int port = defaultNetPort;
+    unsigned int seed = 1;       // The bot's own choices, the game's seed comes from the server
+    float maxSeconds = 600;
+};
+
+static void printUsage()
+{
+    cout << "Usage: xonix_netbot [--connect HOST] [--port N] [--seed S] [--max-seconds S]" << endl;
+}
+
+static bool parseOptions(int argc, char **argv, BotOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || i + 1 >= argc)
+            return false;
+
+        const char *value = argv[++i];
+        if (strcmp(arg, "--connect") == 0) options.host = value;
+        else if (strcmp(arg, "--port") == 0) options.port = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) options.seed = strtoul(value, 0, 10);
+        else if (strcmp(arg, "--max-seconds") == 0) options.maxSeconds = float(atof(value));
+        else return false;
+    }
+    return options.port > 0 && options.port < 65536 && options.maxSeconds > 0;
+}
+
+// Same bot as xonix_sim: keeps its direction for a few steps and then picks a new one
+static Direction chooseDirection(Random &botRng)
+{
+    if (botRng.nextInt(8) != 0)
+        return DIR_NONE;
+    return Direction(DIR_LEFT + botRng.nextInt(4));
+}
+
+int main(int argc, char **argv)
+{
+    BotOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    NetClient client;
+    if (!connectNetClient(client, options.host, options.port)) {
+        cout << "Error: Unable to connect to " << options.host << ":" << options.port << endl;
+        return 1;
+    }
+
+    Random botRng;
+    botRng.seed(options.seed ^ 0x5bd1e995u);
+    SimulationClock clock;
+    bool clockStarted = false;
+    auto startTime = chrono::steady_clock::now();
+    auto lastFrame = startTime;
+
+    while (pollNetClient(client))
+    {
+        auto now = chrono::steady_clock::now();
+        if (chrono::duration<double>(now - startTime).count() > options.maxSeconds)
+            break;
+
+        if (client.state == NET_PLAYING)
+        {
+            if (!clockStarted) {
+                resetSimulationClock(clock, client.config.tickRate);
+                lastFrame = now;
+                clockStarted = true;
+            }
+            int ticks = advanceSimulationClock(clock, chrono::duration<float>(now - lastFrame).count());
+            lastFrame = now;
+
+            ticks = adjustClientTicks(client, ticks);
+            for (int t = 0; t < ticks; t++)
+                stepNetClient(client, chooseDirection(botRng));
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    if (client.state == NET_DISCONNECTED)
+        cout << "Lost the connection to the server" << endl;
+    writeNetClientReport(client, seconds, cout);
+    return client.state == NET_FINISHED ? 0 : 1;
+}
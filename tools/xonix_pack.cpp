@@ -0,0 +1,89 @@
+// Packs the game's images into one atlas and writes it to a bundle together
+// with the font, so the game starts from one memory-mapped file instead of
+// decoding loose PNGs. Run from the source directory:
+//   xonix_pack assets.xpk
+#include "engine/AssetBundle.h"
+#include "render/Assets.h"
+#include <fstream>
+#include <iostream>
+using namespace sf;
+using namespace std;
+
+// Reads a whole file into a new buffer, returns 0 if it can't be read
+static unsigned char *readFile(const char *path, unsigned int &size)
+{
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file)
+        return 0;
+    size = (unsigned int)file.tellg();
+    unsigned char *data = new unsigned char[size];
+    file.seekg(0);
+    if (!file.read((char *)data, size)) {
+        delete[] data;
+        return 0;
+    }
+    return data;
+}
+
+static void setEntry(AssetEntry &entry, const char *name, AssetType type, unsigned int size, const IntRect &rect)
+{
+    int length = 0;
+    for (; name[length] != '\0' && length < maxAssetNameLength; length++)
+        entry.name[length] = name[length];
+    entry.name[length] = '\0';
+    entry.type = type;
+    entry.size = size;
+    entry.x = rect.left;
+    entry.y = rect.top;
+    entry.width = rect.width;
+    entry.height = rect.height;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        cout << "Usage: xonix_pack OUTPUT" << endl;
+        return -1;
+    }
+
+    Image images[ATLAS_IMAGE_COUNT];
+    if (!loadLooseImages(images)) {
+        cout << "Error: Unable to load the images from images/" << endl;
+        return -1;
+    }
+    Image atlas;
+    IntRect rects[ATLAS_IMAGE_COUNT];
+    packAtlas(images, ATLAS_IMAGE_COUNT, atlas, rects);
+    Vector2u atlasSize = atlas.getSize();
+
+    unsigned int fontSize = 0;
+    unsigned char *font = readFile(gameFontPath, fontSize);
+    if (!font) {
+        cout << "Error: Unable to read " << gameFontPath << endl;
+        return -1;
+    }
+
+    // The atlas pixels, a region for every image in it, then the font
+    const int entryCount = ATLAS_IMAGE_COUNT + 2;
+    AssetEntry entries[entryCount];
+    const unsigned char *data[entryCount];
+    setEntry(entries[0], "atlas", ASSET_PIXELS, atlasSize.x * atlasSize.y * 4, IntRect(0, 0, atlasSize.x, atlasSize.y));
+    data[0] = atlas.getPixelsPtr();
+    for (int i = 0; i < ATLAS_IMAGE_COUNT; i++) {
+        setEntry(entries[i + 1], atlasImageNames[i], ASSET_REGION, 0, rects[i]);
+        data[i + 1] = 0;
+    }
+    setEntry(entries[entryCount - 1], "font", ASSET_FILE, fontSize, IntRect(0, 0, 0, 0));
+    data[entryCount - 1] = font;
+
+    bool written = writeAssetBundle(argv[1], entries, data, entryCount);
+    delete[] font;
+    if (!written) {
+        cout << "Error: Unable to write " << argv[1] << endl;
+        return -1;
+    }
+
+    cout << "Packed " << ATLAS_IMAGE_COUNT << " images into a " << atlasSize.x << "x" << atlasSize.y
+         << " atlas and " << gameFontPath << " into " << argv[1] << endl;
+    return 0;
+}
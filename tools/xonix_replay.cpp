@@ -0,0 +1,190 @@
+// Plays a recorded game back without a window as fast as the engine goes,
+// timing every tick, so a slow frame or odd capture a player ran into can
+// be reproduced and profiled. Replays come from xonix --record or
+// xonix_sim --record. --save-state keeps the game as it stood at one tick
+// so it can be resumed from there with F9 in the game.
+#include "engine/FrameProfiler.h"
+#include "engine/Game.h"
+#include "engine/Replay.h"
+#include "engine/SaveState.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+struct ReplayOptions
+{
+    const char *path = 0;
+    int slowest = 5;              // How many of the slowest ticks to list
+    const char *csvPath = 0;      // Per-tick phase timings
+    const char *statePath = 0;    // Save state written at saveTick
+    int saveTick = -1;            // -1 saves the game where the replay stopped
+};
+
+// A tick and how long it took, kept in a small list sorted slowest first
+struct SlowTick
+{
+    int tick;
+    float ms;
+};
+
+static void printUsage()
+{
+    cout << "Usage: xonix_replay FILE [--slowest N] [--profile-csv FILE] [--save-state FILE] [--save-at TICK]" << endl;
+}
+
+static bool parseOptions(int argc, char **argv, ReplayOptions &options)
+{
+    if (argc < 2 || argc % 2 != 0)
+        return false;
+    options.path = argv[1];
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--slowest") == 0) options.slowest = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--profile-csv") == 0) options.csvPath = argv[i + 1];
+        else if (strcmp(argv[i], "--save-state") == 0) options.statePath = argv[i + 1];
+        else if (strcmp(argv[i], "--save-at") == 0) options.saveTick = atoi(argv[i + 1]);
+        else return false;
+    }
+    return options.slowest >= 0 && options.saveTick >= -1;
+}
+
+static void rememberIfSlow(SlowTick *slowest, int count, int tick, float ms)
+{
+    if (count == 0 || ms <= slowest[count - 1].ms)
+        return;
+
+    int i = count - 1;
+    for (; i > 0 && slowest[i - 1].ms < ms; i--)
+        slowest[i] = slowest[i - 1];
+    slowest[i].tick = tick;
+    slowest[i].ms = ms;
+}
+
+// Takes a save state of the game, returns how long it took in microseconds
+static double timedCapture(SaveState &state, const Game &game)
+{
+    auto start = chrono::steady_clock::now();
+    captureSaveState(state, game);
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    ReplayOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    Replay replay;
+    if (!loadReplay(replay, options.path)) {
+        cout << "Error: " << options.path << " is not a valid replay" << endl;
+        return 1;
+    }
+
+    Game game;
+    ReplayCursor cursor;
+    FrameProfiler profiler;
+    resetFrameProfiler(profiler, replay.tickCount > 0 ? replay.tickCount : 1);    // Keep every tick
+
+    SlowTick *slowest = new SlowTick[options.slowest > 0 ? options.slowest : 1];
+    for (int i = 0; i < options.slowest; i++)
+        slowest[i] = {-1, -1.0f};
+
+    SaveState state;
+    bool stateSaved = false;
+    double captureUs = 0;
+
+    long long captures = 0, capturedCells = 0;
+    int gameOverTick = -1;
+    float dt = 1.0f / replay.tickRate;
+
+    auto startTime = chrono::steady_clock::now();
+    startReplayGame(game, replay, cursor);
+    while (!replayFinished(replay, cursor))
+    {
+        if (options.statePath && cursor.tick == options.saveTick) {
+            captureUs = timedCapture(state, game);
+            stateSaved = true;
+        }
+
+        // Each tick is one profiler frame
+        beginProfiledFrame(profiler);
+        int tick = cursor.tick;
+        TickResult result = updateGame(game, dt, nextReplayInput(replay, cursor), &profiler);
+        endProfiledFrame(profiler);
+        rememberIfSlow(slowest, options.slowest, tick, profiler.samples[(tick % profiler.capacity) * (PHASE_COUNT + 1) + PHASE_COUNT]);
+
+        if (result.captured) {
+            captures++;
+            capturedCells += result.capturedCells;
+        }
+        if (result.gameOver) {
+            gameOverTick = tick;
+            break;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    if (options.statePath && options.saveTick < 0) {
+        captureUs = timedCapture(state, game);
+        stateSaved = true;
+    }
+
+    int filledCells = 0;
+    for (int i = 0; i < game.board.rows; i++)
+        for (int j = 0; j < game.board.cols; j++)
+            if (game.board.isFilled(i, j))
+                filledCells++;
+
+    cout << "replay:         " << options.path << endl;
+    cout << "seed:           " << replay.seed << " (difficulty " << replay.difficultyLevel << ", "
+         << replay.enemyCount << " enemies, " << replay.hunterCount << " hunting)" << endl;
+    cout << "board:          " << replay.rows << "x" << replay.cols << " at " << replay.tickRate << " ticks/s" << endl;
+    cout << "ticks:          " << cursor.tick << " of " << replay.tickCount << endl;
+    cout << "game over:      " << (gameOverTick >= 0 ? "tick " + to_string(gameOverTick) : string("no")) << endl;
+    cout << "moves:          " << game.moveCounter << endl;
+    cout << "captures:       " << captures << " (" << capturedCells << " cells)" << endl;
+    cout << "filled:         " << filledCells << " cells" << endl;
+    cout << "wall time:      " << seconds << " s" << endl;
+    cout << "ticks/sec:      " << (seconds > 0 ? cursor.tick / seconds : 0) << endl;
+
+    cout << endl << "phase          p50 ms     p99 ms" << endl;
+    for (int p = 0; p <= PHASE_COUNT; p++)
+    {
+        if (p == PHASE_EVENTS || p == PHASE_HUD || p == PHASE_RENDER || p == PHASE_PRESENT)
+            continue;    // Window phases, not run here
+        cout << phaseNames[p];
+        for (int pad = int(strlen(phaseNames[p])); pad < 13; pad++)
+            cout << ' ';
+        cout << phasePercentile(profiler, p, 50) << "\t" << phasePercentile(profiler, p, 99) << endl;
+    }
+
+    if (options.slowest > 0)
+        cout << endl << "slowest ticks:" << endl;
+    for (int i = 0; i < options.slowest && slowest[i].tick >= 0; i++)
+        cout << "  tick " << slowest[i].tick << "\t" << slowest[i].ms << " ms" << endl;
+    delete[] slowest;
+
+    if (options.statePath)
+    {
+        if (!stateSaved) {
+            cout << "Error: The replay ended before tick " << options.saveTick << ", no save state written" << endl;
+            return 1;
+        }
+        if (!writeSaveState(state, options.statePath)) {
+            cout << "Error: Unable to write the save state to " << options.statePath << endl;
+            return 1;
+        }
+        cout << endl << "save state:     " << options.statePath << " (" << state.size << " bytes, captured in "
+             << captureUs << " us)" << endl;
+    }
+
+    if (options.csvPath && !writeProfileCsv(profiler, options.csvPath)) {
+        cout << "Error: Unable to write tick timings to " << options.csvPath << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Authoritative server for network matches: waits for the players, runs
+// every player's game at the tick rate with the input they send, and streams
+// snapshots back. Test it over loopback with two headless bots:
+//   xonix_server --players 2 &
+//   xonix_netbot --connect 127.0.0.1 & xonix_netbot --connect 127.0.0.1
+#include "engine/NetMatch.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+using namespace std;
+
+struct ServerOptions
+{
+    NetMatchConfig match;
+    int port = defaultNetPort;
+    float maxSeconds = 600;      // The match is stopped after this long even if someone is still playing
+};
+
+static void printUsage()
+{
+    cout << "Usage: xonix_server [--port N] [--players 1-" << maxNetPlayers << "] [--seed S] [--difficulty 1-3]"
+         << " [--rows N] [--cols N] [--enemies N] [--tick-rate HZ] [--snapshot-every TICKS] [--max-seconds S]" << endl;
+}
+
+static bool parseOptions(int argc, char **argv, ServerOptions &options)
+{
+    NetMatchConfig &match = options.match;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || i + 1 >= argc)
+            return false;
+
+        const char *value = argv[++i];
+        if (strcmp(arg, "--port") == 0) options.port = atoi(value);
+        else if (strcmp(arg, "--players") == 0) match.playerCount = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) match.seed = strtoul(value, 0, 10);
+        else if (strcmp(arg, "--difficulty") == 0) match.difficultyLevel = atoi(value);
+        else if (strcmp(arg, "--rows") == 0) match.rows = atoi(value);
+        else if (strcmp(arg, "--cols") == 0) match.cols = atoi(value);
+        else if (strcmp(arg, "--enemies") == 0) match.enemyCount = atoi(value);
+        else if (strcmp(arg, "--tick-rate") == 0) match.tickRate = float(atof(value));
+        else if (strcmp(arg, "--snapshot-every") == 0) match.snapshotInterval = atoi(value);
+        else if (strcmp(arg, "--max-seconds") == 0) options.maxSeconds = float(atof(value));
+        else return false;
+    }
+    return options.port > 0 && options.port < 65536 && options.maxSeconds > 0;
+}
+
+int main(int argc, char **argv)
+{
+    ServerOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    NetServer server;
+    if (!startNetServer(server, options.match, options.port)) {
+        cout << "Error: Unable to serve on port " << options.port << " with these settings" << endl;
+        return 1;
+    }
+    cout << "Waiting for " << options.match.playerCount << " players on port " << options.port << endl;
+    while (!acceptNetPlayers(server))
+        this_thread::sleep_for(chrono::milliseconds(1));
+    cout << "Match started, seed " << server.config.seed << ", " << server.config.enemyCount << " enemies" << endl;
+
+    // Ticks are paced against the start time so they don't drift
+    chrono::steady_clock::duration tickDuration = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(1.0 / server.config.tickRate));
+    auto startTime = chrono::steady_clock::now();
+    auto nextTick = startTime;
+    unsigned int maxTicks = (unsigned int)(options.maxSeconds * server.config.tickRate);
+
+    while (!netMatchOver(server) && server.tick < maxTicks)
+    {
+        pollNetServer(server);
+        auto now = chrono::steady_clock::now();
+        if (now >= nextTick) {
+            tickNetServer(server);
+            nextTick += tickDuration;
+        }
+        else
+            this_thread::sleep_for(chrono::microseconds(500));
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    endNetServer(server);
+    writeNetServerReport(server, seconds, cout);
+    return 0;
+}
@@ -0,0 +1,222 @@
+// Headless batch simulator: plays many seeded games with a random bot on every
+// core and reports how fast the engine runs without a window in the way.
+#include "engine/Game.h"
+#include "engine/Replay.h"
+#include "engine/SimulationClock.h"
+#include "engine/TelemetryLog.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+using namespace std;
+
+struct SimOptions
+{
+    int games = 1000;
+    int threads = 0;            // 0 picks one thread per core
+    unsigned int seed = 1;
+    int difficulty = 1;
+    int rows = defaultRows;
+    int cols = defaultCols;
+    int enemies = 0;            // 0 uses the difficulty's enemy count
+    int hunters = 0;            // How many of the enemies chase the trail
+    int maxTicks = 60 * 60 * 5; // Five minutes of play at 60 ticks per second
+    float tickRate = defaultTickRate;
+    bool fullCapture = false;   // Use the whole-board capture instead of region tracking
+    const char *recordPath = 0; // Save the first game (the one played with --seed) as a replay
+    const char *telemetryPath = 0;    // Append the stats of every game as JSON lines
+};
+
+// Totals gathered by one worker thread, summed up at the end
+struct SimTotals
+{
+    long long ticks = 0;
+    long long captures = 0;
+    long long capturedCells = 0;
+    long long filledCells = 0;
+    long long enemyMoves = 0;
+    long long nearMisses = 0;
+    int games = 0;
+    int gameOvers = 0;
+};
+
+static void printUsage()
+{
+    cout << "Usage: xonix_sim [--games N] [--threads N] [--seed S] [--difficulty 1-3]"
+         << " [--rows N] [--cols N] [--enemies N] [--hunters N] [--max-ticks N] [--tick-rate HZ] [--full-capture] [--record FILE] [--telemetry FILE]" << endl;
+}
+
+static bool parseOptions(int argc, char **argv, SimOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--full-capture") == 0) {
+            options.fullCapture = true;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || i + 1 >= argc)
+            return false;
+
+        const char *value = argv[++i];
+        if (strcmp(arg, "--games") == 0) options.games = atoi(value);
+        else if (strcmp(arg, "--threads") == 0) options.threads = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) options.seed = strtoul(value, 0, 10);
+        else if (strcmp(arg, "--difficulty") == 0) options.difficulty = atoi(value);
+        else if (strcmp(arg, "--rows") == 0) options.rows = atoi(value);
+        else if (strcmp(arg, "--cols") == 0) options.cols = atoi(value);
+        else if (strcmp(arg, "--enemies") == 0) options.enemies = atoi(value);
+        else if (strcmp(arg, "--hunters") == 0) options.hunters = atoi(value);
+        else if (strcmp(arg, "--max-ticks") == 0) options.maxTicks = atoi(value);
+        else if (strcmp(arg, "--tick-rate") == 0) options.tickRate = float(atof(value));
+        else if (strcmp(arg, "--record") == 0) options.recordPath = value;
+        else if (strcmp(arg, "--telemetry") == 0) options.telemetryPath = value;
+        else return false;
+    }
+    return options.games > 0 && options.enemies >= 0 && options.enemies <= maxEnemyCount && options.hunters >= 0 &&
+           options.hunters <= maxReplayHunters && options.maxTicks > 0 && options.tickRate > 0 &&
+           isValidBoardSize(options.rows, options.cols);
+}
+
+/**
+ * Random bot: keeps its direction for a few steps and then picks a new one.
+ * It uses its own generator so the game's random numbers stay untouched.
+ */
+static Direction chooseDirection(Random &botRng)
+{
+    if (botRng.nextInt(8) != 0)
+        return DIR_NONE;
+    return Direction(DIR_LEFT + botRng.nextInt(4));
+}
+
+static void playGame(const SimOptions &options, unsigned int seed, SimTotals &totals, Replay *replay,
+                     TelemetryLog &telemetry, int gameNumber)
+{
+    Game game;
+    startGame(game, options.difficulty, seed, options.rows, options.cols, options.enemies, options.hunters);
+    if (replay)
+        beginReplay(*replay, seed, options.difficulty, options.rows, options.cols, game.enemies.count, options.tickRate,
+                    hunterCount(game.enemies));
+    if (options.fullCapture)
+        game.captureMode = CAPTURE_FULL_BOARD;
+
+    Random botRng;
+    botRng.seed(seed ^ 0x5bd1e995u);
+
+    // The session is the first seed, so the lines of one run can be told apart in a shared file
+    logGameEvent(telemetry, "start", options.seed, gameNumber, game);
+    float nextSampleTime = telemetrySampleInterval;
+
+    float dt = 1.0f / options.tickRate;
+    int tick = 0;
+    while (tick < options.maxTicks)
+    {
+        Direction input = chooseDirection(botRng);
+        if (replay)
+            recordReplayTick(*replay, input);
+        TickResult result = updateGame(game, dt, input);
+        tick++;
+        logTickEvents(telemetry, options.seed, gameNumber, game, result, nextSampleTime);
+
+        if (result.captured) {
+            totals.captures++;
+            totals.capturedCells += result.capturedCells;
+        }
+        if (result.gameOver) {
+            totals.gameOvers++;
+            break;
+        }
+    }
+
+    // A game cut off by --max-ticks gets a closing line too, as the game logs one for a game left running
+    if (game.running)
+        logGameEvent(telemetry, "leave", options.seed, gameNumber, game);
+
+    totals.filledCells += game.stats.filledCells;
+    totals.nearMisses += game.stats.nearMisses;
+
+    totals.ticks += tick;
+    totals.enemyMoves += (long long)tick * game.enemies.count;
+    totals.games++;
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    int threadCount = options.threads;
+    if (threadCount <= 0)
+        threadCount = int(thread::hardware_concurrency());
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    SimTotals *totals = new SimTotals[threadCount];
+    thread *workers = new thread[threadCount];
+    atomic<int> nextGame(0);
+    Replay replay;
+    Replay *firstReplay = options.recordPath ? &replay : 0;
+    TelemetryLog telemetry;
+    // Blocking, so the games wait on the disk rather than lose lines of the data they are run for
+    if (options.telemetryPath && !openTelemetryLog(telemetry, options.telemetryPath, true)) {
+        cout << "Error: Unable to open " << options.telemetryPath << endl;
+        return 1;
+    }
+
+    auto startTime = chrono::steady_clock::now();
+
+    // Games are handed out one at a time so a few long games don't leave other cores idle
+    for (int t = 0; t < threadCount; t++)
+    {
+        workers[t] = thread([&options, &nextGame, totals, t, firstReplay, &telemetry]() {
+            for (int g = nextGame++; g < options.games; g = nextGame++)
+                playGame(options, options.seed + unsigned(g), totals[t], g == 0 ? firstReplay : 0, telemetry, g);
+        });
+    }
+    for (int t = 0; t < threadCount; t++)
+        workers[t].join();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    SimTotals sum;
+    for (int t = 0; t < threadCount; t++)
+    {
+        sum.ticks += totals[t].ticks;
+        sum.captures += totals[t].captures;
+        sum.capturedCells += totals[t].capturedCells;
+        sum.filledCells += totals[t].filledCells;
+        sum.enemyMoves += totals[t].enemyMoves;
+        sum.nearMisses += totals[t].nearMisses;
+        sum.games += totals[t].games;
+        sum.gameOvers += totals[t].gameOvers;
+    }
+
+    delete[] workers;
+    delete[] totals;
+
+    if (options.recordPath && !saveReplay(replay, options.recordPath))
+        cout << "Error: Unable to write the replay to " << options.recordPath << endl;
+    closeTelemetryLog(telemetry);
+    if (telemetry.writeFailed)
+        cout << "Error: Some telemetry could not be written to " << options.telemetryPath << endl;
+
+    cout << "games:          " << sum.games << " (" << sum.gameOvers << " ended by collision)" << endl;
+    cout << "threads:        " << threadCount << endl;
+    cout << "board:          " << options.rows << "x" << options.cols << endl;
+    cout << "ticks:          " << sum.ticks << endl;
+    cout << "captures:       " << sum.captures << " (" << sum.capturedCells << " cells, " << sum.nearMisses << " near misses)" << endl;
+    cout << "avg fill:       " << 100.0 * sum.filledCells / (double(sum.games) * options.rows * options.cols) << "%" << endl;
+    cout << "wall time:      " << seconds << " s" << endl;
+    cout << "ticks/sec:      " << (seconds > 0 ? sum.ticks / seconds : 0) << endl;
+    cout << "vs real time:   " << (seconds > 0 ? sum.ticks / options.tickRate / seconds : 0) << "x" << endl;
+    if (options.telemetryPath)
+        cout << "telemetry:      " << telemetry.linesLogged << " lines (" << telemetry.linesDropped << " dropped)" << endl;
+    cout << "enemy moves/s:  " << (seconds > 0 ? sum.enemyMoves / seconds : 0)
+         << (enemyMoveUsesAvx2() ? " (AVX2)" : " (scalar)") << endl;
+    return 0;
+}